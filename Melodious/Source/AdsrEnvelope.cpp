@@ -0,0 +1,197 @@
+#include "AdsrEnvelope.h"
+
+namespace
+{
+  // How far past its end level an exponential stage aims, as a fraction of
+  // the distance it covers. Smaller is a sharper curve.
+  constexpr double overshoot = 0.01;
+
+  int millisecondsToSamples (float milliseconds, double sampleRate)
+  {
+	return juce::jmax (0, juce::roundToInt (milliseconds * 0.001 * sampleRate));
+  }
+
+  // r^n for n = 0 ... maxBlockSize, where r takes a stage from its start to
+  // its end level in numSamples whatever the two levels are
+  void fillPowers (float* powers, int numSamples)
+  {
+	const auto r = numSamples > 0 ? std::pow (overshoot / (1.0 + overshoot), 1.0 / numSamples) : 0.0;
+	auto power = 1.0;
+
+	for (int n = 0; n <= AdsrEnvelope::maxBlockSize; ++n)
+	  {
+		powers[n] = (float) power;
+		power *= r;
+	  }
+  }
+}
+
+AdsrEnvelope::AdsrEnvelope()
+{
+  updateStages();
+}
+
+void AdsrEnvelope::setParameters (const Parameters& newParameters)
+{
+  parameters = newParameters;
+  parameters.sustainLevel = juce::jlimit (0.0f, 1.0f, parameters.sustainLevel);
+  updateStages();
+}
+
+void AdsrEnvelope::setSampleRate (double newSampleRate)
+{
+  if (newSampleRate > 0.0 && newSampleRate != sampleRate)
+	{
+	  sampleRate = newSampleRate;
+	  updateStages();
+	}
+}
+
+void AdsrEnvelope::updateStages()
+{
+  attackSamples = millisecondsToSamples (parameters.attackMs, sampleRate);
+  decaySamples = millisecondsToSamples (parameters.decayMs, sampleRate);
+  releaseSamples = millisecondsToSamples (parameters.releaseMs, sampleRate);
+
+  fillPowers (decayPowers, decaySamples);
+  fillPowers (releasePowers, releaseSamples);
+}
+
+void AdsrEnvelope::noteOn() noexcept
+{
+  value = 0.0f;
+  enterStage (Stage::attack);
+}
+
+void AdsrEnvelope::noteOff() noexcept
+{
+  if (stage != Stage::idle && stage != Stage::release)
+	enterStage (Stage::release);
+}
+
+void AdsrEnvelope::reset() noexcept
+{
+  value = 0.0f;
+  stage = Stage::idle;
+  samplesLeftInStage = 0;
+}
+
+// Sets up a ramp from the current value to endLevel. With no samples to do
+// it in, the stage is skipped and the level jumps.
+void AdsrEnvelope::startRamp (float endLevel, int numSamples, const float* exponentialPowers) noexcept
+{
+  samplesLeftInStage = numSamples;
+
+  if (numSamples <= 0)
+	return;
+
+  if (exponentialPowers != nullptr && parameters.curve == Curve::exponential)
+	{
+	  const auto span = value - endLevel;
+	  target = endLevel - span * (float) overshoot;
+	  distance = value - target;
+	  powers = exponentialPowers;
+	}
+  else
+	{
+	  step = (endLevel - value) / (float) numSamples;
+	  powers = nullptr;
+	}
+}
+
+void AdsrEnvelope::enterStage (Stage newStage) noexcept
+{
+  stage = newStage;
+
+  switch (stage)
+	{
+	case Stage::attack:
+	  startRamp (1.0f, attackSamples, nullptr);
+	  if (samplesLeftInStage == 0)
+		{
+		  value = 1.0f;
+		  enterStage (Stage::decay);
+		}
+	  break;
+
+	case Stage::decay:
+	  startRamp (parameters.sustainLevel, decaySamples, decayPowers);
+	  if (samplesLeftInStage == 0)
+		{
+		  value = parameters.sustainLevel;
+		  enterStage (Stage::sustain);
+		}
+	  break;
+
+	case Stage::sustain:
+	  // held for as long as the key is: this only runs out after hours, and
+	  // then it starts again
+	  value = parameters.sustainLevel;
+	  step = 0.0f;
+	  powers = nullptr;
+	  samplesLeftInStage = std::numeric_limits<int>::max();
+	  break;
+
+	case Stage::release:
+	  startRamp (0.0f, releaseSamples, releasePowers);
+	  if (samplesLeftInStage == 0)
+		reset();
+	  break;
+
+	case Stage::idle:
+	  reset();
+	  break;
+	}
+}
+
+void AdsrEnvelope::fillSegment (float* gains, int numSamples) noexcept
+{
+  if (powers != nullptr)
+	{
+	  juce::FloatVectorOperations::copyWithMultiply (gains, powers, distance, numSamples);
+	  juce::FloatVectorOperations::add (gains, target, numSamples);
+	  distance *= powers[numSamples];
+	  value = target + distance;
+	}
+  else if (step == 0.0f)
+	{
+	  juce::FloatVectorOperations::fill (gains, value, numSamples);
+	}
+  else
+	{
+	  for (int i = 0; i < numSamples; ++i)
+		gains[i] = value + step * (float) i;
+
+	  value += step * (float) numSamples;
+	}
+}
+
+int AdsrEnvelope::getNextGains (float* gains, int numSamples) noexcept
+{
+  jassert (numSamples <= maxBlockSize);
+  auto numWritten = 0;
+
+  while (numWritten < numSamples && stage != Stage::idle)
+	{
+	  const auto numInSegment = juce::jmin (numSamples - numWritten, samplesLeftInStage);
+
+	  fillSegment (gains + numWritten, numInSegment);
+	  numWritten += numInSegment;
+	  samplesLeftInStage -= numInSegment;
+
+	  if (samplesLeftInStage == 0)
+		{
+		  // land exactly on the stage's end level rather than where rounding left us
+		  switch (stage)
+			{
+			case Stage::attack:  value = 1.0f; enterStage (Stage::decay); break;
+			case Stage::decay:   value = parameters.sustainLevel; enterStage (Stage::sustain); break;
+			case Stage::sustain: enterStage (Stage::sustain); break;
+			case Stage::release: enterStage (Stage::idle); break;
+			case Stage::idle:    break;
+			}
+		}
+	}
+
+  return numWritten;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  An ADSR envelope with its times in milliseconds, so a note sounds the same
+  at any sample rate. Gains are produced a block at a time: each stage is a
+  ramp, either linear or exponential, written out with vector operations,
+  and the only decisions are made at stage boundaries. The release ends on
+  an exact sample, which getNextGains reports so the voice can stop there.
+
+  Exponential stages aim a little past their end level and are cut off when
+  they reach it, as an analogue envelope's RC curve would be, so that every
+  stage has a definite length.
+*/
+class AdsrEnvelope
+{
+public:
+  enum class Curve
+  {
+	linear,
+	exponential   // for decay and release; the attack is always linear
+  };
+
+  struct Parameters
+  {
+	float attackMs = 2.0f, decayMs = 80.0f;
+	float sustainLevel = 0.8f;
+	float releaseMs = 15.0f;
+	Curve curve = Curve::exponential;
+  };
+
+  static constexpr int maxBlockSize = 256;
+
+  AdsrEnvelope();
+
+  void setParameters (const Parameters&);
+  const Parameters& getParameters() const noexcept { return parameters; }
+  void setSampleRate (double);
+
+  void noteOn() noexcept;
+  void noteOff() noexcept;
+  void reset() noexcept;
+  bool isActive() const noexcept { return stage != Stage::idle; }
+
+  // Writes the gains for up to numSamples (at most maxBlockSize) samples and
+  // returns how many it wrote: fewer than asked when the release finishes.
+  int getNextGains (float* gains, int numSamples) noexcept;
+
+private:
+  enum class Stage { idle, attack, decay, sustain, release };
+
+  void updateStages();
+  void enterStage (Stage) noexcept;
+  void startRamp (float endLevel, int numSamples, const float* exponentialPowers) noexcept;
+  void fillSegment (float* gains, int numSamples) noexcept;
+
+  Parameters parameters;
+  double sampleRate = 44100.0;
+  int attackSamples = 0, decaySamples = 0, releaseSamples = 0;
+
+  Stage stage = Stage::idle;
+  int samplesLeftInStage = 0;
+  float value = 0.0f;  // the gain of the next sample
+
+  // The running segment is either value + step * n, or target + distance * r^n
+  // with r^n read from one of the tables below.
+  float step = 0.0f, target = 0.0f, distance = 0.0f;
+  const float* powers = nullptr;
+  alignas (16) float decayPowers[maxBlockSize + 1];
+  alignas (16) float releasePowers[maxBlockSize + 1];
+};
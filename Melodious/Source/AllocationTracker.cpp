@@ -0,0 +1,129 @@
+#include "AllocationTracker.h"
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+  thread_local juce::int64 threadAllocationCount = 0;
+  thread_local bool insideAudioCallback = false;
+  thread_local bool reportingAllocation = false;
+  std::atomic<juce::int64> audioThreadAllocationCount { 0 };
+}
+
+void AllocationTracker::recordAllocation() noexcept
+{
+  ++threadAllocationCount;
+
+  if (insideAudioCallback && ! reportingAllocation)
+	{
+	  audioThreadAllocationCount.fetch_add (1, std::memory_order_relaxed);
+
+	 #if MELODIOUS_ASSERT_AUDIO_ALLOCATIONS
+	  // logging the assertion allocates too, so don't come back in here
+	  reportingAllocation = true;
+	  jassertfalse; // something on the audio thread allocated
+	  reportingAllocation = false;
+	 #endif
+	}
+}
+
+juce::int64 AllocationTracker::getThreadAllocationCount() noexcept
+{
+  return threadAllocationCount;
+}
+
+juce::int64 AllocationTracker::getAudioThreadAllocationCount() noexcept
+{
+  return audioThreadAllocationCount.load (std::memory_order_relaxed);
+}
+
+bool AllocationTracker::isInsideAudioCallback() noexcept
+{
+  return insideAudioCallback;
+}
+
+AllocationTracker::ScopedAudioCallback::ScopedAudioCallback() noexcept
+  : wasInside (insideAudioCallback)
+{
+  insideAudioCallback = true;
+}
+
+AllocationTracker::ScopedAudioCallback::~ScopedAudioCallback() noexcept
+{
+  insideAudioCallback = wasInside;
+}
+
+AllocationTracker::ScopedOutsideAudioCallback::ScopedOutsideAudioCallback() noexcept
+  : wasInside (insideAudioCallback)
+{
+  insideAudioCallback = false;
+}
+
+AllocationTracker::ScopedOutsideAudioCallback::~ScopedOutsideAudioCallback() noexcept
+{
+  insideAudioCallback = wasInside;
+}
+
+//==============================================================================
+#if MELODIOUS_TRACK_ALLOCATIONS
+ #if defined (__GLIBC__)
+
+// glibc's operator new goes through malloc, so hooking the malloc family
+// catches both C and C++ allocations. The real allocator stays reachable
+// through its __libc_ entry points.
+extern "C"
+{
+  void* __libc_malloc (size_t);
+  void* __libc_calloc (size_t, size_t);
+  void* __libc_realloc (void*, size_t);
+  void* __libc_memalign (size_t, size_t);
+
+  void* malloc (size_t size)
+  {
+	AllocationTracker::recordAllocation();
+	return __libc_malloc (size);
+  }
+
+  void* calloc (size_t num, size_t size)
+  {
+	AllocationTracker::recordAllocation();
+	return __libc_calloc (num, size);
+  }
+
+  void* realloc (void* ptr, size_t size)
+  {
+	AllocationTracker::recordAllocation();
+	return __libc_realloc (ptr, size);
+  }
+
+  void* memalign (size_t alignment, size_t size)
+  {
+	AllocationTracker::recordAllocation();
+	return __libc_memalign (alignment, size);
+  }
+}
+
+ #else
+
+namespace
+{
+  void* countedAllocate (std::size_t size)
+  {
+	AllocationTracker::recordAllocation();
+
+	if (auto* ptr = std::malloc (size == 0 ? 1 : size))
+	  return ptr;
+
+	throw std::bad_alloc();
+  }
+}
+
+void* operator new (std::size_t size)                    { return countedAllocate (size); }
+void* operator new[] (std::size_t size)                  { return countedAllocate (size); }
+void operator delete (void* ptr) noexcept                { std::free (ptr); }
+void operator delete[] (void* ptr) noexcept              { std::free (ptr); }
+void operator delete (void* ptr, std::size_t) noexcept   { std::free (ptr); }
+void operator delete[] (void* ptr, std::size_t) noexcept { std::free (ptr); }
+
+ #endif
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Set to 1 to hook the heap (malloc and friends on glibc, operator new
+// elsewhere) and count allocations per thread and inside the audio callback.
+// The headless tools and Debug builds of the app turn this on; Release
+// builds of the app leave it off so the hooks cost nothing.
+#ifndef MELODIOUS_TRACK_ALLOCATIONS
+ #define MELODIOUS_TRACK_ALLOCATIONS 0
+#endif
+
+// Set to 1 (with MELODIOUS_TRACK_ALLOCATIONS) to hit a jassert on every
+// allocation made inside the audio callback.
+#ifndef MELODIOUS_ASSERT_AUDIO_ALLOCATIONS
+ #define MELODIOUS_ASSERT_AUDIO_ALLOCATIONS 0
+#endif
+
+struct AllocationTracker
+{
+  static constexpr bool isEnabled() { return MELODIOUS_TRACK_ALLOCATIONS != 0; }
+
+  // Number of allocations made so far by the calling thread (always 0 when disabled).
+  static juce::int64 getThreadAllocationCount() noexcept;
+
+  // Number of allocations made by any thread while inside a ScopedAudioCallback.
+  static juce::int64 getAudioThreadAllocationCount() noexcept;
+
+  // True while the calling thread is inside a ScopedAudioCallback, whether
+  // or not allocations are being tracked.
+  static bool isInsideAudioCallback() noexcept;
+
+  // Marks the calling thread as running the audio callback while it exists.
+  struct ScopedAudioCallback
+  {
+	ScopedAudioCallback() noexcept;
+	~ScopedAudioCallback() noexcept;
+
+  private:
+	bool wasInside;
+	JUCE_DECLARE_NON_COPYABLE (ScopedAudioCallback)
+  };
+
+  // Lifts that mark while it exists, for work done in line offline that the
+  // live engine would hand to another thread
+  struct ScopedOutsideAudioCallback
+  {
+	ScopedOutsideAudioCallback() noexcept;
+	~ScopedOutsideAudioCallback() noexcept;
+
+  private:
+	bool wasInside;
+	JUCE_DECLARE_NON_COPYABLE (ScopedOutsideAudioCallback)
+  };
+
+  static void recordAllocation() noexcept;
+};
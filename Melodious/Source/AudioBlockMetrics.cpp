@@ -0,0 +1,98 @@
+#include "AudioBlockMetrics.h"
+
+//==============================================================================
+void AudioBlockMetrics::record (juce::int64 startTicks, juce::int64 blockStart, int numSamples,
+								double sampleRate, int numActiveVoices, int numMidiEvents) noexcept
+{
+  const auto endTicks = juce::Time::getHighResolutionTicks();
+  const auto interval = lastCallbackTicks != 0
+	? juce::Time::highResolutionTicksToSeconds (startTicks - lastCallbackTicks) : 0.0;
+  lastCallbackTicks = startTicks;
+
+  blocks.push ({ blockStart, numSamples, sampleRate,
+				 juce::Time::highResolutionTicksToSeconds (endTicks - startTicks), interval,
+				 numActiveVoices, numMidiEvents });
+}
+
+//==============================================================================
+AudioBlockMetrics::Window::Window (int size)
+  : blocks (size) {}
+
+void AudioBlockMetrics::Window::update (AudioBlockMetrics& metrics)
+{
+  Block newBlocks[256];
+
+  for (;;)
+	{
+	  const auto numRead = metrics.readBlocks (newBlocks, juce::numElementsInArray (newBlocks));
+
+	  for (int i = 0; i < numRead; ++i)
+		{
+		  if (newBlocks[i].wasLate())
+			++totalLate;
+
+		  blocks.add (newBlocks[i]);
+		}
+
+	  if (numRead < juce::numElementsInArray (newBlocks))
+		break;
+	}
+
+  totalDropped = metrics.getNumDropped();
+}
+
+AudioBlockMetrics::Summary AudioBlockMetrics::Window::getSummary() const
+{
+  Summary summary;
+  summary.numBlocks = blocks.size();
+  summary.totalLate = totalLate;
+  summary.totalDropped = totalDropped;
+
+  if (blocks.isEmpty())
+	return summary;
+
+  juce::Array<double> loads, callbacks;
+  juce::Array<int> voices;
+  loads.ensureStorageAllocated (blocks.size());
+  callbacks.ensureStorageAllocated (blocks.size());
+  voices.ensureStorageAllocated (blocks.size());
+
+  for (const auto& block : blocks.getValues())
+	{
+	  loads.add (block.getLoad());
+	  callbacks.add (block.callbackSeconds);
+	  voices.add (block.numActiveVoices);
+	  summary.midiEventsMax = juce::jmax (summary.midiEventsMax, block.numMidiEvents);
+
+	  if (block.wasLate())
+		++summary.numLate;
+	}
+
+  loads.sort();
+  callbacks.sort();
+  voices.sort();
+
+  summary.loadMedian = getPercentile (loads, 50);
+  summary.load99 = getPercentile (loads, 99);
+  summary.loadMax = loads.getLast();
+  summary.callbackMedian = getPercentile (callbacks, 50);
+  summary.callback99 = getPercentile (callbacks, 99);
+  summary.callbackMax = callbacks.getLast();
+  summary.voicesMedian = getPercentile (voices, 50);
+  summary.voicesMax = voices.getLast();
+  return summary;
+}
+
+juce::String AudioBlockMetrics::Summary::toString() const
+{
+  const auto percent = [] (double load) { return juce::String (load * 100.0, 1) + "%"; };
+  const auto micros = [] (double seconds) { return juce::String (seconds * 1.0e6, 1) + " us"; };
+
+  return "load " + percent (loadMedian) + " / " + percent (load99) + " / " + percent (loadMax)
+	+ ", callback " + micros (callbackMedian) + " / " + micros (callback99) + " / " + micros (callbackMax)
+	+ " (median / 99% / max of " + juce::String (numBlocks) + " blocks)"
+	+ ", voices " + juce::String (voicesMedian) + " / " + juce::String (voicesMax)
+	+ ", MIDI events up to " + juce::String (midiEventsMax) + " a block"
+	+ ", late callbacks " + juce::String (numLate) + " (" + juce::String (totalLate) + " in all)"
+	+ ", dropped " + juce::String (totalDropped);
+}
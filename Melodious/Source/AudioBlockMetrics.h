@@ -0,0 +1,87 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MetricsHistory.h"
+
+//==============================================================================
+/*
+  What each audio block cost: how long the callback took, how much of the
+  block's own duration that was, how many voices were sounding and how many
+  MIDI events went to the synth. The time since the previous callback is kept
+  too, so a callback that came late, which is what the listener hears as a
+  glitch, shows up even when the block itself was cheap.
+
+  The audio thread writes one slot per block into a MetricsFifo; one other
+  thread reads them into a Window, which sums up the last few seconds.
+*/
+class AudioBlockMetrics
+{
+public:
+  static constexpr int capacity = 4096;
+
+  struct Block
+  {
+	juce::int64 blockStart;    // samples rendered before this block
+	int numSamples;
+	double sampleRate;
+	double callbackSeconds;    // time spent in the callback
+	double intervalSeconds;    // since the previous callback started, 0 for the first
+	int numActiveVoices, numMidiEvents;
+
+	double getBudgetSeconds() const noexcept  { return numSamples / sampleRate; }
+	double getLoad() const noexcept           { return callbackSeconds / getBudgetSeconds(); }
+	// Half a block later than the device should ever call back
+	bool wasLate() const noexcept             { return intervalSeconds > 1.5 * getBudgetSeconds(); }
+  };
+
+  //==============================================================================
+  struct Summary
+  {
+	int numBlocks = 0;
+	double loadMedian = 0.0, load99 = 0.0, loadMax = 0.0;
+	double callbackMedian = 0.0, callback99 = 0.0, callbackMax = 0.0;   // in seconds
+	int voicesMedian = 0, voicesMax = 0, midiEventsMax = 0;
+	int numLate = 0;       // within the window
+	int totalLate = 0, totalDropped = 0;
+
+	juce::String toString() const;
+  };
+
+  // The reading side: the last windowSize blocks, and counts since it started
+  class Window
+  {
+  public:
+	explicit Window (int windowSize = 1024);
+
+	// Reads everything the audio thread has written since the last call
+	void update (AudioBlockMetrics&);
+	Summary getSummary() const;
+
+  private:
+	MetricsHistory<Block> blocks;
+	int totalLate = 0, totalDropped = 0;
+  };
+
+  //==============================================================================
+  AudioBlockMetrics() = default;
+
+  void setEnabled (bool shouldRecord) noexcept   { blocks.setEnabled (shouldRecord); }
+  bool isEnabled() const noexcept                { return blocks.isEnabled(); }
+
+  // Audio thread. A new stream of blocks starts from here, so the first
+  // interval isn't measured across a restart.
+  void reset() noexcept                          { lastCallbackTicks = 0; }
+  // Audio thread; startTicks is Time::getHighResolutionTicks() when the callback began
+  void record (juce::int64 startTicks, juce::int64 blockStart, int numSamples, double sampleRate,
+			   int numActiveVoices, int numMidiEvents) noexcept;
+
+  // The one reading thread
+  int readBlocks (Block* dest, int maxBlocks) noexcept   { return blocks.read (dest, maxBlocks); }
+  int getNumDropped() const noexcept             { return blocks.getNumDropped(); }
+
+private:
+  juce::int64 lastCallbackTicks = 0;
+  MetricsFifo<Block, capacity> blocks;
+
+  JUCE_DECLARE_NON_COPYABLE (AudioBlockMetrics)
+};
@@ -0,0 +1,132 @@
+#include "AudioExporter.h"
+
+AudioExporter::AudioExporter() {}
+
+AudioExporter::~AudioExporter()
+{
+  stop();
+  writerThread.stopThread (2000);
+}
+
+bool AudioExporter::start (const juce::File& newFile, double sampleRate, int newNumChannels,
+						   juce::String& error, int fifoFrames)
+{
+  stop();
+
+  std::unique_ptr<juce::AudioFormat> format;
+
+  if (newFile.hasFileExtension ("flac"))
+	format.reset (new juce::FlacAudioFormat());
+  else
+	format.reset (new juce::WavAudioFormat());
+
+  newNumChannels = juce::jlimit (1, (int) maxChannels, newNumChannels);
+  newFile.deleteFile();
+  std::unique_ptr<juce::FileOutputStream> stream (newFile.createOutputStream());
+
+  if (stream == nullptr)
+	{
+	  error = "Couldn't write " + newFile.getFullPathName();
+	  return false;
+	}
+
+  std::unique_ptr<juce::AudioFormatWriter> fileWriter (format->createWriterFor (stream.get(), sampleRate,
+																				(unsigned int) newNumChannels,
+																				24, {}, 0));
+  if (fileWriter == nullptr)
+	{
+	  error = format->getFormatName() + " can't be written at " + juce::String (sampleRate, 0) + " Hz";
+	  return false;
+	}
+
+  stream.release();   // the writer owns it now
+
+  if (! writerThread.isThreadRunning())
+	writerThread.startThread (3);
+
+  std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> newWriter (
+	new juce::AudioFormatWriter::ThreadedWriter (fileWriter.release(), writerThread, fifoFrames));
+
+  const juce::SpinLock::ScopedLockType sl (writerLock);
+  writer = std::move (newWriter);
+  file = newFile;
+  numChannels = newNumChannels;
+  maxChunkFrames = juce::jmax (1, fifoFrames / 2);
+  framesQueued = 0;
+  droppedBlocks = 0;
+  active = true;
+  return true;
+}
+
+void AudioExporter::stop()
+{
+  std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> oldWriter;
+
+  {
+	const juce::SpinLock::ScopedLockType sl (writerLock);
+	oldWriter = std::move (writer);
+	active = false;
+  }
+
+  // deleting it writes out the rest of its FIFO, outside the lock
+  oldWriter.reset();
+}
+
+int AudioExporter::getChannels (const juce::AudioBuffer<float>& buffer, int startSample,
+								const float** channels) const noexcept
+{
+  if (buffer.getNumChannels() == 0)
+	return 0;
+
+  for (int channel = 0; channel < numChannels; ++channel)
+	channels[channel] = buffer.getReadPointer (juce::jmin (channel, buffer.getNumChannels() - 1), startSample);
+
+  return numChannels;
+}
+
+bool AudioExporter::write (const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+  const juce::SpinLock::ScopedTryLockType sl (writerLock);
+
+  if (! sl.isLocked() || writer == nullptr)
+	return false;
+
+  const float* channels[maxChannels];
+
+  if (getChannels (buffer, startSample, channels) == 0)
+	return false;
+
+  if (! writer->write (channels, numSamples))
+	{
+	  droppedBlocks.fetch_add (1);
+	  return false;
+	}
+
+  framesQueued.fetch_add (numSamples);
+  return true;
+}
+
+void AudioExporter::writeWaiting (const juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+  const juce::SpinLock::ScopedLockType sl (writerLock);
+  const float* channels[maxChannels];
+
+  if (writer == nullptr || getChannels (buffer, startSample, channels) == 0)
+	return;
+
+  // The writer takes a block whole or not at all, and never one bigger than
+  // its FIFO, so a long one goes in pieces, each waiting for room
+  for (int done = 0; done < numSamples;)
+	{
+	  const auto chunk = juce::jmin (numSamples - done, maxChunkFrames);
+
+	  while (! writer->write (channels, chunk))
+		juce::Thread::sleep (1);
+
+	  for (int channel = 0; channel < numChannels; ++channel)
+		channels[channel] += chunk;
+
+	  done += chunk;
+	  framesQueued.fetch_add (chunk);
+	}
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Writes audio to a WAV or FLAC file on a thread of its own. Blocks go in
+  through the lock-free FIFO of a juce::AudioFormatWriter::ThreadedWriter,
+  so whoever hands them over (the audio thread capturing the output, or an
+  offline render) only copies samples and never waits for the encoder or
+  the disk.
+
+  The format comes from the file's extension: .flac is 24-bit FLAC and
+  anything else 24-bit WAV. start and stop are for the message thread.
+*/
+class AudioExporter
+{
+public:
+  // how far the writer may fall behind before blocks are dropped: five seconds at 48kHz
+  static constexpr int defaultFifoFrames = 1 << 18;
+  static constexpr int maxChannels = 8;
+
+  AudioExporter();
+  ~AudioExporter();
+
+  // Replaces any file being written with a new one; the error says why not
+  bool start (const juce::File&, double sampleRate, int numChannels, juce::String& error,
+			  int fifoFrames = defaultFifoFrames);
+  // Writes out whatever is still queued and closes the file
+  void stop();
+  bool isActive() const noexcept                       { return active.load(); }
+  const juce::File& getFile() const noexcept           { return file; }
+
+  // Any one thread at a time, lock-free. Queues a block for the writer and
+  // returns true, or drops it and counts it if the FIFO is full (or smaller
+  // than the block, which no waiting would fix). A block with fewer
+  // channels than the file repeats its last one.
+  bool write (const juce::AudioBuffer<float>&, int startSample, int numSamples) noexcept;
+  // Offline, with nothing else writing: waits for room in the FIFO rather
+  // than drop the block, and hands over one longer than the FIFO in pieces
+  void writeWaiting (const juce::AudioBuffer<float>&, int startSample, int numSamples);
+
+  juce::int64 getNumFramesQueued() const noexcept     { return framesQueued.load(); }
+  int getNumDroppedBlocks() const noexcept             { return droppedBlocks.load(); }
+
+private:
+  int getChannels (const juce::AudioBuffer<float>&, int startSample, const float** channels) const noexcept;
+
+  juce::TimeSliceThread writerThread { "Audio export" };
+  // the audio thread only ever tries it, and skips the block if start or stop has it
+  juce::SpinLock writerLock;
+  std::unique_ptr<juce::AudioFormatWriter::ThreadedWriter> writer;
+  juce::File file;
+  int numChannels = 0;
+  int maxChunkFrames = 1;   // half the FIFO, so the writer drains one piece while the next waits
+  std::atomic<bool> active { false };
+  std::atomic<juce::int64> framesQueued { 0 };
+  std::atomic<int> droppedBlocks { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (AudioExporter)
+};
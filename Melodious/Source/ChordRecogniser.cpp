@@ -0,0 +1,191 @@
+#include "ChordRecogniser.h"
+
+namespace
+{
+  struct Quality
+  {
+	const char* suffix;
+	juce::uint16 intervals;   // bit n set for n semitones above the root
+	bool isSymmetric;         // every inversion is the same shape, so the bass names it
+  };
+
+  constexpr juce::uint16 shape (std::initializer_list<int> semitones)
+  {
+	juce::uint16 mask = 0;
+
+	for (auto semitone : semitones)
+	  mask |= (juce::uint16) (1 << semitone);
+
+	return mask;
+  }
+
+  // Where two shapes share a mask (Am7 and C6, say) the one nearer the top
+  // wins. Entry 0 stands for "no chord".
+  constexpr Quality qualities[] =
+  {
+	{ "",       0,                             false },
+	{ "",       shape ({ 0, 4, 7 }),           false },
+	{ "m",      shape ({ 0, 3, 7 }),           false },
+	{ "dim",    shape ({ 0, 3, 6 }),           false },
+	{ "aug",    shape ({ 0, 4, 8 }),           true  },
+	{ "sus4",   shape ({ 0, 5, 7 }),           false },
+	{ "sus2",   shape ({ 0, 2, 7 }),           false },
+	{ "7",      shape ({ 0, 4, 7, 10 }),       false },
+	{ "maj7",   shape ({ 0, 4, 7, 11 }),       false },
+	{ "m7",     shape ({ 0, 3, 7, 10 }),       false },
+	{ "m7b5",   shape ({ 0, 3, 6, 10 }),       false },
+	{ "dim7",   shape ({ 0, 3, 6, 9 }),        true  },
+	{ "mMaj7",  shape ({ 0, 3, 7, 11 }),       false },
+	{ "7sus4",  shape ({ 0, 5, 7, 10 }),       false },
+	{ "6",      shape ({ 0, 4, 7, 9 }),        false },
+	{ "m6",     shape ({ 0, 3, 7, 9 }),        false },
+	{ "add9",   shape ({ 0, 2, 4, 7 }),        false },
+	{ "madd9",  shape ({ 0, 2, 3, 7 }),        false },
+	{ "9",      shape ({ 0, 2, 4, 7, 10 }),    false },
+	{ "maj9",   shape ({ 0, 2, 4, 7, 11 }),    false },
+	{ "m9",     shape ({ 0, 2, 3, 7, 10 }),    false },
+	{ "7b9",    shape ({ 0, 1, 4, 7, 10 }),    false },
+	{ "7#9",    shape ({ 0, 3, 4, 7, 10 }),    false },
+	{ "6/9",    shape ({ 0, 2, 4, 7, 9 }),     false },
+	{ "7#11",   shape ({ 0, 4, 6, 7, 10 }),    false },
+	{ "maj7#11", shape ({ 0, 4, 6, 7, 11 }),   false },
+	{ "11",     shape ({ 0, 2, 4, 5, 7, 10 }), false },
+	{ "m11",    shape ({ 0, 2, 3, 5, 7, 10 }), false },
+	{ "13",     shape ({ 0, 2, 4, 7, 9, 10 }), false },
+	{ "maj13",  shape ({ 0, 2, 4, 7, 9, 11 }), false },
+	// sevenths and ninths are often voiced without the fifth
+	{ "7",      shape ({ 0, 4, 10 }),          false },
+	{ "maj7",   shape ({ 0, 4, 11 }),          false },
+	{ "m7",     shape ({ 0, 3, 10 }),          false },
+	{ "9",      shape ({ 0, 2, 4, 10 }),       false },
+	{ "5",      shape ({ 0, 7 }),              false },
+	{ "",       shape ({ 0 }),                 false }
+  };
+
+  constexpr int numQualities = (int) (sizeof (qualities) / sizeof (qualities[0]));
+
+  struct ChordTable
+  {
+	struct Entry
+	{
+	  juce::uint8 quality, root;
+	};
+
+	Entry entries[4096];
+  };
+
+  // Every quality at every root. Written lowest priority first, so that a
+  // mask two shapes share ends up with the one listed first.
+  constexpr ChordTable createChordTable()
+  {
+	ChordTable table {};
+
+	for (int quality = numQualities - 1; quality > 0; --quality)
+	  for (int root = 0; root < 12; ++root)
+		{
+		  const auto intervals = (unsigned int) qualities[quality].intervals;
+		  const auto mask = ((intervals << root) | (intervals >> (12 - root))) & 0xfffu;
+
+		  table.entries[mask].quality = (juce::uint8) quality;
+		  table.entries[mask].root = (juce::uint8) root;
+		}
+
+	return table;
+  }
+
+  constexpr ChordTable chordTable = createChordTable();
+
+  static_assert (chordTable.entries[0x091].quality == 1 && chordTable.entries[0x091].root == 0, "C major");
+  static_assert (chordTable.entries[0x125].quality == 10 && chordTable.entries[0x125].root == 2, "Dm7b5");
+  static_assert (chordTable.entries[0x000].quality == 0, "silence isn't a chord");
+
+  // The pitch classes of 64 keys starting from firstKey, folded into 12 bits
+  juce::uint16 foldPitchClasses (juce::uint64 keys, int firstKey) noexcept
+  {
+	juce::uint32 mask = 0;
+
+	for (auto key = firstKey; keys != 0; keys >>= 12, key += 12)
+	  mask |= (juce::uint32) (keys & 0xfff) << (key % 12);
+
+	return (juce::uint16) ((mask | (mask >> 12)) & 0xfff);
+  }
+
+  int findLowestSetBit (juce::uint64 bits) noexcept
+  {
+	return juce::countNumberOfBits ((bits & (~bits + 1)) - 1);
+  }
+}
+
+//==============================================================================
+juce::String ChordRecogniser::Chord::getName() const
+{
+  if (! isValid())
+	return {};
+
+  auto name = juce::MidiMessage::getMidiNoteName (root, true, false, 3) + qualities[quality].suffix;
+
+  if (bass != root)
+	name << "/" << juce::MidiMessage::getMidiNoteName (bass, true, false, 3);
+
+  return name;
+}
+
+ChordRecogniser::Chord ChordRecogniser::recognise (juce::uint16 pitchClasses, int bassPitchClass) noexcept
+{
+  const auto& entry = chordTable.entries[pitchClasses & 0xfff];
+  Chord chord;
+
+  if (entry.quality == 0)
+	return chord;
+
+  chord.quality = entry.quality;
+  chord.root = qualities[entry.quality].isSymmetric ? bassPitchClass : entry.root;
+  chord.bass = bassPitchClass;
+  return chord;
+}
+
+void ChordRecogniser::handleNoteOn (juce::MidiKeyboardState*, int, int midiNoteNumber, float)
+{
+  if (! juce::isPositiveAndBelow (midiNoteNumber, 128))
+	return;
+
+  heldKeys[midiNoteNumber / 64].fetch_or ((juce::uint64) 1 << (midiNoteNumber % 64));
+  update();
+}
+
+void ChordRecogniser::handleNoteOff (juce::MidiKeyboardState* source, int, int midiNoteNumber, float)
+{
+  if (! juce::isPositiveAndBelow (midiNoteNumber, 128))
+	return;
+
+  // the same key may still be down on another channel
+  if (source != nullptr && source->isNoteOnForChannels (0xffff, midiNoteNumber))
+	return;
+
+  heldKeys[midiNoteNumber / 64].fetch_and (~((juce::uint64) 1 << (midiNoteNumber % 64)));
+  update();
+}
+
+void ChordRecogniser::update() noexcept
+{
+  const auto low = heldKeys[0].load(), high = heldKeys[1].load();
+  Chord chord;
+
+  if (low != 0 || high != 0)
+	{
+	  const auto bass = low != 0 ? findLowestSetBit (low) : 64 + findLowestSetBit (high);
+	  chord = recognise ((juce::uint16) (foldPitchClasses (low, 0) | foldPitchClasses (high, 64)), bass % 12);
+	}
+
+  currentChord = (juce::uint32) chord.quality | (juce::uint32) chord.root << 8 | (juce::uint32) chord.bass << 16;
+}
+
+ChordRecogniser::Chord ChordRecogniser::getCurrentChord() const noexcept
+{
+  const auto packed = currentChord.load();
+  Chord chord;
+  chord.quality = (int) (packed & 0xff);
+  chord.root = (int) ((packed >> 8) & 0xff);
+  chord.bass = (int) ((packed >> 16) & 0xff);
+  return chord;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Names the chord the student is holding. It listens to the MidiKeyboardState,
+  so it hears the MIDI input (on the audio thread) and the on-screen keyboard
+  (on the message thread) alike, keeps the held keys as bits, and folds them
+  into a 12-bit pitch-class mask. The mask indexes a 4096-entry table, built
+  at compile time, that gives every chord shape in every inversion a quality
+  and a root, so each note costs a handful of bit operations and one lookup.
+
+  The result is published as a single atomic word for the UI to poll.
+*/
+class ChordRecogniser : public juce::MidiKeyboardState::Listener
+{
+public:
+  struct Chord
+  {
+	int quality = 0;           // 0 when the held notes aren't a chord we know
+	int root = 0, bass = 0;    // pitch classes, 0 for C
+
+	bool isValid() const noexcept                   { return quality != 0; }
+	// "Cm7b5", "Ab/C", or empty if it isn't a chord
+	juce::String getName() const;
+
+	bool operator== (const Chord& other) const noexcept
+	{
+	  return quality == other.quality && root == other.root && bass == other.bass;
+	}
+	bool operator!= (const Chord& other) const noexcept   { return ! operator== (other); }
+  };
+
+  ChordRecogniser() = default;
+
+  // The chord for a set of pitch classes (bit 0 for C) over the given bass
+  static Chord recognise (juce::uint16 pitchClasses, int bassPitchClass) noexcept;
+
+  void handleNoteOn (juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+  void handleNoteOff (juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+
+  // The chord held right now. Safe from any thread.
+  Chord getCurrentChord() const noexcept;
+
+private:
+  void update() noexcept;
+
+  std::atomic<juce::uint64> heldKeys[2] { { 0 }, { 0 } };   // one bit per MIDI note
+  std::atomic<juce::uint32> currentChord { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (ChordRecogniser)
+};
@@ -0,0 +1,359 @@
+#include "ClassroomServer.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+  double ticksToMicros (double ticks)
+  {
+	return ticks * 1.0e6 / (double) juce::Time::getHighResolutionTicksPerSecond();
+  }
+
+  void sleepUntil (double targetTicks)
+  {
+	for (;;)
+	  {
+		const auto remaining = ticksToMicros (targetTicks - (double) juce::Time::getHighResolutionTicks());
+
+		if (remaining <= 0.0)
+		  return;
+
+		// finer than juce::Thread::sleep's milliseconds, which is most of a block
+		std::this_thread::sleep_for (std::chrono::microseconds ((juce::int64) remaining));
+	  }
+  }
+}
+
+//==============================================================================
+/*
+  One student: an engine of its own, the connection its MIDI comes in on,
+  and the timing of every block it renders. The connection's callbacks run
+  on its own thread, the blocks on whichever worker has the job.
+*/
+class ClassroomServer::Student : public juce::InterprocessConnection,
+								 public WorkStealingPool::Job
+{
+public:
+  explicit Student (const Settings& settings)
+	: juce::InterprocessConnection (false),
+	  engine (keyboardState, settings.numVoices),
+	  buffer (settings.numChannels, settings.blockSize),
+	  info (&buffer, 0, settings.blockSize)
+  {
+	engine.bindResources (settings.resources);
+	engine.setTransport (settings.transport);
+	engine.prepareToPlay (settings.blockSize, settings.sampleRate);
+  }
+
+  ~Student() override
+  {
+	disconnect();
+	engine.releaseResources();
+  }
+
+  int getNumMidiMessages() const noexcept     { return numMidiMessages.load(); }
+
+  // Before the first block is due; block n is due n + 1 block periods after start
+  void reset (int numBlocks, double newStartTicks, double newTicksPerBlock)
+  {
+	blockMicros.assign ((size_t) numBlocks, 0.0);
+	slackMicros.assign ((size_t) numBlocks, 0.0);
+	startTicks = newStartTicks;
+	ticksPerBlock = newTicksPerBlock;
+	blocksRendered = 0;
+	numLate = 0;
+	blocksDue.store (0);
+  }
+
+  // The clock: the first numBlocks blocks should be rendered by the end of
+  // this period. True if the student needs queueing, false if a worker
+  // already has it and will see the new block before it lets go.
+  bool schedule (int numBlocks) noexcept
+  {
+	blocksDue.store (numBlocks);
+	return ! scheduled.exchange (true);
+  }
+
+  void runJob() noexcept override
+  {
+	for (;;)
+	  {
+		while (blocksRendered < blocksDue.load())
+		  renderBlock();
+
+		scheduled.store (false);
+
+		// the clock may have moved on between the check above and the flag
+		// coming down, seen the flag up and left the block to us
+		if (blocksRendered >= blocksDue.load() || scheduled.exchange (true))
+		  return;
+	  }
+  }
+
+  // Read once the pool is idle
+  std::vector<double> blockMicros, slackMicros;
+  int numLate = 0;
+
+private:
+  void renderBlock() noexcept
+  {
+	const auto renderStart = juce::Time::getHighResolutionTicks();
+	engine.getNextAudioBlock (info);
+	const auto renderEnd = juce::Time::getHighResolutionTicks();
+
+	const auto block = (size_t) blocksRendered++;
+	const auto deadline = startTicks + (double) blocksRendered * ticksPerBlock;
+
+	if (block < blockMicros.size())
+	  {
+		blockMicros[block] = ticksToMicros ((double) (renderEnd - renderStart));
+		slackMicros[block] = ticksToMicros (deadline - (double) renderEnd);
+	  }
+
+	if ((double) renderEnd > deadline)
+	  ++numLate;
+  }
+
+  // InterprocessConnection
+  void connectionMade() override {}
+  void connectionLost() override {}
+
+  // A message may end in the middle of a MIDI message; the rest comes in the next
+  void messageReceived (const juce::MemoryBlock& message) override
+  {
+	for (size_t i = 0; i < message.getSize(); ++i)
+	  {
+		const auto byte = (juce::uint8) message[i];
+
+		if (byte >= 0xf8)             // real-time messages may come between any two bytes
+		  continue;
+
+		if (byte >= 0x80)
+		  {
+			inSysex = byte == 0xf0;
+			status = byte < 0xf0 ? byte : 0;
+			pendingSize = 0;
+			continue;
+		  }
+
+		if (inSysex || status == 0)
+		  continue;
+
+		if (pendingSize == 0)         // running status
+		  pending[pendingSize++] = status;
+
+		pending[pendingSize++] = byte;
+
+		if (pendingSize == juce::MidiMessage::getMessageLengthFromFirstByte (status))
+		  {
+			// stamped with the time now, as if it had just come from a device
+			engine.getMidiInputQueue()->addMessageToQueue (juce::MidiMessage (pending, pendingSize));
+			numMidiMessages.fetch_add (1);
+			pendingSize = 0;
+		  }
+	  }
+  }
+
+  juce::MidiKeyboardState keyboardState;
+  LooperAudioSource engine;
+  juce::AudioBuffer<float> buffer;
+  juce::AudioSourceChannelInfo info;
+
+  // the worker's
+  int blocksRendered = 0;
+  double startTicks = 0.0, ticksPerBlock = 0.0;
+  // shared with the clock
+  std::atomic<int> blocksDue { 0 };
+  std::atomic<bool> scheduled { false };
+
+  // the connection's
+  juce::uint8 status = 0, pending[3] {};
+  int pendingSize = 0;
+  bool inSysex = false;
+  std::atomic<int> numMidiMessages { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (Student)
+};
+
+//==============================================================================
+ClassroomServer::ClassroomServer() {}
+
+ClassroomServer::~ClassroomServer()
+{
+  stop();
+}
+
+bool ClassroomServer::start (const Settings& newSettings, juce::String& error)
+{
+  stop();
+
+  settings = newSettings;
+  settings.numStudents = juce::jmax (1, settings.numStudents);
+  settings.numThreads = juce::jmax (1, settings.numThreads);
+
+  // a student is queued at most once at a time, so no deque can hold more than all of them
+  pool.reset (new WorkStealingPool (settings.numThreads, settings.numStudents));
+
+  for (int i = 0; i < settings.numStudents; ++i)
+	students.push_back (std::make_unique<Student> (settings));
+
+  numConnectionsMade = 0;
+
+  if (! beginWaitingForSocket (settings.port, "127.0.0.1"))
+	{
+	  error = "Couldn't listen on port " + juce::String (settings.port);
+	  stop();
+	  return false;
+	}
+
+  listening = true;
+  return true;
+}
+
+void ClassroomServer::stop()
+{
+  if (listening)
+	juce::InterprocessConnectionServer::stop();
+
+  listening = false;
+  pool.reset();
+  students.clear();
+}
+
+int ClassroomServer::getPort() const noexcept
+{
+  return listening ? getBoundPort() : 0;
+}
+
+int ClassroomServer::getNumConnected() const noexcept
+{
+  return (int) std::count_if (students.begin(), students.end(),
+							  [] (const std::unique_ptr<Student>& s) { return s->isConnected(); });
+}
+
+bool ClassroomServer::waitForStudents (int numStudents, int timeoutMs) const
+{
+  const auto endTime = juce::Time::getMillisecondCounter() + (juce::uint32) timeoutMs;
+
+  while (getNumConnected() < numStudents)
+	{
+	  if (juce::Time::getMillisecondCounter() >= endTime)
+		return false;
+
+	  juce::Thread::sleep (5);
+	}
+
+  return true;
+}
+
+// The server's thread. Students are handed out in the order they connect;
+// one that drops out stays out, and connections beyond the class are refused.
+juce::InterprocessConnection* ClassroomServer::createConnectionObject()
+{
+  const auto index = numConnectionsMade.fetch_add (1);
+  return index < (int) students.size() ? students[(size_t) index].get() : nullptr;
+}
+
+//==============================================================================
+ClassroomServer::Report ClassroomServer::play (double seconds)
+{
+  Report report;
+  report.settings = settings;
+
+  if (students.empty())
+	return report;
+
+  const auto ticksPerBlock = settings.blockSize / settings.sampleRate
+							   * (double) juce::Time::getHighResolutionTicksPerSecond();
+  const auto numBlocks = juce::jmax (1, (int) (seconds * settings.sampleRate / settings.blockSize));
+  const auto jobsBefore = pool->getNumJobsRun(), stolenBefore = pool->getNumJobsStolen();
+  const auto startTicks = (double) juce::Time::getHighResolutionTicks();
+
+  for (auto& student : students)
+	student->reset (numBlocks, startTicks, ticksPerBlock);
+
+  for (int block = 0; block < numBlocks; ++block)
+	{
+	  // each block is released at the start of its period and due at the end
+	  sleepUntil (startTicks + block * ticksPerBlock);
+
+	  for (size_t i = 0; i < students.size(); ++i)
+		if (students[i]->schedule (block + 1))
+		  {
+			const auto queued = pool->addJob (*students[i], (int) i);
+			jassert (queued);
+			juce::ignoreUnused (queued);
+		  }
+
+	  pool->wakeWorkers();
+	}
+
+  pool->waitUntilIdle();
+  const auto wallMicros = ticksToMicros ((double) juce::Time::getHighResolutionTicks() - startTicks);
+
+  std::vector<double> blockMicros;
+  blockMicros.reserve ((size_t) numBlocks * students.size());
+  auto minSlack = std::numeric_limits<double>::max();
+  double renderMicros = 0.0;
+
+  for (auto& student : students)
+	{
+	  blockMicros.insert (blockMicros.end(), student->blockMicros.begin(), student->blockMicros.end());
+
+	  for (auto slack : student->slackMicros)
+		minSlack = juce::jmin (minSlack, slack);
+
+	  report.numLate += student->numLate;
+	  report.worstStudentLate = juce::jmax (report.worstStudentLate, student->numLate);
+	  report.numMidiMessages += student->getNumMidiMessages();
+	}
+
+  for (auto micros : blockMicros)
+	renderMicros += micros;
+
+  report.numBlocks = numBlocks;
+  report.numConnected = getNumConnected();
+  report.seconds = wallMicros * 1.0e-6;
+  report.budgetMicros = settings.blockSize / settings.sampleRate * 1.0e6;
+  report.minSlackMicros = minSlack;
+  report.coresBusy = wallMicros > 0.0 ? renderMicros / wallMicros : 0.0;
+  report.sessionsPerCore = report.coresBusy > 0.0 ? settings.numStudents / report.coresBusy : 0.0;
+  report.numJobs = pool->getNumJobsRun() - jobsBefore;
+  report.numStolen = pool->getNumJobsStolen() - stolenBefore;
+
+  std::sort (blockMicros.begin(), blockMicros.end());
+  const auto percentile = [&blockMicros] (double p)
+	{
+	  return blockMicros[(size_t) juce::jlimit (0, (int) blockMicros.size() - 1,
+												(int) std::ceil (p * (double) blockMicros.size()) - 1)];
+	};
+  report.p50Micros = percentile (0.50);
+  report.p99Micros = percentile (0.99);
+  report.maxMicros = blockMicros.back();
+
+  return report;
+}
+
+//==============================================================================
+juce::String ClassroomServer::formatReportHeader()
+{
+  return "students threads block  budget(us)  p50(us)  p99(us)  max(us)  min slack(us)   late (worst)  cores busy  stolen  sessions/core";
+}
+
+juce::String ClassroomServer::formatReport (const Report& r)
+{
+  const auto pad = [] (const juce::String& s, int width) { return s.paddedLeft (' ', width); };
+
+  return pad (juce::String (r.settings.numStudents), 8)
+	+ pad (juce::String (r.settings.numThreads), 8)
+	+ pad (juce::String (r.settings.blockSize), 6)
+	+ pad (juce::String (r.budgetMicros, 1), 12)
+	+ pad (juce::String (r.p50Micros, 1), 9)
+	+ pad (juce::String (r.p99Micros, 1), 9)
+	+ pad (juce::String (r.maxMicros, 1), 9)
+	+ pad (juce::String (r.minSlackMicros, 1), 15)
+	+ pad (juce::String (r.numLate) + " (" + juce::String (r.worstStudentLate) + ")", 15)
+	+ pad (juce::String (r.coresBusy, 2), 12)
+	+ pad (juce::String (r.numJobs > 0 ? 100.0 * (double) r.numStolen / (double) r.numJobs : 0.0, 1) + "%", 8)
+	+ pad (juce::String (r.sessionsPerCore, 1), 15);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+#include "WorkStealingPool.h"
+
+//==============================================================================
+/*
+  Runs a whole class at once with no audio device: one LooperAudioSource
+  per student, each with its own phrase, guess buffer and scoring, and each
+  taking its MIDI from a socket instead of an input device.
+
+  A student connects with a juce::InterprocessConnection and sends raw MIDI
+  bytes in its messages (running status is understood, sysex skipped). The
+  bytes go into that student's MidiInputQueue as they arrive, stamped with
+  the time, just as a MIDI input's callback would put them.
+
+  play drives every engine in real time: every block period each student's
+  next block is handed to a WorkStealingPool, and it has until the end of
+  that period, when a sound card would have taken it, to be rendered. A
+  block finished after that is counted late; a student that falls behind
+  catches up on the same worker, so the engine's state never skips a block.
+
+  Besides the pool's workers, the engines share one guess evaluator thread,
+  one sample streaming thread and one set of wavetables. Each connection
+  still has a thread of its own, but it only ever waits on its socket.
+*/
+class ClassroomServer : private juce::InterprocessConnectionServer
+{
+public:
+  struct Settings
+  {
+	double sampleRate = 48000.0;
+	int blockSize = 256;
+	int numChannels = 2;
+	int numStudents = 8;
+	int numThreads = juce::SystemStats::getNumCpus();
+	int port = 0;                               // 0 picks a free one
+	Transport::Settings transport;
+	int numVoices = LooperAudioSource::defaultNumVoices;
+	const ResourceLoader* resources = nullptr;  // phrases and grooves, shared read-only
+  };
+
+  struct Report
+  {
+	Settings settings;
+	int numBlocks = 0;                         // per student
+	int numConnected = 0;
+	double seconds = 0.0;
+	double budgetMicros = 0.0;                 // duration of one block
+	double p50Micros = 0.0, p99Micros = 0.0, maxMicros = 0.0;   // one student's block
+	double minSlackMicros = 0.0;               // closest any block came to its deadline
+	int numLate = 0, worstStudentLate = 0;     // blocks finished after their deadline
+	double coresBusy = 0.0;                    // render time / wall time
+	double sessionsPerCore = 0.0;              // students / coresBusy: what one core carries
+	juce::int64 numJobs = 0, numStolen = 0;
+	int numMidiMessages = 0;
+
+	double getLateFraction() const noexcept    { return numBlocks > 0 ? numLate / ((double) numBlocks * settings.numStudents) : 0.0; }
+  };
+
+  ClassroomServer();
+  ~ClassroomServer() override;
+
+  // Builds and prepares the engines and starts listening on the loopback
+  // interface; the error says why not
+  bool start (const Settings&, juce::String& error);
+  void stop();
+
+  int getPort() const noexcept;
+  int getNumConnected() const noexcept;
+  // Waits for this many students to connect; false if they didn't in time
+  bool waitForStudents (int numStudents, int timeoutMs) const;
+
+  // Plays for this long, on the calling thread's clock
+  Report play (double seconds);
+
+  static juce::String formatReportHeader();
+  static juce::String formatReport (const Report&);
+
+private:
+  class Student;
+
+  juce::InterprocessConnection* createConnectionObject() override;
+
+  Settings settings;
+  std::vector<std::unique_ptr<Student>> students;
+  std::unique_ptr<WorkStealingPool> pool;
+  std::atomic<int> numConnectionsMade { 0 };
+  bool listening = false;
+
+  JUCE_DECLARE_NON_COPYABLE (ClassroomServer)
+};
@@ -0,0 +1,231 @@
+#include "EngineLog.h"
+#include "AllocationTracker.h"
+#include <iostream>
+
+namespace
+{
+  struct Record
+  {
+	double time;
+	EngineLog::Level level;
+	const char* format;
+	int numArguments;
+
+	// a text argument keeps the offset of its copy in text, in integer
+	EngineLog::Argument::Type types[EngineLog::maxArguments];
+	union Value
+	{
+	  juce::int64 integer;
+	  double real;
+	} values[EngineLog::maxArguments];
+
+	char text[EngineLog::maxTextLength];
+  };
+
+  struct Ring
+  {
+	juce::SpinLock writeLock;
+	juce::AbstractFifo fifo { EngineLog::capacity };
+	Record records[EngineLog::capacity];
+  };
+
+  Ring audioRing, sharedRing;
+  std::atomic<int> numDropped { 0 }, numWriters { 0 };
+  std::atomic<int> minimumLevel { (int) EngineLog::Level::debug };
+  juce::CriticalSection readLock;
+  int numDroppedReported = 0;   // guarded by readLock
+  const double startTime = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+  void fillRecord (Record& record, EngineLog::Level level, const char* format,
+				   const EngineLog::Argument* arguments, int numArguments) noexcept
+  {
+	record.time = juce::Time::getMillisecondCounterHiRes() * 0.001 - startTime;
+	record.level = level;
+	record.format = format;
+	record.numArguments = numArguments;
+
+	int textUsed = 0;
+
+	for (int i = 0; i < numArguments; ++i)
+	  {
+		const auto& argument = arguments[i];
+		record.types[i] = argument.type;
+
+		if (argument.type == EngineLog::Argument::Type::real)
+		  {
+			record.values[i].real = argument.real;
+		  }
+		else if (argument.type == EngineLog::Argument::Type::text)
+		  {
+			// once the buffer is full, later strings all point at its last, empty, byte
+			auto end = juce::jmin (textUsed, EngineLog::maxTextLength - 1);
+			record.values[i].integer = end;
+
+			for (auto* c = argument.text; *c != 0 && end < EngineLog::maxTextLength - 1; ++c)
+			  record.text[end++] = *c;
+
+			record.text[end] = 0;
+			textUsed = end + 1;
+		  }
+		else
+		  {
+			record.values[i].integer = argument.integer;
+		  }
+	  }
+  }
+
+  // to three places, without the zeros on the end
+  juce::String formatReal (double value)
+  {
+	return juce::String (value, 3).trimCharactersAtEnd ("0").trimCharactersAtEnd (".");
+  }
+
+  juce::String formatRecord (const Record& record)
+  {
+	static const char* const levelNames[] { "debug", "info", "warning", "ERROR" };
+
+	juce::String message;
+	int argument = 0;
+
+	for (auto* c = record.format; *c != 0; ++c)
+	  {
+		if (c[0] == '{' && c[1] == '}' && argument < record.numArguments)
+		  {
+			const auto& value = record.values[argument];
+
+			switch (record.types[argument++])
+			  {
+			  case EngineLog::Argument::Type::integer: message << value.integer; break;
+			  case EngineLog::Argument::Type::real:    message << formatReal (value.real); break;
+			  case EngineLog::Argument::Type::text:    message << juce::String::fromUTF8 (record.text + value.integer); break;
+			  case EngineLog::Argument::Type::none:    break;
+			  }
+
+			++c;
+		  }
+		else
+		  {
+			message << *c;
+		  }
+	  }
+
+	return juce::String (record.time, 3).paddedLeft (' ', 10) + " "
+	  + juce::String (levelNames[(int) record.level]).paddedRight (' ', 7) + " " + message + "\n";
+  }
+
+  bool pushRecord (Ring& ring, EngineLog::Level level, const char* format,
+				   const EngineLog::Argument* arguments, int numArguments) noexcept
+  {
+	int start1, size1, start2, size2;
+	ring.fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+	if (size1 == 0)
+	  return false;
+
+	fillRecord (ring.records[start1], level, format, arguments, numArguments);
+	ring.fifo.finishedWrite (1);
+	return true;
+  }
+
+  const Record* peek (Ring& ring) noexcept
+  {
+	int start1, size1, start2, size2;
+	ring.fifo.prepareToRead (1, start1, size1, start2, size2);
+	return size1 > 0 ? &ring.records[start1] : nullptr;
+  }
+}
+
+//==============================================================================
+void EngineLog::push (Level level, const char* format, const Argument* arguments, int numArguments) noexcept
+{
+  if ((int) level < minimumLevel.load (std::memory_order_relaxed))
+	return;
+
+  if (AllocationTracker::isInsideAudioCallback())
+	{
+	  // never waits: if another audio thread is writing, this message goes
+	  const juce::SpinLock::ScopedTryLockType lock (audioRing.writeLock);
+
+	  if (! lock.isLocked() || ! pushRecord (audioRing, level, format, arguments, numArguments))
+		++numDropped;
+
+	  return;
+	}
+
+  {
+	const juce::SpinLock::ScopedLockType lock (sharedRing.writeLock);
+
+	if (! pushRecord (sharedRing, level, format, arguments, numArguments))
+	  ++numDropped;
+  }
+
+  if (numWriters.load() == 0)
+	flush();
+}
+
+void EngineLog::flush()
+{
+  const juce::ScopedLock sl (readLock);
+  juce::String output;
+
+  // the two rings are merged back into the order the messages were written in
+  for (;;)
+	{
+	  const auto* fromAudio = peek (audioRing);
+	  const auto* fromShared = peek (sharedRing);
+
+	  if (fromAudio == nullptr && fromShared == nullptr)
+		break;
+
+	  auto& ring = fromAudio != nullptr && (fromShared == nullptr || fromAudio->time <= fromShared->time)
+		? audioRing : sharedRing;
+
+	  output << formatRecord (*peek (ring));
+	  ring.fifo.finishedRead (1);
+	}
+
+  const auto dropped = numDropped.load();
+
+  if (dropped != numDroppedReported)
+	{
+	  output << "log: " << (dropped - numDroppedReported) << " messages dropped\n";
+	  numDroppedReported = dropped;
+	}
+
+  if (output.isNotEmpty())
+	std::cout << output << std::flush;
+}
+
+int EngineLog::getNumDropped() noexcept
+{
+  return numDropped.load();
+}
+
+void EngineLog::setMinimumLevel (Level level) noexcept
+{
+  minimumLevel.store ((int) level);
+}
+
+//==============================================================================
+EngineLog::ScopedWriter::ScopedWriter()
+  : juce::Thread ("Log writer")
+{
+  ++numWriters;
+  startThread (2);
+}
+
+EngineLog::ScopedWriter::~ScopedWriter()
+{
+  stopThread (1000);
+  --numWriters;
+  flush();
+}
+
+void EngineLog::ScopedWriter::run()
+{
+  while (! threadShouldExit())
+	{
+	  flush();
+	  wait (50);
+	}
+}
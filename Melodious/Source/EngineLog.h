@@ -0,0 +1,97 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Logging that the audio thread can use. A message is a string literal with
+  a {} for each of its arguments, which are numbers or short strings; writing
+  one only copies the literal's address and the arguments into a fixed-size
+  record in a ring buffer. The formatting, the timestamp and the write to
+  std::cout all happen later, on the ScopedWriter's thread.
+
+  Inside the audio callback (an AllocationTracker::ScopedAudioCallback) a
+  message goes into a ring of its own with a try-lock, so the audio thread
+  never waits: if the ring is full or another audio thread is writing, the
+  message is dropped and counted. Other threads share a second ring.
+
+  Without a ScopedWriter running, messages from other threads are printed
+  straight away, along with anything the audio thread has left; nothing
+  drains the audio ring by itself, so a headless tool that logs from inside
+  the callback has to call flush.
+*/
+class EngineLog
+{
+public:
+  enum class Level { debug, info, warning, error };
+
+  static constexpr int maxArguments = 4, maxTextLength = 160, capacity = 1024;
+
+  struct Argument
+  {
+	enum class Type { none, integer, real, text };
+
+	Argument() noexcept                           : type (Type::none), integer (0) {}
+	template <typename Integer, typename std::enable_if<std::is_integral<Integer>::value, int>::type = 0>
+	Argument (Integer value) noexcept             : type (Type::integer), integer ((juce::int64) value) {}
+	Argument (double value) noexcept              : type (Type::real), real (value) {}
+	Argument (float value) noexcept               : type (Type::real), real (value) {}
+	// copied into the record, and cut short if it doesn't fit
+	Argument (const char* value) noexcept         : type (Type::text), text (value) {}
+	Argument (const juce::String& value) noexcept : type (Type::text), text (value.toRawUTF8()) {}
+
+	Type type;
+	union
+	{
+	  juce::int64 integer;
+	  double real;
+	  const char* text;
+	};
+  };
+
+  template <typename... Arguments>
+  static void write (Level level, const char* format, const Arguments&... arguments) noexcept
+  {
+	static_assert (sizeof... (Arguments) <= maxArguments, "too many arguments for one log message");
+	const Argument args[] { Argument (arguments)..., Argument() };
+	push (level, format, args, (int) sizeof... (Arguments));
+  }
+
+  template <typename... Arguments>
+  static void info (const char* format, const Arguments&... arguments) noexcept
+  {
+	write (Level::info, format, arguments...);
+  }
+
+  template <typename... Arguments>
+  static void error (const char* format, const Arguments&... arguments) noexcept
+  {
+	write (Level::error, format, arguments...);
+  }
+
+  // Formats and prints everything waiting. Not for the audio thread.
+  static void flush();
+
+  // Messages dropped because a ring was full
+  static int getNumDropped() noexcept;
+
+  // Messages below this level are left out; everything is kept by default
+  static void setMinimumLevel (Level) noexcept;
+
+  //==============================================================================
+  // Prints the log from a background thread for as long as it exists
+  class ScopedWriter : private juce::Thread
+  {
+  public:
+	ScopedWriter();
+	~ScopedWriter() override;
+
+  private:
+	void run() override;
+
+	JUCE_DECLARE_NON_COPYABLE (ScopedWriter)
+  };
+
+private:
+  static void push (Level, const char* format, const Argument*, int numArguments) noexcept;
+};
@@ -0,0 +1,149 @@
+#include "GuessEvaluator.h"
+#include "LooperAudioSource.h"
+#include "AllocationTracker.h"
+
+//==============================================================================
+// Looks in on every started evaluator in turn, like the sample streamer does
+// its streams; handling a message only ever takes a phrase's worth of work.
+class GuessEvaluator::SharedThread : private juce::Thread
+{
+public:
+  SharedThread()
+	: juce::Thread ("Guess evaluator")
+  {
+	startThread();
+  }
+
+  ~SharedThread() override
+  {
+	stopThread (2000);
+  }
+
+  void add (GuessEvaluator* evaluator)
+  {
+	const juce::ScopedLock sl (lock);
+	evaluators.addIfNotAlreadyThere (evaluator);
+  }
+
+  // Waits for a message being handled to finish
+  void remove (GuessEvaluator* evaluator)
+  {
+	const juce::ScopedLock sl (lock);
+	evaluators.removeFirstMatchingValue (evaluator);
+  }
+
+private:
+  void run() override
+  {
+	while (! threadShouldExit())
+	  {
+		auto numHandled = 0;
+
+		{
+		  const juce::ScopedLock sl (lock);
+
+		  for (auto* evaluator : evaluators)
+			numHandled += evaluator->service();
+		}
+
+		if (numHandled == 0)
+		  wait (5);
+	  }
+  }
+
+  juce::CriticalSection lock;   // guards evaluators; never taken on the audio thread
+  juce::Array<GuessEvaluator*> evaluators;
+
+  JUCE_DECLARE_NON_COPYABLE (SharedThread)
+};
+
+//==============================================================================
+GuessEvaluator::GuessEvaluator (LooperAudioSource& source)
+  : owner (source) {}
+
+GuessEvaluator::~GuessEvaluator()
+{
+  stop();
+}
+
+void GuessEvaluator::start()
+{
+  if (! synchronous)
+	thread->add (this);
+}
+
+void GuessEvaluator::stop()
+{
+  thread->remove (this);
+  fifo.reset();
+}
+
+bool GuessEvaluator::postNote (const GuessScorer::NoteScore& score) noexcept
+{
+  ScoreMessage message;
+  message.type = ScoreMessage::Type::note;
+  message.note = score;
+  return post (message);
+}
+
+bool GuessEvaluator::postEndOfPhrase (int loopLength, int notesGotRight, int notesInTotal,
+									  float harmonyAccuracy) noexcept
+{
+  ScoreMessage message;
+  message.type = ScoreMessage::Type::endOfPhrase;
+  message.loopLength = loopLength;
+  message.notesGotRight = notesGotRight;
+  message.notesInTotal = notesInTotal;
+  message.harmonyAccuracy = harmonyAccuracy;
+  return post (message);
+}
+
+bool GuessEvaluator::post (const ScoreMessage& message) noexcept
+{
+  if (synchronous)
+	{
+	  // as if on the evaluator's thread: the log writes go to the ring no
+	  // writer has to drain, and the new phrase's allocations aren't the
+	  // audio callback's
+	  const AllocationTracker::ScopedOutsideAudioCallback outside;
+	  handle (message);
+	  return true;
+	}
+
+  int start1, size1, start2, size2;
+  fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+  if (size1 == 0)
+	return false;
+
+  messages[start1] = message;
+  fifo.finishedWrite (1);
+  return true;
+}
+
+int GuessEvaluator::service()
+{
+  auto numHandled = 0;
+
+  for (;;)
+	{
+	  int start1, size1, start2, size2;
+	  fifo.prepareToRead (1, start1, size1, start2, size2);
+
+	  if (size1 == 0)
+		return numHandled;
+
+	  handle (messages[start1]);
+	  fifo.finishedRead (1);
+	  ++numHandled;
+	}
+}
+
+void GuessEvaluator::handle (const ScoreMessage& message)
+{
+  if (message.type == ScoreMessage::Type::note)
+	owner.noteScored (message.note);
+  else
+	owner.phraseScored (message.loopLength, message.notesGotRight, message.notesInTotal,
+						message.harmonyAccuracy);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "GuessScorer.h"
+
+class LooperAudioSource;
+
+// What the audio thread's GuessScorer hands over: a note's score as soon as
+// the note is over, and once the whole phrase has been scored, the totals.
+struct ScoreMessage
+{
+  enum class Type { note, endOfPhrase };
+
+  Type type = Type::note;
+  GuessScorer::NoteScore note {};       // for Type::note
+  int loopLength = 0;                   // the rest for Type::endOfPhrase, in ticks
+  int notesGotRight = 0, notesInTotal = 0;
+  float harmonyAccuracy = 0.0f;
+};
+
+//==============================================================================
+/*
+  Reports the scores and builds the next phrase off the audio thread so none
+  of that work happens inside the audio callback. The audio thread hands over
+  ScoreMessages through a lock-free single-producer/single-consumer FIFO;
+  the next phrase is published back through LooperAudioSource's phrase slots.
+
+  Every evaluator in the process is served by one shared thread, so a server
+  running a class of engines doesn't start a thread per student.
+*/
+class GuessEvaluator
+{
+public:
+  GuessEvaluator (LooperAudioSource&);
+  ~GuessEvaluator();
+
+  void start();
+  // Once it returns, no message is being handled and none is left queued
+  void stop();
+  // Off the audio device, replaying a session, each message is handled as
+  // it's posted, on the posting thread but outside its audio callback, and
+  // start doesn't hand it to the thread. Set it while stopped.
+  void setSynchronous (bool shouldHandleOnPost) noexcept   { synchronous = shouldHandleOnPost; }
+
+  // Audio thread only. Both return false, leaving the message to be posted
+  // again, if the FIFO is full.
+  bool postNote (const GuessScorer::NoteScore&) noexcept;
+  bool postEndOfPhrase (int loopLength, int notesGotRight, int notesInTotal,
+						float harmonyAccuracy) noexcept;
+
+private:
+  class SharedThread;
+
+  bool post (const ScoreMessage&) noexcept;
+  void handle (const ScoreMessage&);
+  // The shared thread. Handles what's queued, returning how many there were.
+  int service();
+
+  // every note of a phrase and its end, should the thread not get to any of
+  // them before the phrase is over; a FIFO holds one less than its size
+  static constexpr int numMessages = GuessScorer::maxNotes + 2;
+
+  LooperAudioSource& owner;
+  juce::SharedResourcePointer<SharedThread> thread;
+  bool synchronous = false;
+  juce::AbstractFifo fifo { numMessages };
+  ScoreMessage messages[numMessages];
+
+  JUCE_DECLARE_NON_COPYABLE (GuessEvaluator)
+};
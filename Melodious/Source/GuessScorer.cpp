@@ -0,0 +1,300 @@
+#include "GuessScorer.h"
+#include <algorithm>
+#include <limits>
+
+//==============================================================================
+void NoteSpans::reserve (int capacity)
+{
+  start.resize ((size_t) capacity);
+  end.resize ((size_t) capacity);
+  pitch.resize ((size_t) capacity);
+  velocity.resize ((size_t) capacity);
+  size = juce::jmin (size, capacity);
+}
+
+int NoteSpans::add (float noteStart, float noteEnd, int notePitch, int noteVelocity) noexcept
+{
+  if (size >= (int) start.size())
+	return -1;
+
+  start[(size_t) size] = noteStart;
+  end[(size_t) size] = noteEnd;
+  pitch[(size_t) size] = (juce::uint8) notePitch;
+  velocity[(size_t) size] = (juce::uint8) noteVelocity;
+  return size++;
+}
+
+//==============================================================================
+GuessScorer::Target GuessScorer::createTarget (const Pattern& phrase, int loopLengthInTicks)
+{
+  struct Span { int start, end, pitch, velocity; };
+  std::vector<Span> spans;
+  int open[16][128];
+  std::fill (&open[0][0], &open[0][0] + 16 * 128, -1);
+
+  // pair each note-on with the next off for the same key on the same channel
+  for (const auto& event : phrase.getEvents())
+	{
+	  auto& index = open[(event.channel - 1) & 15][event.noteNumber & 127];
+
+	  if (index >= 0)
+		{
+		  spans[(size_t) index].end = event.tick;
+		  index = -1;
+		}
+
+	  if (event.isNoteOn && (int) spans.size() < maxNotes)
+		{
+		  index = (int) spans.size();
+		  spans.push_back ({ event.tick, loopLengthInTicks, event.noteNumber, event.velocity });
+		}
+	}
+
+  spans.erase (std::remove_if (spans.begin(), spans.end(), [] (const Span& s) { return s.end <= s.start; }),
+			   spans.end());
+  std::stable_sort (spans.begin(), spans.end(), [] (const Span& a, const Span& b) { return a.start < b.start; });
+
+  Target result;
+  result.notes.reserve ((int) spans.size());
+
+  for (const auto& s : spans)
+	{
+	  result.notes.add ((float) s.start, (float) s.end, s.pitch, s.velocity);
+	  result.boundaries.push_back ((float) s.start);
+	  result.boundaries.push_back ((float) s.end);
+	}
+
+  for (int i = 0; i < (int) spans.size(); ++i)
+	result.notesByEnd.push_back (i);
+
+  std::stable_sort (result.notesByEnd.begin(), result.notesByEnd.end(),
+					[&spans] (int a, int b) { return spans[(size_t) a].end < spans[(size_t) b].end; });
+
+  std::sort (result.boundaries.begin(), result.boundaries.end());
+  result.boundaries.erase (std::unique (result.boundaries.begin(), result.boundaries.end()),
+						   result.boundaries.end());
+
+  for (size_t slice = 0; slice + 1 < result.boundaries.size(); ++slice)
+	{
+	  juce::uint16 mask = 0;
+
+	  for (const auto& s : spans)
+		if ((float) s.start <= result.boundaries[slice] && (float) s.end >= result.boundaries[slice + 1])
+		  mask |= (juce::uint16) (1 << (s.pitch % 12));
+
+	  result.sliceMasks.push_back (mask);
+	}
+
+  return result;
+}
+
+//==============================================================================
+GuessScorer::GuessScorer()
+{
+  guesses.reserve (maxNotes);
+  heldTicks.resize ((size_t) maxNotes);
+  guessStart.resize ((size_t) maxNotes);
+  guessEnd.resize ((size_t) maxNotes);
+  overlap.resize ((size_t) maxNotes);
+  activeGuesses.resize ((size_t) maxNotes);
+  activeNotes.resize ((size_t) maxNotes);
+  activeNotePosition.resize ((size_t) maxNotes);
+  std::fill (std::begin (keyDown), std::end (keyDown), false);
+  std::fill (std::begin (keysDownInClass), std::end (keysDownInClass), 0);
+  std::fill (std::begin (openGuess), std::end (openGuess), -1);
+}
+
+void GuessScorer::begin (const Target& newTarget) noexcept
+{
+  target = &newTarget;
+  numTargets = juce::jmin (newTarget.notes.size, (int) maxNotes);
+  numScored = 0;
+  numRight = 0;
+  nextSlice = 0;
+  harmonyTicks = harmonyTicksRight = 0.0f;
+
+  guesses.clear();
+  std::fill (std::begin (keyDown), std::end (keyDown), false);
+  std::fill (std::begin (keysDownInClass), std::end (keysDownInClass), 0);
+  std::fill (std::begin (openGuess), std::end (openGuess), -1);
+  std::fill (heldTicks.begin(), heldTicks.end(), 0.0f);
+  numActiveGuesses = numActiveNotes = 0;
+  nextNewGuess = nextNoteToStart = nextNoteToEnd = 0;
+}
+
+void GuessScorer::addEvent (int tick, int noteNumber, bool isNoteOn, int velocity) noexcept
+{
+  if (! juce::isPositiveAndBelow (noteNumber, 128))
+	return;
+
+  advanceTo (tick);
+
+  // a key that's already down isn't started again, nor one that's up stopped
+  if (keyDown[noteNumber] == isNoteOn)
+	return;
+
+  keyDown[noteNumber] = isNoteOn;
+
+  const auto pitchClass = noteNumber % 12;
+  auto& open = openGuess[pitchClass];
+
+  if (isNoteOn)
+	{
+	  // past maxNotes, guesses are dropped
+	  if (keysDownInClass[pitchClass]++ == 0)
+		open = guesses.add ((float) tick, std::numeric_limits<float>::max(), noteNumber, velocity);
+	}
+  else if (--keysDownInClass[pitchClass] == 0 && open >= 0)
+	{
+	  guesses.end[(size_t) open] = (float) tick;
+	  open = -1;
+	}
+}
+
+void GuessScorer::advanceTo (int tick) noexcept
+{
+  if (target == nullptr)
+	return;
+
+  const auto& boundaries = target->boundaries;
+
+  while (nextSlice + 1 < (int) boundaries.size() && boundaries[(size_t) nextSlice + 1] <= (float) tick)
+	{
+	  scoreSlice (nextSlice++);
+	  scoreFinishedNotes (boundaries[(size_t) nextSlice]);
+	}
+}
+
+float GuessScorer::getHarmonyAccuracy() const noexcept
+{
+  return harmonyTicks > 0.0f ? harmonyTicksRight / harmonyTicks : 0.0f;
+}
+
+// Guesses come in start order, so the new ones are those past nextNewGuess;
+// one that ended by the start of the slice can't overlap it or any after it.
+// Only a pitch class's current guess and those that ended inside the last
+// slice are ever left, a dozen or so.
+void GuessScorer::updateActiveGuesses (float sliceStart) noexcept
+{
+  for (; nextNewGuess < guesses.size; ++nextNewGuess)
+	activeGuesses[(size_t) numActiveGuesses++] = nextNewGuess;
+
+  for (int i = 0; i < numActiveGuesses;)
+	{
+	  if (guesses.end[(size_t) activeGuesses[(size_t) i]] <= sliceStart)
+		activeGuesses[(size_t) i] = activeGuesses[(size_t) --numActiveGuesses];
+	  else
+		++i;
+	}
+}
+
+// The notes sounding through a slice are those that started by its start and
+// haven't ended by then: they come in through the start order and go out
+// through notesByEnd.
+void GuessScorer::updateActiveNotes (float sliceStart) noexcept
+{
+  const auto& notes = target->notes;
+
+  for (; nextNoteToStart < numTargets && notes.start[(size_t) nextNoteToStart] <= sliceStart; ++nextNoteToStart)
+	{
+	  activeNotePosition[(size_t) nextNoteToStart] = numActiveNotes;
+	  activeNotes[(size_t) numActiveNotes++] = nextNoteToStart;
+	}
+
+  for (; nextNoteToEnd < numTargets; ++nextNoteToEnd)
+	{
+	  const auto index = target->notesByEnd[(size_t) nextNoteToEnd];
+
+	  if (notes.end[(size_t) index] > sliceStart)
+		break;
+
+	  // started before it ended, so it's in the list; the last one takes its place
+	  const auto position = activeNotePosition[(size_t) index];
+	  const auto last = activeNotes[(size_t) --numActiveNotes];
+	  activeNotes[(size_t) position] = last;
+	  activeNotePosition[(size_t) last] = position;
+	}
+}
+
+// One slice: how long each pitch class sounded in it, from a vectorised
+// overlap pass over the guesses still sounding, then credited to the target
+// notes that span it.
+void GuessScorer::scoreSlice (int slice) noexcept
+{
+  const auto sliceStart = target->boundaries[(size_t) slice];
+  const auto sliceEnd = target->boundaries[(size_t) slice + 1];
+  const auto length = sliceEnd - sliceStart;
+  float pitchClassTicks[12] = {};
+
+  updateActiveGuesses (sliceStart);
+  updateActiveNotes (sliceStart);
+
+  if (numActiveGuesses > 0)
+	{
+	  for (int i = 0; i < numActiveGuesses; ++i)
+		{
+		  const auto guess = (size_t) activeGuesses[(size_t) i];
+		  guessStart[(size_t) i] = guesses.start[guess];
+		  guessEnd[(size_t) i] = guesses.end[guess];
+		}
+
+	  juce::FloatVectorOperations::min (guessEnd.data(), guessEnd.data(), sliceEnd, numActiveGuesses);
+	  juce::FloatVectorOperations::max (guessStart.data(), guessStart.data(), sliceStart, numActiveGuesses);
+	  juce::FloatVectorOperations::subtract (overlap.data(), guessEnd.data(), guessStart.data(), numActiveGuesses);
+	  juce::FloatVectorOperations::max (overlap.data(), overlap.data(), 0.0f, numActiveGuesses);
+
+	  for (int i = 0; i < numActiveGuesses; ++i)
+		pitchClassTicks[guesses.pitch[(size_t) activeGuesses[(size_t) i]] % 12] += overlap[(size_t) i];
+	}
+
+  juce::uint16 guessMask = 0;
+
+  for (int pitchClass = 0; pitchClass < 12; ++pitchClass)
+	{
+	  if (pitchClassTicks[pitchClass] * 2.0f >= length)
+		guessMask |= (juce::uint16) (1 << pitchClass);
+	}
+
+  const auto targetMask = target->sliceMasks[(size_t) slice];
+
+  if (targetMask != 0)
+	{
+	  harmonyTicks += length;
+
+	  if (guessMask == targetMask)
+		harmonyTicksRight += length;
+	}
+
+  // every boundary is a start or an end, so a note sounding at the slice's
+  // start sounds all the way through it
+  const auto& notes = target->notes;
+
+  for (int i = 0; i < numActiveNotes; ++i)
+	{
+	  const auto note = (size_t) activeNotes[(size_t) i];
+	  heldTicks[note] += pitchClassTicks[notes.pitch[note] % 12];
+	}
+}
+
+void GuessScorer::scoreFinishedNotes (float tick) noexcept
+{
+  const auto& notes = target->notes;
+
+  while (numScored < numTargets)
+	{
+	  const auto index = target->notesByEnd[(size_t) numScored];
+
+	  if (notes.end[(size_t) index] > tick)
+		break;
+
+	  auto& score = scores[numScored];
+	  score.index = index;
+	  score.span = { (int) notes.start[(size_t) index], (int) notes.end[(size_t) index], notes.pitch[(size_t) index] };
+	  score.ticksHeld = juce::roundToInt (heldTicks[(size_t) index]);
+
+	  if (score.isRight())
+		++numRight;
+
+	  ++numScored;
+	}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PatternSequencer.h"
+
+//==============================================================================
+/*
+  Note spans kept as parallel arrays rather than an array of structs, so a
+  pass over one field of every note runs straight through memory and
+  vectorises (here through FloatVectorOperations). Ticks are stored as
+  floats for the same reason; they're exact far beyond any loop length.
+
+  The arrays are sized once by reserve, and add never grows them, so the
+  audio thread can fill one in.
+*/
+struct NoteSpans
+{
+  void reserve (int capacity);
+  void clear() noexcept                   { size = 0; }
+  // Returns the new note's index, or -1 when the arrays are full
+  int add (float start, float end, int pitch, int velocity) noexcept;
+
+  int size = 0;
+  std::vector<float> start, end;          // in ticks from the start of the loop
+  std::vector<juce::uint8> pitch, velocity;
+};
+
+//==============================================================================
+/*
+  Scores the student's playing against a phrase while they play it, chords
+  and several voices included.
+
+  The phrase's notes are cut into time slices at every note start and end,
+  and in each slice the pitch classes the student is sounding are compared
+  with the phrase's. A note's score is how much of it had its pitch class
+  sounding, in any octave; separately, the time the student's set of pitch
+  classes matched the phrase's exactly is added up as the harmony score.
+
+  Slices are scored as soon as the playing passes their end, and a note as
+  soon as its last slice is scored, so feedback comes while the loop is
+  still going and there's nothing left to do when it comes round.
+
+  Everything the audio thread calls is allocation-free.
+*/
+class GuessScorer
+{
+public:
+  static constexpr int maxNotes = 512;
+  // the share of a note's span its pitch class has to be sounding for
+  static constexpr float passThreshold = 0.3f;
+
+  struct NoteSpan
+  {
+	int start, end;    // in ticks from the start of the loop
+	int noteNumber;
+  };
+
+  struct NoteScore
+  {
+	int index;         // which of the phrase's notes this is
+	NoteSpan span;
+	int ticksHeld;     // how much of the span its pitch class was sounding for
+
+	float getAccuracy() const noexcept  { return (float) ticksHeld / (float) (span.end - span.start); }
+	bool isRight() const noexcept       { return getAccuracy() > passThreshold; }
+  };
+
+  // A phrase as the scorer sees it. Built off the audio thread when the
+  // phrase is, and left alone while it's being scored against.
+  struct Target
+  {
+	NoteSpans notes;                        // sorted by start
+	std::vector<int> notesByEnd;            // note indices in the order they end
+	std::vector<float> boundaries;          // every start and end, sorted, no repeats
+	std::vector<juce::uint16> sliceMasks;   // the pitch classes sounding in each slice
+  };
+
+  static Target createTarget (const Pattern& phrase, int loopLengthInTicks);
+
+  GuessScorer();
+
+  // Starts scoring against a target, which has to stay put until the
+  // scorer is finished with it.
+  void begin (const Target&) noexcept;
+
+  // Events have to come in time order; addEvent calls advanceTo first.
+  void addEvent (int tick, int noteNumber, bool isNoteOn, int velocity) noexcept;
+  // Scores every slice, and every note, that ends at or before tick
+  void advanceTo (int tick) noexcept;
+
+  bool isFinished() const noexcept                   { return numScored >= numTargets; }
+  int getNumTargets() const noexcept                 { return numTargets; }
+  int getNumScored() const noexcept                  { return numScored; }
+  const NoteScore& getScore (int index) const noexcept { return scores[index]; }
+  int getNumRight() const noexcept                   { return numRight; }
+  // The share of the phrase's sounding time the student's pitch classes matched it
+  float getHarmonyAccuracy() const noexcept;
+
+private:
+  void scoreSlice (int slice) noexcept;
+  void scoreFinishedNotes (float tick) noexcept;
+  void updateActiveGuesses (float sliceStart) noexcept;
+  void updateActiveNotes (float sliceStart) noexcept;
+
+  const Target* target = nullptr;
+  int numTargets = 0, numScored = 0, numRight = 0;
+  int nextSlice = 0;
+  float harmonyTicks = 0.0f, harmonyTicksRight = 0.0f;
+
+  // A guess is a stretch of time a pitch class was sounding, in however many
+  // octaves, so that the guesses for one pitch class never overlap.
+  NoteSpans guesses;
+  bool keyDown[128];
+  int keysDownInClass[12], openGuess[12];  // openGuess is -1 while a class is silent
+  std::vector<float> heldTicks;            // per target note
+  std::vector<float> guessStart, guessEnd, overlap;   // scratch, per active guess
+
+  // What can still overlap the next slice, kept up to date as the slices
+  // go by, so a slice costs the notes sounding in it rather than the loop's
+  std::vector<int> activeGuesses, activeNotes;
+  std::vector<int> activeNotePosition;     // per target note, its place in activeNotes
+  int numActiveGuesses = 0, numActiveNotes = 0;
+  int nextNewGuess = 0;                    // guesses before it are or were active
+  int nextNoteToStart = 0, nextNoteToEnd = 0;
+  NoteScore scores[maxNotes];
+};
@@ -0,0 +1,97 @@
+#include "LatencyCalibrator.h"
+#include <algorithm>
+
+void LatencyCalibrator::start() noexcept
+{
+  cancelRequested = false;
+  startRequested = true;
+}
+
+void LatencyCalibrator::cancel() noexcept
+{
+  startRequested = false;
+  cancelRequested = true;
+}
+
+void LatencyCalibrator::prepare (double newSampleRate) noexcept
+{
+  sampleRate = newSampleRate;
+  samplesPerClick = clickIntervalSeconds * sampleRate;
+  clickLength = juce::roundToInt (0.005 * sampleRate);
+
+  if (cancelRequested.exchange (false) && state.load() == State::running)
+	state = State::idle;
+
+  // the sample count restarts, so a run in progress starts over
+  if (state.load() == State::running)
+	startRequested = true;
+}
+
+LatencyCalibrator::Change LatencyCalibrator::renderNextBlock (juce::AudioBuffer<float>& buffer, int startSample,
+															  int numSamples, juce::int64 blockStart) noexcept
+{
+  auto change = Change::none;
+
+  if (startRequested.exchange (false))
+	{
+	  numTapsHeard = 0;
+	  firstClick = (double) blockStart + samplesPerClick;
+	  state = State::running;
+	  change = Change::started;
+	}
+  else if (cancelRequested.exchange (false) && state.load() == State::running)
+	{
+	  state = State::idle;
+	  change = Change::cancelled;
+	}
+
+  if (state.load() != State::running)
+	return change;
+
+  // a short decaying 1 kHz blip on every beat
+  const auto blockEnd = (double) (blockStart + numSamples);
+  auto click = std::ceil (((double) blockStart - clickLength - firstClick) / samplesPerClick);
+
+  for (auto clickStart = firstClick + juce::jmax (0.0, click) * samplesPerClick; clickStart < blockEnd;
+	   clickStart += samplesPerClick)
+	{
+	  const auto first = juce::jmax ((juce::int64) 0, (juce::int64) std::ceil (clickStart) - blockStart);
+	  const auto last = juce::jmin ((juce::int64) numSamples, (juce::int64) std::ceil (clickStart) + clickLength - blockStart);
+
+	  for (auto i = first; i < last; ++i)
+		{
+		  const auto t = (double) (blockStart + i) - clickStart;
+		  const auto sample = (float) (0.5 * std::sin (juce::MathConstants<double>::twoPi * 1000.0 * t / sampleRate)
+									   * (1.0 - t / clickLength));
+
+		  for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+			buffer.addSample (channel, startSample + (int) i, sample);
+		}
+	}
+
+  return change;
+}
+
+void LatencyCalibrator::addTap (double samplePosition) noexcept
+{
+  if (state.load() != State::running || samplePosition < firstClick - samplesPerClick * 0.25)
+	return;
+
+  // the click a quarter of a beat or less after the tap, or the one before it
+  const auto click = std::floor ((samplePosition - firstClick + samplesPerClick * 0.25) / samplesPerClick);
+  const auto offset = samplePosition - (firstClick + click * samplesPerClick);
+
+  const auto tap = numTapsHeard.load();
+  offsets[tap] = offset;
+  numTapsHeard = tap + 1;
+
+  if (tap + 1 < numTapsToIgnore + numTapsToMeasure)
+	return;
+
+  auto* measured = offsets + numTapsToIgnore;
+  std::sort (measured, measured + numTapsToMeasure);
+
+  const auto median = 0.5 * (measured[numTapsToMeasure / 2 - 1] + measured[numTapsToMeasure / 2]);
+  latencySeconds = juce::jmax (0.0, median / sampleRate);
+  state = State::finished;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Measures how late the student's playing arrives, from the sound leaving the
+  engine to their key press coming back in: it plays a click every
+  clickIntervalSeconds, whatever the transport's tempo (the loop is held
+  while it runs), and the student taps a key along with it. Each tap's
+  offset from the nearest click is one measurement; the first few are
+  thrown away while the student finds the beat, and the median of the rest
+  is the round-trip latency, which the looper then takes off every note it
+  scores.
+
+  start and cancel may be called from any thread and take effect at the
+  start of the next block; the rest runs on the audio thread.
+*/
+class LatencyCalibrator
+{
+public:
+  static constexpr int numTapsToIgnore = 2, numTapsToMeasure = 8;
+  static constexpr double clickIntervalSeconds = 0.5;
+
+  enum class State { idle, running, finished };
+  // What a block's start or cancel request did to it
+  enum class Change { none, started, cancelled };
+
+  LatencyCalibrator() = default;
+
+  void start() noexcept;
+  void cancel() noexcept;
+
+  State getState() const noexcept                   { return state.load(); }
+  int getNumTapsHeard() const noexcept               { return numTapsHeard.load(); }
+  // True if a run starts with the next block
+  bool isStartPending() const noexcept               { return startRequested.load(); }
+  // The measured latency, once the state is finished
+  double getLatencySeconds() const noexcept          { return latencySeconds.load(); }
+
+  // Audio thread
+  void prepare (double sampleRate) noexcept;
+  // Adds the clicks that fall in this block; blockStart counts samples since prepare
+  Change renderNextBlock (juce::AudioBuffer<float>&, int startSample, int numSamples, juce::int64 blockStart) noexcept;
+  // A key press, at the sample position the engine was at when it came in
+  void addTap (double samplePosition) noexcept;
+
+private:
+  std::atomic<State> state { State::idle };
+  std::atomic<bool> startRequested { false }, cancelRequested { false };
+  std::atomic<int> numTapsHeard { 0 };
+  std::atomic<double> latencySeconds { 0.0 };
+
+  double sampleRate = 44100.0, samplesPerClick = 22050.0;
+  double firstClick = -1.0;        // set on the first block after start
+  int clickLength = 0;
+  double offsets[numTapsToIgnore + numTapsToMeasure];
+};
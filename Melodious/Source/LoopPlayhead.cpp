@@ -0,0 +1,85 @@
+#include "LoopPlayhead.h"
+
+double LoopPlayhead::getHostTimeSeconds() noexcept
+{
+  return juce::Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+double LoopPlayhead::Position::getProgress() const noexcept
+{
+  return samplesPerLoop > 0 ? (double) positionInLoop / (double) samplesPerLoop : 0.0;
+}
+
+LoopPlayhead::Position LoopPlayhead::Position::extrapolatedTo (double timeSeconds) const noexcept
+{
+  // if the audio stops, stop the clock too rather than running away from it
+  const auto maxExtrapolationSeconds = 0.25;
+
+  auto result = *this;
+
+  if (sampleRate <= 0.0 || samplesPerLoop <= 0)
+	return result;
+
+  const auto elapsed = juce::jlimit (0.0, maxExtrapolationSeconds, timeSeconds - hostTimeSeconds);
+  const auto advance = (juce::int64) (elapsed * sampleRate);
+
+  result.samplePosition += advance;
+  result.hostTimeSeconds = timeSeconds;
+
+  auto newPosition = (juce::int64) positionInLoop + advance;
+
+  while (newPosition >= samplesPerLoop)
+	{
+	  newPosition -= samplesPerLoop;
+	  ++result.loopIndex;
+	  result.phase = result.phase == 1 ? 2 : 1;
+	}
+
+  result.positionInLoop = (int) newPosition;
+  return result;
+}
+
+void LoopPlayhead::publish (const Position& position) noexcept
+{
+  const auto start = sequence.load (std::memory_order_relaxed);
+  sequence.store (start + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence (std::memory_order_release);
+
+  samplePosition.store (position.samplePosition, std::memory_order_relaxed);
+  positionInLoop.store (position.positionInLoop, std::memory_order_relaxed);
+  samplesPerLoop.store (position.samplesPerLoop, std::memory_order_relaxed);
+  loopIndex.store (position.loopIndex, std::memory_order_relaxed);
+  phase.store (position.phase, std::memory_order_relaxed);
+  sampleRate.store (position.sampleRate, std::memory_order_relaxed);
+  hostTimeSeconds.store (position.hostTimeSeconds, std::memory_order_relaxed);
+
+  sequence.store (start + 2, std::memory_order_release);
+}
+
+LoopPlayhead::Position LoopPlayhead::read() const noexcept
+{
+  Position position;
+
+  for (;;)
+	{
+	  const auto before = sequence.load (std::memory_order_acquire);
+
+	  if ((before & 1) == 0)
+		{
+		  position.samplePosition = samplePosition.load (std::memory_order_relaxed);
+		  position.positionInLoop = positionInLoop.load (std::memory_order_relaxed);
+		  position.samplesPerLoop = samplesPerLoop.load (std::memory_order_relaxed);
+		  position.loopIndex = loopIndex.load (std::memory_order_relaxed);
+		  position.phase = phase.load (std::memory_order_relaxed);
+		  position.sampleRate = sampleRate.load (std::memory_order_relaxed);
+		  position.hostTimeSeconds = hostTimeSeconds.load (std::memory_order_relaxed);
+
+		  std::atomic_thread_fence (std::memory_order_acquire);
+
+		  if (sequence.load (std::memory_order_relaxed) == before)
+			return position;
+		}
+
+	  juce::Thread::yield();
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Where the looper is, published by the audio thread once per block and read
+  by the UI. The writer never waits: the fields sit behind a sequence counter
+  (a seqlock), and a reader that catches a write half-done just reads again.
+*/
+class LoopPlayhead
+{
+public:
+  struct Position
+  {
+	juce::int64 samplePosition = 0;  // samples rendered since prepareToPlay
+	int positionInLoop = 0, samplesPerLoop = 0;
+	int loopIndex = 0, phase = 0;
+	double sampleRate = 0.0;
+	double hostTimeSeconds = 0.0;    // Time::getMillisecondCounterHiRes() when the block started
+
+	double getProgress() const noexcept;
+
+	// Advances the position to the given host time at the published sample
+	// rate, wrapping into the following loops (and phases) as needed.
+	Position extrapolatedTo (double timeSeconds) const noexcept;
+  };
+
+  LoopPlayhead() = default;
+
+  void publish (const Position&) noexcept;
+  Position read() const noexcept;
+
+  static double getHostTimeSeconds() noexcept;
+
+private:
+  std::atomic<juce::uint32> sequence { 0 };
+  std::atomic<juce::int64> samplePosition { 0 };
+  std::atomic<int> positionInLoop { 0 }, samplesPerLoop { 0 }, loopIndex { 0 }, phase { 0 };
+  std::atomic<double> sampleRate { 0.0 }, hostTimeSeconds { 0.0 };
+
+  JUCE_DECLARE_NON_COPYABLE (LoopPlayhead)
+};
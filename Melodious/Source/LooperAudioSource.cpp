@@ -0,0 +1,1005 @@
+#include "LooperAudioSource.h"
+#include "AllocationTracker.h"
+#include "EngineLog.h"
+#include "Session.h"
+#include <limits>
+
+//----------------------------------------------------------------------------------------------------
+
+SineWaveVoice::SineWaveVoice (const WavetableBank& bank)
+  : wavetables (bank) {}
+
+void SineWaveVoice::setWaveform (WavetableBank::Waveform newWaveform) noexcept
+{
+  waveform.store (newWaveform);
+}
+
+void SineWaveVoice::setEnvelope (const AdsrEnvelope::Parameters& newParameters)
+{
+  const juce::SpinLock::ScopedLockType sl (envelopeLock);
+  pendingEnvelope = newParameters;
+  envelopeChanged = true;
+}
+
+bool SineWaveVoice::canPlaySound (juce::SynthesiserSound* sound)
+{
+  return dynamic_cast<SineWaveSound*> (sound) != nullptr;
+}
+
+void SineWaveVoice::startNote (int midiNoteNumber, float velocity,
+				juce::SynthesiserSound*, int /*currentPitchWheelPosition*/)
+{
+  currentIndex = 0.0;
+  level = velocity * 0.15f;
+
+  if (envelopeChanged.exchange (false))
+	{
+	  // if the message thread is mid-update, pick it up on the next note instead
+	  const juce::SpinLock::ScopedTryLockType sl (envelopeLock);
+
+	  if (sl.isLocked())
+		envelope.setParameters (pendingEnvelope);
+	  else
+		envelopeChanged = true;
+	}
+
+  envelope.setSampleRate (getSampleRate());
+  envelope.noteOn();
+
+  auto cyclesPerSecond = juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber);
+  tableDelta = (float) (cyclesPerSecond / getSampleRate() * WavetableBank::tableSize);
+  table = wavetables.getTable (waveform.load(), tableDelta);
+}
+
+void SineWaveVoice::stopNote (float /*velocity*/, bool allowTailOff)
+{
+  if (allowTailOff)
+	{
+	  envelope.noteOff();
+	}
+  else
+	{
+	  envelope.reset();
+	  clearCurrentNote();
+	  tableDelta = 0.0;
+	}		  
+}
+
+void SineWaveVoice::renderNextBlock (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+{
+  while (tableDelta != 0.0 && numSamples > 0)
+	{
+	  auto chunkSize = juce::jmin (numSamples, (int) maxChunkSize);
+	  auto numToRender = envelope.getNextGains (gains, chunkSize);
+
+	  renderWavetableChunk (numToRender);
+
+	  juce::FloatVectorOperations::multiply (gains, level, numToRender);
+	  juce::FloatVectorOperations::multiply (chunk, gains, numToRender);
+
+	  for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+		juce::FloatVectorOperations::add (outputBuffer.getWritePointer (i, startSample), chunk, numToRender);
+
+	  startSample += numToRender;
+	  numSamples -= numToRender;
+
+	  // the envelope says exactly which sample the release ended on
+	  if (! envelope.isActive())
+		{
+		  clearCurrentNote(); // [9]
+
+		  tableDelta = 0.0;
+		}
+	}
+}
+
+// Interpolating table read into chunk. The phase recurrence is serial, so it
+// runs first on its own and stores integer indices and fractions; the lookup
+// and interpolation loop then has no loop-carried dependency and vectorises.
+void SineWaveVoice::renderWavetableChunk (int numSamples)
+{
+  const auto size = (float) WavetableBank::tableSize;
+
+  for (int i = 0; i < numSamples; ++i)
+	{
+	  auto index0 = (int) currentIndex;
+	  indices[i] = index0;
+	  fractions[i] = currentIndex - (float) index0;
+
+	  if ((currentIndex += tableDelta) >= size)
+		currentIndex -= size;
+	}
+
+  for (int i = 0; i < numSamples; ++i)
+	{
+	  auto value0 = table[indices[i]];
+	  auto value1 = table[indices[i] + 1];
+	  chunk[i] = value0 + fractions[i] * (value1 - value0);
+	}
+}
+
+//----------------------------------------------------------------------------
+LooperAudioSource::LooperAudioSource (juce::MidiKeyboardState& keyState, int numVoices)
+  : keyboardState (keyState)
+{
+  setNumVoices (numVoices);                   // [1]
+
+  synth.addSound (sineWaveSound.get());       // [2]
+  synth.addSound (samplerSound.get());
+}
+
+// Each kind of voice only plays its own sound, so the wavetables and the
+// sampler each get a full pool and never steal from each other.
+void LooperAudioSource::setNumVoices (int numVoices)
+{
+  numVoices = juce::jmax (1, numVoices);
+  auto numCreated = 0;
+
+  synth.allocateVoices (numVoices * 2, [this, numVoices, &numCreated]() -> juce::SynthesiserVoice*
+	{
+	  if (numCreated++ >= numVoices)
+		return new SamplerVoice (*sampleStreamer);
+
+	  auto* voice = new SineWaveVoice (*wavetables);
+	  voice->setWaveform (appliedControls.waveform);
+	  voice->setEnvelope (appliedControls.envelope);
+	  return voice;
+	});
+}
+
+void LooperAudioSource::setUsingSineWaveSound()
+{
+  synth.clearSounds();
+}
+
+void LooperAudioSource::setTransport (const Transport::Settings& newSettings)
+{
+  transport.requestSettings (newSettings);
+}
+
+Transport::Settings LooperAudioSource::getTransportSettings() const
+{
+  return transport.getRequestedSettings();
+}
+  
+void LooperAudioSource::setWaveform (WavetableBank::Waveform newWaveform)
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  requestedControls.waveform = newWaveform;
+  hasPendingControls = true;
+}
+
+void LooperAudioSource::setEnvelope (const AdsrEnvelope::Parameters& newEnvelope)
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  requestedControls.envelope = newEnvelope;
+  hasPendingControls = true;
+}
+
+void LooperAudioSource::setInstrument (const SampleLibrary* library)
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  requestedControls.instrument = library;
+  hasPendingControls = true;
+}
+
+const SampleLibrary* LooperAudioSource::getInstrument() const noexcept
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  return requestedControls.instrument;
+}
+
+LooperAudioSource::Controls LooperAudioSource::getControls() const
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  return requestedControls;
+}
+
+// Audio thread, or prepareToPlay
+void LooperAudioSource::applyControls (const Controls& controls) noexcept
+{
+  appliedControls = controls;
+
+  for (int i = 0; i < synth.getNumVoices(); ++i)
+	if (auto* voice = dynamic_cast<SineWaveVoice*> (synth.getVoice (i)))
+	  {
+		voice->setWaveform (controls.waveform);
+		voice->setEnvelope (controls.envelope);
+	  }
+
+  samplerSound->setLibrary (controls.instrument);
+  sineWaveSound->enabled = controls.instrument == nullptr;
+}
+
+// Audio thread: if the message thread is mid-change, the new controls wait
+// for the next block
+bool LooperAudioSource::takePendingControls (Controls& controls) noexcept
+{
+  if (! hasPendingControls.load())
+	return false;
+
+  const juce::SpinLock::ScopedTryLockType sl (controlsLock);
+
+  if (! sl.isLocked())
+	return false;
+
+  controls = requestedControls;
+  hasPendingControls = false;
+  return true;
+}
+
+int LooperAudioSource::getNumStreamingUnderruns() const noexcept
+{
+  return sampleStreamer->getNumUnderruns();
+}
+
+bool LooperAudioSource::setupPhrase () {
+  auto& phrase = phraseSlots[activePhrase.load()];
+  phrase = {};
+
+  const auto* library = resources != nullptr ? resources->getPhraseLibrary() : nullptr;
+
+  if (library == nullptr || library->getNumPhrases() == 0)
+	return false;
+
+  phrase = PhraseLibrary::createPattern (library->getPhrase (0), transport.getLoopLengthInTicks());
+  return true;
+}
+
+// The loader fills in the phrase library in the background; until it has,
+// prepareToPlay just carries on without it rather than touching the disk.
+void LooperAudioSource::bindResources (const ResourceLoader* loader)
+{
+  resources = loader;
+}
+
+void LooperAudioSource::setupRythmSection () {
+  selectGroove (replaySession != nullptr ? replaySession->groove : chooseGroove());
+}
+
+// The groove and the phrase are kept in ticks, so all a new tempo or sample
+// rate needs is a new tick length; the patterns themselves are left alone.
+void LooperAudioSource::updateTiming() noexcept
+{
+  rythmSection.setSamplesPerTick (transport.getSamplesPerTick());
+  phrasePlayer.setSamplesPerTick (transport.getSamplesPerTick());
+}
+
+void LooperAudioSource::setGroove (int index)
+{
+  requestedGroove = index;
+}
+
+// The loader's groove that was asked for, or -1 for the built-in one while
+// there are none
+int LooperAudioSource::chooseGroove() const noexcept
+{
+  if (resources == nullptr || resources->getNumGrooves() == 0)
+	return -1;
+
+  return juce::jlimit (0, resources->getNumGrooves() - 1, requestedGroove.load());
+}
+
+// Audio thread: the loader's grooves are immutable once published, so this
+// only ever swaps a pointer
+void LooperAudioSource::selectGroove (int index) noexcept
+{
+  const Pattern* groove = nullptr;
+
+  if (index >= 0 && resources != nullptr && index < resources->getNumGrooves())
+	groove = resources->getGroove (index);
+
+  selectedGroove = groove != nullptr ? index : -1;
+  rythmSection.setPattern (groove != nullptr ? groove : &defaultGroove);
+}
+
+// Both of these run on the GuessEvaluator thread, or when replaying on the
+// replaying thread outside its audio callback; never on the audio thread.
+void LooperAudioSource::noteScored (const GuessScorer::NoteScore& score)
+{
+  EngineLog::info ("Note: {} {} {}", juce::MidiMessage::getMidiNoteName (score.span.noteNumber, true, true, 3),
+				   score.getAccuracy(), score.isRight() ? "right" : "wrong");
+}
+
+void LooperAudioSource::phraseScored (int loopLength, int notesGotRight, int notesInTotal,
+									 float harmonyAccuracy)
+{
+  EngineLog::info ("You got {} out of {} notes right this loop.", notesGotRight, notesInTotal);
+  EngineLog::info ("Harmony: {}% of the time", juce::roundToInt (harmonyAccuracy * 100.0f));
+
+  if (notesGotRight == notesInTotal && readyPhrase.load() < 0)
+	{
+	  // the audio thread only ever switches to a slot we published, so the
+	  // slot it is not playing from is ours until readyPhrase is set
+	  const auto nextSlot = 1 - activePhrase.load();
+	  generateNextPhrase (phraseSlots[nextSlot], loopLength);
+	  phraseTargets[nextSlot] = GuessScorer::createTarget (phraseSlots[nextSlot], loopLength);
+	  readyPhrase.store (nextSlot);
+	}
+}
+
+void LooperAudioSource::generateNextPhrase (Pattern& phrase, int loopLengthInTicks) {
+  std::vector<Pattern::Event> events;
+
+  int diatonic[7] = {0, 2, 4, 5, 7, 9, 11};
+  // int first = random.nextInt(12) + 60;
+  int first = 60;
+  int step = loopLengthInTicks / 8;
+  
+  for (int i = 0; i < 4; i++) {
+	auto n = (juce::uint8) (diatonic[random.nextInt(7)] + first);
+	events.push_back ({ i * step + step / 64, 1, n, 127, true });
+	events.push_back ({ (i + 1) * step - 1, 1, n, 0, false });
+  }
+
+  phrase = Pattern ("Phrase", loopLengthInTicks, std::move (events));
+}
+
+void LooperAudioSource::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+  guessEvaluator.stop();
+  guessEvaluator.setSynchronous (replaySession != nullptr);
+  sampleStreamer->setBlocking (replaySession != nullptr);
+  readyPhrase = -1;
+
+  if (replaySession != nullptr)
+	{
+	  // carry on from where the recording started
+	  const auto& session = *replaySession;
+	  applyControls (session.controls);
+	  transport.requestSettings (session.transport);
+	  loopIndex = session.loopIndex;
+	  currentPhase = session.currentPhase;
+	  currentCyclePos = session.currentCyclePos;
+	  loopStartTick = session.loopStartTick;
+	  calibrating = session.calibrating;
+	  randomSeed = session.randomSeed;
+
+	  if (session.calibrationStarting)
+		calibrator.start();
+	}
+  else
+	{
+	  Controls controls;
+
+	  {
+		const juce::SpinLock::ScopedLockType sl (controlsLock);
+		controls = requestedControls;
+		hasPendingControls = false;
+	  }
+
+	  applyControls (controls);
+	  randomSeed = juce::Random::getSystemRandom().nextInt64();
+	}
+
+  random.setSeed (randomSeed);
+
+  // Everything the callback writes into is reserved here, so that
+  // getNextAudioBlock never has to grow a buffer on the audio thread.
+  // incomingMidi takes a block's worth of the MIDI input, the on-screen
+  // keyboard's events and whatever the phrase and the groove play.
+  incomingMidi.ensureSize ((size_t) ((2 * maxMidiEventsPerBlock
+									  + juce::jmax ((int) maxMidiEventsPerBlock, samplesPerBlockExpected))
+									 * maxBytesPerMidiEvent));
+  incomingMidi.clear();
+  keyboardMidi.ensureSize ((size_t) (maxMidiEventsPerBlock * maxBytesPerMidiEvent));
+  keyboardMidi.clear();
+
+  currentSampleRate = sampleRate;
+  samplesRendered = 0;
+  synth.setCurrentPlaybackSampleRate (sampleRate); // [3]
+  midiInput.reset (sampleRate);
+  calibrator.prepare (sampleRate);
+  pitchTracker.prepare (sampleRate);
+  blockMetrics.reset();
+  transport.prepare (sampleRate);
+  updateTiming();
+  setupRythmSection ();
+
+  // the library's first phrase opens the session; without a library one is made up
+  const auto slot = activePhrase.load();
+
+  if (! setupPhrase())
+	generateNextPhrase (phraseSlots[slot], transport.getLoopLengthInTicks());
+
+  phraseTargets[slot] = GuessScorer::createTarget (phraseSlots[slot], transport.getLoopLengthInTicks());
+  phrasePlayer.setPattern (&phraseSlots[slot]);
+  phrasePlayer.reset();
+  phraseWaiting = false;
+
+  scoring = false;
+  guessPosted = true;
+  if (currentPhase == 2)
+	beginScoring();
+
+  if (sessionSink != nullptr)
+	sessionSink->beginSession (createSessionHeader (samplesPerBlockExpected));
+
+  guessEvaluator.start();
+}
+
+// Everything a replay needs to start off the same way, once prepareToPlay
+// has set it all up
+SessionHeader LooperAudioSource::createSessionHeader (int blockSize) const
+{
+  SessionHeader header;
+  header.sampleRate = currentSampleRate;
+  header.blockSize = blockSize;
+  header.randomSeed = randomSeed;
+  header.controls = appliedControls;
+  header.transport = transport.getSettings();
+  header.groove = selectedGroove;
+  header.loopIndex = loopIndex;
+  header.currentPhase = currentPhase;
+  header.currentCyclePos = currentCyclePos;
+  header.loopStartTick = loopStartTick;
+  header.calibrating = calibrating;
+  header.calibrationStarting = calibrator.isStartPending();
+  return header;
+}
+
+void LooperAudioSource::releaseResources()
+{
+  guessEvaluator.stop();
+
+  if (AllocationTracker::isEnabled())
+	EngineLog::info ("Allocations inside the audio callback so far: {}",
+					 AllocationTracker::getAudioThreadAllocationCount());
+}
+
+void LooperAudioSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+  AllocationTracker::ScopedAudioCallback audioCallback;
+  const auto startTicks = juce::Time::getHighResolutionTicks();
+  const auto blockStart = samplesRendered;
+
+  renderNextBlock (bufferToFill);
+
+  if (sessionSink != nullptr)
+	addBlockEnd (bufferToFill);
+
+  blockMetrics.record (startTicks, blockStart, bufferToFill.numSamples, currentSampleRate,
+					   synth.getNumActiveVoices(), incomingMidi.getNumEvents());
+}
+
+void LooperAudioSource::renderNextBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+  const auto samplesPerLoop = transport.getSamplesPerLoop();
+  const auto samplesPerTick = transport.getSamplesPerTick();
+  const auto tickInLoop = currentCyclePos / samplesPerTick;
+
+  LoopPlayhead::Position position;
+  position.samplePosition = samplesRendered;
+  position.positionInLoop = currentCyclePos;
+  position.samplesPerLoop = samplesPerLoop;
+  position.loopIndex = loopIndex;
+  position.phase = currentPhase;
+  position.sampleRate = currentSampleRate;
+  // a replay has no clock of its own; the notes' arrival times were kept
+  // relative to their callback's
+  position.hostTimeSeconds = replaySession != nullptr ? 0.0 : LoopPlayhead::getHostTimeSeconds();
+  playhead.publish (position);
+
+  const auto numSamples = bufferToFill.numSamples;
+  const auto blockStart = samplesRendered;
+
+  // new controls take over at the start of a block
+  Controls newControls;
+  const auto* replayedControls = replaySession != nullptr ? findReplayEvent ((int) SessionEvent::Type::controls)
+														  : nullptr;
+  if (replayedControls != nullptr)
+	newControls = replayedControls->controls;
+
+  if (replayedControls != nullptr || (replaySession == nullptr && takePendingControls (newControls)))
+	{
+	  applyControls (newControls);
+
+	  if (sessionSink != nullptr)
+		{
+		  SessionEvent event;
+		  event.type = SessionEvent::Type::controls;
+		  event.controls = newControls;
+		  sessionSink->addEvent (event);
+		}
+	}
+
+  const auto listeningToAudio = appliedControls.audioInput;
+  auto numTimedNotes = 0, numPitchEvents = 0;
+  incomingMidi.clear();
+  keyboardMidi.clear();
+
+  if (replaySession != nullptr)
+	{
+	  takeReplayedInput (numTimedNotes, numPitchEvents);
+	}
+  else
+	{
+	  // the audio input arrives in the buffer the output goes out in
+	  if (listeningToAudio)
+		numPitchEvents = trackInputPitch (bufferToFill);
+
+	  // Notes from the input device keep the time they came in; the on-screen
+	  // keyboard's only have their place in the block, which ends now.
+	  numTimedNotes = midiInput.removeNextBlockOfMessages (incomingMidi, numSamples, position.hostTimeSeconds,
+														   timedNotes, (int) maxMidiEventsPerBlock);
+	}
+
+  // std::cout << currentPhase << "\n";
+  bufferToFill.clearActiveBufferRegion();
+
+  if (midiLatency.isEnabled())
+	for (int i = 0; i < numTimedNotes; ++i)
+	  if (timedNotes[i].isNoteOn)
+		midiLatency.record ({ timedNotes[i].time, position.hostTimeSeconds, blockStart, numSamples,
+							  timedNotes[i].samplePosition, timedNotes[i].noteNumber, currentSampleRate });
+
+  keyboardState.processNextMidiBuffer (incomingMidi, bufferToFill.startSample, numSamples, false);
+  keyboardState.processNextMidiBuffer (keyboardMidi, bufferToFill.startSample, numSamples,
+									   replaySession == nullptr); // [4]
+
+  if (sessionSink != nullptr)
+	addInputEvents (numTimedNotes, numPitchEvents, position.hostTimeSeconds);
+
+  incomingMidi.addEvents (keyboardMidi, bufferToFill.startSample, numSamples, 0);
+
+  // calls back with the sample the engine was playing when each note was
+  // struck; with the audio input on, only the notes sung or played into it count
+  const auto forEachStudentNote = [&] (auto&& noteEvent)
+	{
+	  if (listeningToAudio)
+		{
+		  for (int i = 0; i < numPitchEvents; ++i)
+			noteEvent ((double) pitchEvents[i].samplePosition,
+					   MidiInputQueue::TimedNote { 0.0, pitchEvents[i].noteNumber, pitchEvents[i].velocity,
+												   pitchEvents[i].isNoteOn, 0 });
+		  return;
+		}
+
+	  for (int i = 0; i < numTimedNotes; ++i)
+		noteEvent ((double) blockStart + (timedNotes[i].time - position.hostTimeSeconds) * currentSampleRate,
+				   timedNotes[i]);
+
+	  for (const auto metadata : keyboardMidi)
+		{
+		  const auto message = metadata.getMessage();
+
+		  if (message.isNoteOnOrOff())
+			noteEvent ((double) (blockStart - numSamples + metadata.samplePosition - bufferToFill.startSample),
+					   MidiInputQueue::TimedNote { 0.0, message.getNoteNumber(), message.getVelocity(),
+												   message.isNoteOn(), metadata.samplePosition - bufferToFill.startSample });
+		}
+	};
+
+  const auto calibration = calibrator.renderNextBlock (*bufferToFill.buffer, bufferToFill.startSample,
+													   numSamples, blockStart);
+
+  if (sessionSink != nullptr && calibration != LatencyCalibrator::Change::none)
+	{
+	  SessionEvent event;
+	  event.type = SessionEvent::Type::calibration;
+	  event.value = calibration == LatencyCalibrator::Change::started ? 1 : 0;
+	  sessionSink->addEvent (event);
+	}
+
+  if (calibrator.getState() == LatencyCalibrator::State::running)
+	{
+	  // the loop holds still under the clicks; whatever it was playing stops
+	  if (! calibrating)
+		synth.allNotesOff (0, true);
+
+	  calibrating = true;
+	  forEachStudentNote ([this] (double samplePosition, const MidiInputQueue::TimedNote& note)
+		{
+		  if (note.isNoteOn)
+			calibrator.addTap (samplePosition);
+		});
+
+	  synth.renderNextBlock (*bufferToFill.buffer, incomingMidi, bufferToFill.startSample, numSamples);
+	  samplesRendered += numSamples;
+	  // the loop being listened to waits along with everything else
+	  listeningStart += numSamples;
+	  return;
+	}
+
+  calibrating = false;
+
+  if (scoring)
+	{
+	  const auto latencySamples = appliedControls.latencyCompensation * currentSampleRate;
+
+	  forEachStudentNote ([this, latencySamples] (double samplePosition, const MidiInputQueue::TimedNote& note)
+		{
+		  scorer.addEvent (toListeningTick (samplePosition - latencySamples),
+						   note.noteNumber, note.isNoteOn, note.velocity);
+		});
+
+	  // each note is scored as soon as it's over, rather than all of them at
+	  // the end of the loop, and the next phrase can be built straight after.
+	  // Nothing struck before this block can still be on its way in, so
+	  // everything up to its start, less the latency, is settled. The pitch
+	  // tracker hears its notes later, and a block behind the output.
+	  const auto settled = (double) blockStart - latencySamples
+		- (listeningToAudio ? pitchTracker.getLatencyInSamples() + numSamples : 0);
+	  scorer.advanceTo (toListeningTick (settled));
+
+	  if (settled >= (double) (listeningStart + listeningLength))
+		finishScoring();
+	  else
+		reportScores();
+	}
+  else if (! guessPosted)
+	{
+	  // the loop's scores are all in, but the evaluator's FIFO was full
+	  reportScores();
+	}
+
+  // Adding scripted midi events
+  if (currentPhase == 1)
+	{
+	  const auto phraseSamples = juce::jmin (numSamples, samplesPerLoop - currentCyclePos);
+
+	  if (phraseWaiting)
+		takeReadyPhrase (tickInLoop + phraseSamples / samplesPerTick);
+
+	  // the phrase stops at the loop's end rather than coming round again
+	  phrasePlayer.renderNextBlock (incomingMidi, tickInLoop, 0, phraseSamples);
+	}
+
+  // after the guesses are taken, so the backing isn't scored as the student's playing
+  rythmSection.renderNextBlock (incomingMidi, loopStartTick + tickInLoop, 0, numSamples);
+  synth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
+						 bufferToFill.startSample, numSamples); // [5]
+  currentCyclePos += numSamples;
+  samplesRendered += numSamples;
+
+  if (currentCyclePos >= samplesPerLoop)
+	{
+	  currentCyclePos -= samplesPerLoop;
+	  ++loopIndex;
+	  loopStartTick += transport.getLoopLengthInTicks();
+
+	  // a new tempo starts on the downbeat; the few samples already past it
+	  // are rescaled so the next block carries on from the same tick
+	  if (transport.applyPendingSettings())
+		{
+		  currentCyclePos = juce::roundToInt (currentCyclePos * transport.getSamplesPerTick() / samplesPerTick);
+		  updateTiming();
+
+		  if (sessionSink != nullptr)
+			{
+			  SessionEvent event;
+			  event.type = SessionEvent::Type::transport;
+			  event.transport = transport.getSettings();
+			  sessionSink->addEvent (event);
+			}
+		}
+
+	  const auto* replayedGroove = replaySession != nullptr ? findReplayEvent ((int) SessionEvent::Type::groove) : nullptr;
+	  selectGroove (replayedGroove != nullptr ? replayedGroove->value : chooseGroove());
+
+	  if (sessionSink != nullptr)
+		{
+		  SessionEvent event;
+		  event.type = SessionEvent::Type::groove;
+		  event.value = selectedGroove;
+		  sessionSink->addEvent (event);
+		}
+
+	  if (currentPhase==1)
+		{
+		  currentPhase = 2;
+		  beginScoring();
+		}
+	  else
+		{
+		  currentPhase = 1;
+		  phraseWaiting = true;
+		}
+	}
+}
+
+// Audio thread, each block of phase 1 until its phrase has started: switches
+// to the evaluator's next phrase if it has one ready. Scoring runs behind
+// by the latency compensation, so a phrase that was passed near the end of
+// its loop is often only published once the loop has come round; it still
+// takes over, as long as nothing of the old one has been played. If none
+// is ready by then, the current phrase simply plays again. A replay's
+// evaluator is never late, so it waits for the switch the recording made.
+void LooperAudioSource::takeReadyPhrase (double blockEndTick) noexcept
+{
+  const auto& events = phraseSlots[activePhrase.load()].getEvents();
+  const auto lastChance = events.empty() || blockEndTick > (double) events.front().tick;
+
+  const auto* replayedSwitch = replaySession != nullptr ? findReplayEvent ((int) SessionEvent::Type::phraseSwitch)
+														: nullptr;
+  const auto ready = replaySession == nullptr || (replayedSwitch != nullptr && replayedSwitch->value != 0)
+					   ? readyPhrase.load() : -1;
+
+  if (ready < 0 && ! lastChance)
+	return;
+
+  // The new slot goes active before the ready flag clears: the evaluator
+  // takes a clear flag to mean the slot it isn't playing from is free.
+  // Only this thread clears it, so nothing can come in between.
+  if (ready >= 0)
+	{
+	  activePhrase.store (ready);
+	  readyPhrase.store (-1);
+	}
+
+  phrasePlayer.setPattern (&phraseSlots[activePhrase.load()]);
+  phrasePlayer.reset();
+  phraseWaiting = false;
+
+  if (sessionSink != nullptr)
+	{
+	  SessionEvent event;
+	  event.type = SessionEvent::Type::phraseSwitch;
+	  event.value = ready >= 0 ? 1 : 0;
+	  sessionSink->addEvent (event);
+	}
+}
+
+// Audio thread: a replayed block's first event of this type, or nullptr
+const SessionEvent* LooperAudioSource::findReplayEvent (int type) const noexcept
+{
+  for (int i = 0; i < numReplayEvents; ++i)
+	if ((int) replayEvents[i].type == type)
+	  return replayEvents + i;
+
+  return nullptr;
+}
+
+// Audio thread: the input the recording had in this block, in the buffers the
+// live inputs would have filled
+void LooperAudioSource::takeReplayedInput (int& numTimedNotes, int& numPitchEvents) noexcept
+{
+  for (int i = 0; i < numReplayEvents; ++i)
+	{
+	  const auto& event = replayEvents[i];
+
+	  switch (event.type)
+		{
+		case SessionEvent::Type::midi:
+		  incomingMidi.addEvent (event.data, event.size, event.position);
+		  break;
+
+		case SessionEvent::Type::keyboard:
+		  keyboardMidi.addEvent (event.data, event.size, event.position);
+		  break;
+
+		case SessionEvent::Type::timedNote:
+		  if (numTimedNotes < (int) maxMidiEventsPerBlock)
+			timedNotes[numTimedNotes++] = event.note;
+		  break;
+
+		case SessionEvent::Type::pitchNote:
+		  if (numPitchEvents < (int) maxPitchEventsPerBlock)
+			pitchEvents[numPitchEvents++] = event.pitchNote;
+		  break;
+
+		default:
+		  break;
+		}
+	}
+}
+
+// Audio thread: the block's input, as it goes into the engine. Timed notes
+// keep their arrival relative to the callback, which is all a replay needs.
+void LooperAudioSource::addInputEvents (int numTimedNotes, int numPitchEvents, double hostTimeSeconds) noexcept
+{
+  const auto addMessages = [this] (const juce::MidiBuffer& buffer, SessionEvent::Type type)
+	{
+	  for (const auto metadata : buffer)
+		{
+		  // long SysEx is left out; nothing in the engine reads it
+		  if (metadata.numBytes > SessionEvent::maxMessageSize)
+			continue;
+
+		  SessionEvent event;
+		  event.type = type;
+		  event.position = metadata.samplePosition;
+		  event.size = metadata.numBytes;
+		  std::memcpy (event.data, metadata.data, (size_t) metadata.numBytes);
+		  sessionSink->addEvent (event);
+		}
+	};
+
+  addMessages (incomingMidi, SessionEvent::Type::midi);
+
+  for (int i = 0; i < numTimedNotes; ++i)
+	{
+	  SessionEvent event;
+	  event.type = SessionEvent::Type::timedNote;
+	  event.note = timedNotes[i];
+	  event.note.time -= hostTimeSeconds;
+	  sessionSink->addEvent (event);
+	}
+
+  addMessages (keyboardMidi, SessionEvent::Type::keyboard);
+
+  for (int i = 0; i < numPitchEvents; ++i)
+	{
+	  SessionEvent event;
+	  event.type = SessionEvent::Type::pitchNote;
+	  event.pitchNote = pitchEvents[i];
+	  sessionSink->addEvent (event);
+	}
+}
+
+// Audio thread: closes the block with a hash of everything it played
+void LooperAudioSource::addBlockEnd (const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+  SessionEvent event;
+  event.type = SessionEvent::Type::endOfBlock;
+  event.value = bufferToFill.numSamples;
+  event.position = bufferToFill.buffer->getNumChannels();
+  event.hash = SessionEvent::hashAudio (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+  sessionSink->addEvent (event);
+}
+
+// Audio thread: runs the first input channel through the pitch tracker. The
+// input came in over the block that leads up to this callback, so its samples
+// are placed a block before the output's, as the on-screen keyboard's notes are.
+int LooperAudioSource::trackInputPitch (const juce::AudioSourceChannelInfo& bufferToFill) noexcept
+{
+  if (bufferToFill.buffer->getNumChannels() == 0)
+	return 0;
+
+  const auto* input = bufferToFill.buffer->getReadPointer (0, bufferToFill.startSample);
+  return pitchTracker.processBlock (input, bufferToFill.numSamples, samplesRendered - bufferToFill.numSamples,
+									pitchEvents, (int) maxPitchEventsPerBlock);
+}
+
+// Audio thread: starts listening to the loop that begins at currentCyclePos
+// samples ago. A loop still being scored this late is closed off first.
+void LooperAudioSource::beginScoring() noexcept
+{
+  if (scoring)
+	finishScoring();
+
+  listeningStart = samplesRendered - currentCyclePos;
+  listeningLength = transport.getSamplesPerLoop();
+  listeningLengthInTicks = transport.getLoopLengthInTicks();
+  listeningSamplesPerTick = transport.getSamplesPerTick();
+
+  scorer.begin (phraseTargets[activePhrase.load()]);
+  numScoresReported = 0;
+  guessPosted = false;
+  scoring = true;
+}
+
+// Audio thread: anything still open ends with the loop
+void LooperAudioSource::finishScoring() noexcept
+{
+  scorer.advanceTo (std::numeric_limits<int>::max());
+  reportScores();
+  scoring = false;
+}
+
+int LooperAudioSource::toListeningTick (double samplePosition) const noexcept
+{
+  const auto tick = std::floor ((samplePosition - (double) listeningStart) / listeningSamplesPerTick);
+  return (int) juce::jlimit ((double) std::numeric_limits<int>::min(), (double) std::numeric_limits<int>::max(), tick);
+}
+
+// Audio thread: passes on whatever the scorer has finished since last time.
+// Whatever the evaluator's FIFO has no room for is tried again next block,
+// the end of the phrase only once every note has gone.
+void LooperAudioSource::reportScores() noexcept
+{
+  for (; numScoresReported < scorer.getNumScored(); ++numScoresReported)
+	{
+	  if (! guessEvaluator.postNote (scorer.getScore (numScoresReported)))
+		return;
+
+	  if (sessionSink != nullptr)
+		{
+		  SessionEvent event;
+		  event.type = SessionEvent::Type::score;
+		  event.score.type = ScoreMessage::Type::note;
+		  event.score.note = scorer.getScore (numScoresReported);
+		  sessionSink->addEvent (event);
+		}
+	}
+
+  if (scorer.isFinished() && ! guessPosted)
+	{
+	  if (! guessEvaluator.postEndOfPhrase (listeningLengthInTicks, scorer.getNumRight(),
+											scorer.getNumTargets(), scorer.getHarmonyAccuracy()))
+		return;
+
+	  guessPosted = true;
+
+	  if (sessionSink != nullptr)
+		{
+		  SessionEvent event;
+		  event.type = SessionEvent::Type::score;
+		  event.score.type = ScoreMessage::Type::endOfPhrase;
+		  event.score.loopLength = listeningLengthInTicks;
+		  event.score.notesGotRight = scorer.getNumRight();
+		  event.score.notesInTotal = scorer.getNumTargets();
+		  event.score.harmonyAccuracy = scorer.getHarmonyAccuracy();
+		  sessionSink->addEvent (event);
+		}
+	}
+}
+
+MidiInputQueue* LooperAudioSource::getMidiInputQueue()
+{
+  return &midiInput;
+}
+
+const LoopPlayhead& LooperAudioSource::getPlayhead() const noexcept
+{
+  return playhead;
+}
+
+void LooperAudioSource::setLatencyCompensation (double seconds)
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  requestedControls.latencyCompensation = juce::jmax (0.0, seconds);
+  hasPendingControls = true;
+}
+
+double LooperAudioSource::getLatencyCompensation() const noexcept
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  return requestedControls.latencyCompensation;
+}
+
+LatencyCalibrator& LooperAudioSource::getLatencyCalibrator() noexcept
+{
+  return calibrator;
+}
+
+MidiLatencyMonitor& LooperAudioSource::getMidiLatencyMonitor() noexcept
+{
+  return midiLatency;
+}
+
+AudioBlockMetrics& LooperAudioSource::getBlockMetrics() noexcept
+{
+  return blockMetrics;
+}
+
+void LooperAudioSource::setAudioInputEnabled (bool shouldListen)
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  requestedControls.audioInput = shouldListen;
+  hasPendingControls = true;
+}
+
+bool LooperAudioSource::isAudioInputEnabled() const noexcept
+{
+  const juce::SpinLock::ScopedLockType sl (controlsLock);
+  return requestedControls.audioInput;
+}
+
+void LooperAudioSource::setSessionSink (SessionSink* newSink)
+{
+  sessionSink = newSink;
+}
+
+void LooperAudioSource::setReplaySession (const SessionHeader* session)
+{
+  replaySession = session;
+  replayEvents = nullptr;
+  numReplayEvents = 0;
+}
+
+// Before each replayed block: the requests the recording's message thread
+// made in time for it go in the way they did then
+void LooperAudioSource::setReplayBlock (const SessionEvent* events, int numEvents) noexcept
+{
+  replayEvents = events;
+  numReplayEvents = numEvents;
+
+  for (int i = 0; i < numEvents; ++i)
+	{
+	  if (events[i].type == SessionEvent::Type::transport)
+		transport.requestSettings (events[i].transport);
+	  else if (events[i].type == SessionEvent::Type::calibration)
+		events[i].value != 0 ? calibrator.start() : calibrator.cancel();
+	}
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "GuessEvaluator.h"
+#include "ResourceLoader.h"
+#include "LoopPlayhead.h"
+#include "WavetableBank.h"
+#include "VoicePool.h"
+#include "AdsrEnvelope.h"
+#include "PatternSequencer.h"
+#include "Transport.h"
+#include "MidiInputQueue.h"
+#include "LatencyCalibrator.h"
+#include "MidiLatencyMonitor.h"
+#include "AudioBlockMetrics.h"
+#include "PitchTracker.h"
+#include "SamplerVoice.h"
+
+class SessionSink;
+struct SessionHeader;
+struct SessionEvent;
+
+struct SineWaveSound : public juce::SynthesiserSound
+{
+  SineWaveSound() {}
+
+  // off while a sampled instrument plays instead
+  std::atomic<bool> enabled { true };
+
+  bool appliesToNote (int) override { return enabled.load(); }
+  bool appliesToChannel (int) override { return true; }
+};
+
+// Despite the name it plays any of the bank's waveforms, picking the mip
+// level that suits the note when the note starts.
+struct SineWaveVoice : public juce::SynthesiserVoice
+{
+  SineWaveVoice (const WavetableBank&);
+  // these take effect from the next note
+  void setWaveform (WavetableBank::Waveform) noexcept;
+  void setEnvelope (const AdsrEnvelope::Parameters&);
+  bool canPlaySound (juce::SynthesiserSound* sound) override;
+  void startNote (int, float, juce::SynthesiserSound*, int) override;
+  void stopNote (float, bool) override;
+  void pitchWheelMoved (int) override {}
+  void controllerMoved (int, int) override {}
+  void renderNextBlock (juce::AudioSampleBuffer&, int, int) override;
+  
+private:
+  void renderWavetableChunk (int);
+
+  // blocks are rendered in chunks of at most this many samples into the
+  // scratch arrays below, then mixed into every output channel at once
+  static constexpr int maxChunkSize = AdsrEnvelope::maxBlockSize;
+
+  float level = 0.0f;
+  AdsrEnvelope envelope;
+  // setEnvelope may come from any thread; startNote picks it up
+  juce::SpinLock envelopeLock;
+  AdsrEnvelope::Parameters pendingEnvelope;
+  std::atomic<bool> envelopeChanged { false };
+  const WavetableBank& wavetables;
+  std::atomic<WavetableBank::Waveform> waveform { WavetableBank::Waveform::sine };
+  const float* table = nullptr;
+  float currentIndex = 0.0f, tableDelta = 0.0f;
+
+  alignas (16) float chunk[maxChunkSize];
+  alignas (16) float gains[maxChunkSize];
+  alignas (16) float fractions[maxChunkSize];
+  int indices[maxChunkSize];
+};
+
+//==============================================================================
+class LooperAudioSource   : public juce::AudioSource
+{
+public:
+  static constexpr int defaultNumVoices = 32;
+
+  // How the notes sound and how they're scored. The setters below leave a
+  // change for the audio thread to take up at the start of its next block,
+  // so it lands on a block boundary a session recording can point to.
+  struct Controls
+  {
+	WavetableBank::Waveform waveform = WavetableBank::Waveform::sine;
+	AdsrEnvelope::Parameters envelope;
+	const SampleLibrary* instrument = nullptr;
+	double latencyCompensation = 0.0;
+	bool audioInput = false;
+  };
+
+  LooperAudioSource (juce::MidiKeyboardState&, int numVoices = defaultNumVoices);
+  void setUsingSineWaveSound();
+  // Reallocates the voice pool, numVoices of each kind; call it while the audio is stopped
+  void setNumVoices (int);
+  // Tempo, time signature and loop length; a change waits for the next loop boundary
+  void setTransport (const Transport::Settings&);
+  Transport::Settings getTransportSettings() const;
+  void bindResources (const ResourceLoader*);
+  void setWaveform (WavetableBank::Waveform);
+  void setEnvelope (const AdsrEnvelope::Parameters&);
+  // Plays the notes on a sampled instrument instead of the wavetables, or
+  // goes back to them for nullptr. The library must outlive this object.
+  void setInstrument (const SampleLibrary*);
+  const SampleLibrary* getInstrument() const noexcept;
+  // Times a sampler voice found its stream empty since the app started
+  int getNumStreamingUnderruns() const noexcept;
+  // Picks one of the loader's grooves (or the built-in one while there are
+  // none), switching over at the next loop boundary
+  void setGroove (int);
+  // Puts the phrase library's first phrase in the active slot; false if there's no library yet
+  bool setupPhrase();
+  void setupRythmSection();
+  void noteScored (const GuessScorer::NoteScore&);
+  void phraseScored (int loopLength, int notesGotRight, int notesInTotal, float harmonyAccuracy);
+  void generateNextPhrase (Pattern&, int loopLengthInTicks);
+  void prepareToPlay (int, double) override;  
+  void releaseResources() override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;    
+  MidiInputQueue* getMidiInputQueue();
+  const LoopPlayhead& getPlayhead() const noexcept;
+  // The round trip from the speakers to the student's keys, taken off every
+  // note before it is scored
+  void setLatencyCompensation (double seconds);
+  double getLatencyCompensation() const noexcept;
+  // While the calibrator runs the loop holds still and only its clicks play
+  LatencyCalibrator& getLatencyCalibrator() noexcept;
+  // Where each note from the MIDI input landed; off until enabled
+  MidiLatencyMonitor& getMidiLatencyMonitor() noexcept;
+  // What every block cost; read it into an AudioBlockMetrics::Window
+  AudioBlockMetrics& getBlockMetrics() noexcept;
+  // Scores what the pitch tracker hears on the first input channel instead
+  // of the MIDI input; the device needs an input channel open for it
+  void setAudioInputEnabled (bool);
+  bool isAudioInputEnabled() const noexcept;
+  // The controls as last set, whether or not the audio thread has them yet
+  Controls getControls() const;
+
+  // From the next prepareToPlay on, hands the sink everything that decides
+  // what the engine plays; see SessionRecorder. nullptr stops. Set it while
+  // the audio is stopped.
+  void setSessionSink (SessionSink*);
+  // Replays a session instead of listening to the inputs: prepareToPlay
+  // starts from the header and each block takes its input and its choices
+  // from the events given to setReplayBlock. Scores are handled on the
+  // calling thread and the sampler waits for the disk. See SessionPlayer.
+  void setReplaySession (const SessionHeader*);
+  void setReplayBlock (const SessionEvent* events, int numEvents) noexcept;
+
+private:
+  void renderNextBlock (const juce::AudioSourceChannelInfo&);
+  void applyControls (const Controls&) noexcept;
+  bool takePendingControls (Controls&) noexcept;
+  const SessionEvent* findReplayEvent (int type) const noexcept;
+  void takeReplayedInput (int& numTimedNotes, int& numPitchEvents) noexcept;
+  void addInputEvents (int numTimedNotes, int numPitchEvents, double hostTimeSeconds) noexcept;
+  void addBlockEnd (const juce::AudioSourceChannelInfo&) noexcept;
+  SessionHeader createSessionHeader (int blockSize) const;
+  int chooseGroove() const noexcept;
+  void selectGroove (int) noexcept;
+  void updateTiming() noexcept;
+  void reportScores() noexcept;
+  int trackInputPitch (const juce::AudioSourceChannelInfo&) noexcept;
+  void beginScoring() noexcept;
+  void finishScoring() noexcept;
+  int toListeningTick (double samplePosition) const noexcept;
+  void takeReadyPhrase (double blockEndTick) noexcept;
+  
+  // the MIDI input hands over at most this many events a block (the rest
+  // wait for the next) and keyboardMidi is reserved for as many, each of up
+  // to this size
+  static constexpr int maxMidiEventsPerBlock = 512, maxBytesPerMidiEvent = 12;
+  static constexpr int maxPitchEventsPerBlock = 32;   // notes the pitch tracker starts or stops
+
+  // Both shared by every engine in the process: the tables are read-only
+  // once built, and one streaming thread serves every sampler voice (so a
+  // replay's waiting for the disk holds for all of them; replays run alone)
+  juce::SharedResourcePointer<WavetableBank> wavetables;
+  
+  juce::MidiKeyboardState& keyboardState;
+  // applied is the audio thread's; the rest is guarded by controlsLock
+  Controls appliedControls;
+  mutable juce::SpinLock controlsLock;
+  Controls requestedControls;
+  std::atomic<bool> hasPendingControls { false };
+  // declared before synth, which its voices' streams have to outlive
+  juce::SharedResourcePointer<SampleStreamer> sampleStreamer;
+  VoicePool synth;
+  juce::ReferenceCountedObjectPtr<SineWaveSound> sineWaveSound { new SineWaveSound() };
+  juce::ReferenceCountedObjectPtr<SamplerSound> samplerSound { new SamplerSound() };
+  MidiInputQueue midiInput;
+  MidiLatencyMonitor midiLatency;
+  AudioBlockMetrics blockMetrics;
+  PitchTracker pitchTracker;
+  PitchTracker::NoteEvent pitchEvents[maxPitchEventsPerBlock];
+  int currentCyclePos = 0, currentPhase = 1; // currentPhase = 0 for none, 1 for computer playing phrase, 2 for listening to user input
+  int loopIndex = 0;
+  double loopStartTick = 0.0;  // ticks played before the current loop
+  juce::int64 samplesRendered = 0;
+  double currentSampleRate = 0.0;
+  LoopPlayhead playhead;
+  // TODO: const static members for these values
+  juce::MidiBuffer incomingMidi, keyboardMidi;
+  MidiInputQueue::TimedNote timedNotes[maxMidiEventsPerBlock];
+  const Pattern defaultGroove { Pattern::createDefaultGroove() };
+  PatternSequencer rythmSection, phrasePlayer;
+  std::atomic<int> requestedGroove { 0 };
+  int selectedGroove = -1;
+  Transport transport;
+  GuessScorer scorer;
+  int numScoresReported = 0;
+  // The loop being listened to, in samples since prepareToPlay. Notes come in
+  // late, so scoring carries on past its end by the latency compensation.
+  bool scoring = false;
+  juce::int64 listeningStart = 0;
+  int listeningLength = 0, listeningLengthInTicks = 0;
+  double listeningSamplesPerTick = 1.0;
+  LatencyCalibrator calibrator;
+  bool calibrating = false;
+  const ResourceLoader* resources = nullptr;
+  // drawn afresh by each prepareToPlay, or taken from the session replayed
+  juce::int64 randomSeed = 0;
+  juce::Random random;
+
+  SessionSink* sessionSink = nullptr;
+  const SessionHeader* replaySession = nullptr;
+  const SessionEvent* replayEvents = nullptr;
+  int numReplayEvents = 0;
+
+  // The phrase is double-buffered: the audio thread plays phraseSlots[activePhrase]
+  // while the evaluator builds the next one in the other slot and publishes it
+  // through readyPhrase. The audio thread switches over once the phrase comes
+  // round to play again, at any block up to its first note.
+  // Phrases and their scoring spans are in ticks, so they survive a change of tempo.
+  Pattern phraseSlots[2];
+  GuessScorer::Target phraseTargets[2];
+  std::atomic<int> activePhrase { 0 }, readyPhrase { -1 };
+  bool guessPosted = true;      // false until the scored loop's end has gone to the evaluator
+  bool phraseWaiting = false;   // phase 1 hasn't played any of its phrase yet
+  GuessEvaluator guessEvaluator { *this };
+};
@@ -1,660 +1,967 @@
-#include "MainComponent.h"
-#include <iostream>
-
-//----------------------------------------------------------------------------------------------------
-
-SineWaveVoice::SineWaveVoice (const juce::AudioSampleBuffer& wavetableToUse)
-  : wavetable (wavetableToUse),
-	tableSize (wavetable.getNumSamples()) {}
-
-bool SineWaveVoice::canPlaySound (juce::SynthesiserSound* sound)
-{
-  return dynamic_cast<SineWaveSound*> (sound) != nullptr;
-}
-
-void SineWaveVoice::startNote (int midiNoteNumber, float velocity,
-				juce::SynthesiserSound*, int /*currentPitchWheelPosition*/)
-{
-  currentIndex = 0.0;
-  level = velocity * 0.15;
-  tailOff = 0.0;
-
-  auto cyclesPerSecond = juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber);
-  tableDelta = (float) cyclesPerSecond / getSampleRate() * (float) tableSize;
-}
-
-void SineWaveVoice::stopNote (float /*velocity*/, bool allowTailOff)
-{
-  if (allowTailOff)
-	{
-	  if (tailOff == 0.0)
-		tailOff = 1.0;
-	}
-  else
-	{
-	  clearCurrentNote();
-	  tableDelta = 0.0;
-	}		  
-}
-
-void SineWaveVoice::renderNextBlock (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
-{
-  if (tableDelta != 0.0)
-	{
-	  while (--numSamples >= 0)
-		{
-		    
-		  // auto currentSample = (float) (std::sin (currentAngle) * level * tailOff);
-		  // interpolating
-		  auto index0 = (unsigned int) currentIndex;
-		  auto index1 = index0 + 1;
-
-		  auto frac = currentIndex - (float) index0;
-
-		  auto table = wavetable.getReadPointer (0);
-		  auto value0 = table[index0];
-		  auto value1 = table[index1];
-
-		  auto currentSample = (float) (value0 + frac * (value1 - value0)) * level;
-			
-		  // // using floor index
-		  // auto index0 = (unsigned int) currentIndex;
-		  // auto table = wavetable.getReadPointer (0);
-		  // auto currentSample = (float) table[index0] * level;
-			
-		  if (tailOff > 0.0)
-			currentSample *= tailOff;
-
-		  for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
-			outputBuffer.addSample (i, startSample, currentSample);
-
-		  ++startSample;
-
-		  if ((currentIndex += tableDelta) > (float) tableSize)
-			currentIndex -= (float) tableSize;
-
-		  if (tailOff > 0.0)
-			{
-			  tailOff *= 0.99; // [8]
-
-			  if (tailOff <= 0.005)
-				{
-				  clearCurrentNote(); // [9]
-
-				  tableDelta = 0.0;
-				  break;
-				}
-			}
-		}
-	}
-}
-
-//----------------------------------------------------------------------------------------------------
-
-CircularProgressBarLaF::CircularProgressBarLaF (float elv = 0.6f)
-  : elevation (elv) {}
-
-void CircularProgressBarLaF::drawProgressBar (juce::Graphics& g, juce::ProgressBar& progressBar,
-											  int width, int height, double progress,
-											  const juce::String&)
-{
-  const juce::Colour background (progressBar.findColour (juce::ProgressBar::backgroundColourId));
-  const juce::Colour foreground (progressBar.findColour (juce::ProgressBar::foregroundColourId));
-	
-  auto barBounds = progressBar.getLocalBounds();
-  juce::Path inner;
-  inner.addCentredArc (barBounds.getCentreX(),
-					   barBounds.getCentreY(),
-					   barBounds.getWidth() * 0.5f * elevation,
-					   barBounds.getHeight() * 0.5f * elevation,
-					   0.0f, 0.0f, juce::MathConstants<float>::twoPi, true);
-  g.setColour (background);
-  g.strokePath (inner, juce::PathStrokeType (barBounds.getWidth() / 5));
-  juce::Path outer;
-  outer.addCentredArc (barBounds.getCentreX(),
-					   barBounds.getCentreY(),
-					   barBounds.getWidth() * 2.0f / 5.0f,
-					   barBounds.getHeight() * 2.0f / 5.0f,
-					   0.0f,
-					   0.0f,
-					   juce::MathConstants<float>::twoPi * progress,
-					   true);
-  g.setColour (foreground);
-  g.strokePath (outer, juce::PathStrokeType (barBounds.getWidth() / 5));
-}
-
-//============================================================================
-
-void TitleBeltComponent::paint (juce::Graphics& g)
-{
-  g.fillAll (juce::Colour (0, 71, 87));
-  g.setColour (juce::Colours::white);
-  g.drawLine (8, 12, getWidth() - 8, 12, 8);
-  g.drawLine (8, getHeight() - 12, getWidth() - 8,  getHeight() - 12, 8);
-  g.setFont (96);
-  g.drawText (titleString, 8, 12, getWidth() - 8, getHeight() - 12, juce::Justification::Flags::left);
-}
-
-//----------------------------------------------------------------------------
-LooperAudioSource::LooperAudioSource (juce::MidiKeyboardState& keyState)
-  : keyboardState (keyState)
-{
-  createWavetable();
-	
-  for (auto i = 0; i < 4; ++i)                // [1]
-	synth.addVoice (new SineWaveVoice (sineTable));
-
-  synth.addSound (new SineWaveSound());       // [2]
-}
-
-void LooperAudioSource::setUsingSineWaveSound()
-{
-  synth.clearSounds();
-}
-
-void LooperAudioSource::setupSamplesPerLoop (int spl) {
-  std::cout << "Setting up samples per loop: " << spl << "\n";
-  samplesPerLoop = spl;
-}
-  
-void LooperAudioSource::createWavetable()
-{
-  sineTable.setSize (1, (int) tableSize + 1);
-  auto* samples = sineTable.getWritePointer (0);
-
-  auto angleDelta = juce::MathConstants<double>::twoPi / (double) (tableSize -1);
-  auto currentAngle = 0.0;
-
-  for (unsigned int i = 0; i < tableSize; ++i)
-	{
-	  auto sample = std::sin (currentAngle);
-	  samples[i] = (float) sample;
-	  currentAngle += angleDelta;
-	}
-  samples[tableSize] = samples[0];
-}
-
-void LooperAudioSource::setupPhrase () {
-  
-  phraseBuffer.clear();
-
-  phraseBuffer.addEvents (phrases[0], 0, -1, 0);
-  
-  // manual event adding
-  // auto one12thNote = std::floor(samplesPerLoop / 12 / 2);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 67, 1.0f), 0);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 67), one12thNote * 2 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 69, 1.0f), one12thNote * 2);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 69), one12thNote * 3 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 70, 1.0f), one12thNote * 3);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 70), one12thNote * 5 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 72, 1.0f), one12thNote * 5);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 72), one12thNote * 6 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 69, 1.0f), one12thNote * 6);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 69), one12thNote * 9 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 65, 1.0f), one12thNote * 9);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 65), one12thNote * 11 - 1);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOn (1, 67, 1.0f), one12thNote * 11);
-  // phraseBuffer.addEvent (juce::MidiMessage::noteOff (1, 67), one12thNote *12 - 1);
-
-  // for testing savephrases() and loadphrases()
-  // phrases[0].addEvents(phraseBuffer, 0, -1, 0);
-}
-
-
-void LooperAudioSource::loadPhrases()
-{
-  const auto phraseFile = juce::File ("/home/roy/Code/melodious/Melodious/Source/res/phrases");
-  if (phraseFile.exists())
-	{
-	  juce::FileInputStream inputStreamRef (phraseFile);
-	  if (inputStreamRef.openedOk())
-		{
-		  juce::MidiFile midiFile;
-		  midiFile.readFrom (inputStreamRef);
-		  for (int i = 0; i < midiFile.getNumTracks(); i++) {
-			const juce::MidiMessageSequence track = *midiFile.getTrack (i);
-			for (int j = 0; j < track.getNumEvents(); j++) {
-			  juce::MidiMessage message = (*track.getEventPointer (j)).message;
-			  phrases[i].addEvent (message, message.getTimeStamp());
-			}
-		  }
-		}
-	  else
-		std::cout << "ERROR: Problem opening input stream for phrase image";
-	}
-  else
-	std::cout << "ERROR: Phrase file does not exist\n";  
-}
-
-void LooperAudioSource::savePhrases()
-{
-  const auto phraseFile = juce::File ("/home/roy/Code/melodious/Melodious/Source/res/phrases");
-  if (phraseFile.exists())
-	{
-	  juce::FileOutputStream outputStreamRef (phraseFile);
-	  outputStreamRef.setPosition (0);
-	  outputStreamRef.truncate();
-	  if (outputStreamRef.openedOk())
-		{		  
-		  juce::MidiFile midiFile;
-		  for (int i = 0; i < 10; i++) {
-			if (phrases[i].isEmpty())
-			  continue;
-			juce::MidiMessageSequence track;
-			// Copying midiEvents from phrases[i] to track
-			for (const juce::MidiMessageMetadata metadata : phrases[i]) {
-			  track.addEvent (metadata.getMessage());
-			}
-			midiFile.addTrack (track);
-		  }
-		  
-		  midiFile.writeTo (outputStreamRef);
-		}
-	  else
-		std::cout << "ERROR: Problem opening input stream for phrase image";
-	}
-  else
-	std::cout << "ERROR: Phrase file does not exist\n";  
-}
-  
-void LooperAudioSource::setupRythmSection () {
-  rythmSectionBuffer.clear();
-  for (int i = 0; i < 2; i++) {
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 53, 1.0f), i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 53), std::floor(samplesPerLoop/4) + i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 53, 1.0f), std::floor(samplesPerLoop*3/8) + i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 53), std::floor(samplesPerLoop/2) + i*samplesPerLoop - 512);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 60, 1.0f), std::floor(samplesPerLoop/2) + i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 60), std::floor(samplesPerLoop*3/4) + i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 60, 1.0f), std::floor(samplesPerLoop*7/8) + i*samplesPerLoop);
-	// rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 60), std::floor(samplesPerLoop) + i*samplesPerLoop - 512);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 59, 1.0f), i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 53, 1.0f), i * samplesPerLoop + 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 43, 1.0f), i * samplesPerLoop + 2);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 59), std::floor(samplesPerLoop*5/24) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 53), std::floor(samplesPerLoop*5/24) + i * samplesPerLoop - 2);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 43), std::floor(samplesPerLoop*5/24) + i * samplesPerLoop - 3);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 31, 1.0f), std::floor(samplesPerLoop*5/24) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 31), std::floor(samplesPerLoop*1/4) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 43, 1.0f), std::floor(samplesPerLoop*1/2) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 43), std::floor(samplesPerLoop*17/24) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 31, 1.0f), std::floor(samplesPerLoop*17/24) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 31), std::floor(samplesPerLoop*3/4) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 36, 1.0f), std::floor(samplesPerLoop*20/24) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 36), std::floor(samplesPerLoop*7/8) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 37, 1.0f), std::floor(samplesPerLoop*7/8) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 37), std::floor(samplesPerLoop*23/24) + i * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 38, 1.0f), std::floor(samplesPerLoop*23/24) + i * samplesPerLoop);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 38), (i+1) * samplesPerLoop - 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 54, 1.0f), std::floor(samplesPerLoop*23/24) + i * samplesPerLoop + 1);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 54), (i+1) * samplesPerLoop - 2);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOn(0, 58, 1.0f), std::floor(samplesPerLoop*23/24) + i * samplesPerLoop + 2);
-	rythmSectionBuffer.addEvent(juce::MidiMessage::noteOff(0, 58), (i+1) * samplesPerLoop - 3);
-  }
-}
-
-void LooperAudioSource::evaluateGuess()
-{
-  // int samplesGotRight = 0;
-  // int samplesInPhrase = 0;
-  int notesGotRight = 0, notesInTotal = 0;
-  juce::MidiBufferIterator phraseIterator = phraseBuffer.begin();
-  for (auto currentMidiMessageMetadata : phraseBuffer) {
-	auto currentMidiEvent = (*phraseIterator).getMessage();
-	// std::cout << "-------------------------------------\n";
-	// std::cout << "currentMidiEvent: " << currentMidiEvent.getDescription() <<"\n";
-	auto correctNote = (currentMidiEvent.isNoteOn())
-	  ? currentMidiEvent.getNoteNumber()
-	  : 0;
-	auto noteFrom = currentMidiEvent.getTimeStamp();
-	auto noteTo = (*(++phraseIterator)).getMessage().getTimeStamp();
-	// std::cout << "Note duration is from " << noteFrom << " to " << noteTo << "\n";
-	if (correctNote == 0)
-	  continue;
-	// samplesInPhrase += noteTo - noteFrom;
-	int samplesGotRight = 0;
-	auto guessIterator = guessBuffer.findNextSamplePosition (noteFrom);
-	for (auto currentGuessMidiMessageMetadata : guessBuffer) {
-	  auto currentGuessMidiEvent = (*guessIterator).getMessage();
-	  // std::cout << "currentGuessMidiEvent: " << currentGuessMidiEvent.getDescription() <<"\n";
-	  if (noteTo < currentGuessMidiEvent.getTimeStamp()) {
-		if (currentGuessMidiEvent.getNoteNumber() == correctNote)
-		  samplesGotRight += noteTo - noteFrom;
-		break;
-	  }
-	  if (currentGuessMidiEvent.getNoteNumber() != correctNote) {
-		++guessIterator;
-		continue;
-	  }
-	  if (currentGuessMidiEvent.isNoteOff()
-		  && currentGuessMidiEvent.getNoteNumber() == correctNote) {
-		samplesGotRight += currentGuessMidiEvent.getTimeStamp() - noteFrom;
-	  }
-	  // TODO: handle events other than noteOn/noteOff
-	  auto nextGuessMidiEvent = (*(++guessIterator)).getMessage();
-	  while (!nextGuessMidiEvent.isNoteOn()
-			 && nextGuessMidiEvent.getNoteNumber() != correctNote)
-		nextGuessMidiEvent = (*(++guessIterator)).getMessage();		  
-	  // std::cout << "Note duration is from " << currentGuessMidiEvent.getTimeStamp() << " to " << nextGuessMidiEvent.getTimeStamp() << "\n";
-	  if (nextGuessMidiEvent.isNoteOff()) {
-		if (noteTo > nextGuessMidiEvent.getTimeStamp()) {
-		  samplesGotRight += nextGuessMidiEvent.getTimeStamp() - currentGuessMidiEvent.getTimeStamp();
-		  ++guessIterator;
-		  continue;
-		} else {
-		  samplesGotRight += noteTo - currentGuessMidiEvent.getTimeStamp();
-		  break;
-		}
-	  } else {
-		if (noteTo > nextGuessMidiEvent.getTimeStamp()) {
-		  samplesGotRight += nextGuessMidiEvent.getTimeStamp() - currentGuessMidiEvent.getTimeStamp();
-		  continue;
-		} else {
-		  samplesGotRight += noteTo - currentGuessMidiEvent.getTimeStamp();
-		  break;
-		}
-	  }
-			
-	}
-	std::cout << "Note: " << currentMidiEvent.getDescription() << "\n";
-	std::cout << (float) samplesGotRight / (float) (noteTo - noteFrom) << "\n";
-	if ((float) samplesGotRight / (float) (noteTo - noteFrom) > 0.3) 
-	  notesGotRight++;
-	notesInTotal++;
-  }
-  std::cout << "You got " << notesGotRight << " out of "<< notesInTotal << " notes right this loop.\n";
-
-  if (notesGotRight == notesInTotal)
-	generateNextPhrase();
-}
-
-void LooperAudioSource::generateNextPhrase() {
-  phraseBuffer.clear();
-
-  int diatonic[7] = {0, 2, 4, 5, 7, 9, 11};
-  // int first = random.nextInt(12) + 60;
-  int first = 60;
-  
-  for (int i = 0; i < 4; i++) {
-	int n = diatonic[random.nextInt(7)] + first;
-	phraseBuffer.addEvent(juce::MidiMessage::noteOn(1, n, 1.0f), i * samplesPerLoop / 8 + 400);
-	phraseBuffer.addEvent(juce::MidiMessage::noteOff(1, n), (i + 1) * samplesPerLoop / 8 - 1);
-  }
-}
-
-void LooperAudioSource::prepareToPlay (int /*samplesPerBlockExpected*/, double sampleRate)
-{
-  synth.setCurrentPlaybackSampleRate (sampleRate); // [3]
-  midiCollector.reset (sampleRate);
-  setupRythmSection ();
-
-  // auto one12thNote = std::floor(samplesPerLoop / 12 / 2);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 67, 1.0f), 0);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 67), one12thNote * 2 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 69, 1.0f), one12thNote * 2);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 69), one12thNote * 3 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 70, 1.0f), one12thNote * 3);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 70), one12thNote * 5 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 72, 1.0f), one12thNote * 5);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 72), one12thNote * 6 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 69, 1.0f), one12thNote * 6);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 69), one12thNote * 9 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 65, 1.0f), one12thNote * 9);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 65), one12thNote * 11 - 1);
-  // phrases[0].addEvent (juce::MidiMessage::noteOn (1, 67, 1.0f), one12thNote * 11);
-  // phrases[0].addEvent (juce::MidiMessage::noteOff (1, 67), one12thNote *12 - 1);
-  // savePhrases();
-  
-  
-  loadPhrases();
-  std::cout << "Number of events in phrases[0]: " << phrases[0].getNumEvents() << "\n";
-  setupPhrase();
-  // savePhrases();
-  generateNextPhrase();
-}
-
-void LooperAudioSource::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
-{
-  // std::cout << currentPhase << "\n";
-  bufferToFill.clearActiveBufferRegion();
-
-  juce::MidiBuffer incomingMidi;
-  midiCollector.removeNextBlockOfMessages (incomingMidi, bufferToFill.numSamples);
-  keyboardState.processNextMidiBuffer (incomingMidi, bufferToFill.startSample,
-									   bufferToFill.numSamples, true);       // [4]
-	
-  // Adding scripted midi events
-  incomingMidi.addEvents(rythmSectionBuffer, currentCyclePos, bufferToFill.numSamples, 0);
-  switch (currentPhase) {
-  case 1: 
-	incomingMidi.addEvents (phraseBuffer, currentCyclePos, bufferToFill.numSamples, 0);
-	break;
-  case 2:
-	// std::cout << "Listening... (currentPhase: 1)\n";
-	guessBuffer.addEvents (incomingMidi, 0, bufferToFill.numSamples, currentCyclePos);
-	break;
-  default:
-	// std::cout << "Waiting... (currentPhase: 0)\n";
-	break;
-  }
-  synth.renderNextBlock (*bufferToFill.buffer, incomingMidi,
-						 bufferToFill.startSample, bufferToFill.numSamples); // [5]
-  currentCyclePos += bufferToFill.numSamples;
-  if (currentCyclePos >= samplesPerLoop)
-	{
-	  currentCyclePos -= samplesPerLoop;
-	  if (currentPhase==1)
-		currentPhase = 2;
-	  else
-		{
-		  currentPhase = 1;
-		  evaluateGuess();
-		  // generateNextPhrase();
-		  guessBuffer.clear();
-		}
-	}
-}
-    
-juce::MidiMessageCollector* LooperAudioSource::getMidiCollector()
-{
-  return &midiCollector;
-}
-
-
-//==============================================================================
-MainComponent::MainComponent()
-  : synthAudioSource (keyboardState),
-	keyboardComponent (keyboardState, juce::MidiKeyboardComponent::verticalKeyboardFacingLeft),
-	audioSetupComp (deviceManager,
-					0,     // minimum input channels
-					256,   // maximum input channels
-					0,     // minimum output channels
-					256,   // maximum output channels
-					false, // ability to select midi inputs
-					false, // ability to select midi output device
-					false, // treat channels as stereo pairs
-					false), // hide advanced options
-	loopProgressBar (progressInLoop),
-	chordName ("Cm7b5")
-{
-  addAndMakeVisible (bgImage);
-
-  addAndMakeVisible (chordName);
-
-  addAndMakeVisible (keyboardComponent);
-
-  loopProgressBar.setLookAndFeel (&progressBarLaF);
-
-  loopProgressBar.setColour (juce::ProgressBar::ColourIds::foregroundColourId,
-							 juce::Colour (255, 118, 118));
-  loopProgressBar.setColour (juce::ProgressBar::ColourIds::backgroundColourId,
-							 juce::Colour (84, 84, 84));
-  loopProgressBar.setPercentageDisplay (false);
-
-  addAndMakeVisible (loopProgressBar);
-
-  addAndMakeVisible (audioSetupComp);
-
-  // Make sure you set the size of the component after
-  // you add any child components.
-  setSize (1920, 1080);
-
-  loadBgImage();
-  
-  setAudioChannels (0, 2);
-
-  secondsPerLoop = 5;
-
-  startTimerHz (timerHz);
-  addAndMakeVisible (midiInputListLabel);
-  midiInputListLabel.setText ("MIDI Input:", juce::dontSendNotification);
-  midiInputListLabel.attachToComponent (&midiInputList, true);
- 
-  auto midiInputs = juce::MidiInput::getAvailableDevices();
-  addAndMakeVisible (midiInputList);
-  midiInputList.setTextWhenNoChoicesAvailable ("No MIDI Inputs Enabled");
- 
-  juce::StringArray midiInputNames;
-  for (auto input : midiInputs)
-	midiInputNames.add (input.name);
- 
-  midiInputList.addItemList (midiInputNames, 1);
-  midiInputList.onChange = [this] { setMidiInput (midiInputList.getSelectedItemIndex()); };
- 
-  for (auto input : midiInputs)
-	{
-	  if (deviceManager.isMidiInputDeviceEnabled (input.identifier))
-		{
-		  setMidiInput (midiInputs.indexOf (input));
-		  break;
-		}
-	}
- 
-  if (midiInputList.getSelectedId() == 0)
-	setMidiInput (0);
-  
-}
-
-MainComponent::~MainComponent()
-{
-  // This shuts down the audio device and clears the audio source.
-  shutdownAudio();
-}
-
-void MainComponent::setMidiInput (int index)
-{
-  auto list = juce::MidiInput::getAvailableDevices();
- 
-  deviceManager.removeMidiInputDeviceCallback (list[lastInputIndex].identifier, synthAudioSource.getMidiCollector());
- 
-  auto newInput = list[index];
- 
-  if (! deviceManager.isMidiInputDeviceEnabled (newInput.identifier))
-	deviceManager.setMidiInputDeviceEnabled (newInput.identifier, true);
- 
-  deviceManager.addMidiInputDeviceCallback (newInput.identifier, synthAudioSource.getMidiCollector());
-  midiInputList.setSelectedId (index + 1, juce::dontSendNotification);
- 
-  lastInputIndex = index;
-}
-
-void MainComponent::loadBgImage()
-{
-  const auto bgImageFile = juce::File ("/home/roy/Code/melodious/Melodious/Source/res/houses.png");
-  if (bgImageFile.exists())
-	{
-	  juce::FileInputStream inputStreamRef (bgImageFile);
-	  if (inputStreamRef.openedOk())
-		bgImage.setImage (juce::PNGImageFormat::loadFrom (inputStreamRef), juce::RectanglePlacement (128));
-	  else
-		std::cout << "ERROR: Problem opening input stream for background image";
-	}
-  else
-	std::cout << "ERROR: Background image file does not exist\n";
-}
-
-//==============================================================================
-void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
-{
-  // This function will be called when the audio device is started, or when
-  // its settings (i.e. sample rate, block size, etc) are changed.
-
-  // You can use this function to initialise any resources you might need,
-  // but be careful - it will be called on the audio thread, not the GUI thread.
-
-  // For more details, see the help for AudioProcessor::prepareToPlay()
-  std::cout << "sampleRate: " << sampleRate << ", secondsPerLoop: " << secondsPerLoop << "\n";
-  // for some reason, secondsPerLoop is 0 when accessed from here
-  secondsPerLoop = 5;
-  synthAudioSource.setupSamplesPerLoop (sampleRate * secondsPerLoop);
-  synthAudioSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
-
-  
-  Timer::callAfterDelay (400,
-						[&] () { keyboardComponent.grabKeyboardFocus(); });
-}
-
-void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
-{
-  // Your audio-processing code goes here!
-
-  // For more details, see the help for AudioProcessor::getNextAudioBlock()
-
-  // Right now we are not producing any data, in which case we need to clear the buffer
-  // (to prevent the output of random noise)
-  synthAudioSource.getNextAudioBlock (bufferToFill);
-}
-
-void MainComponent::releaseResources()
-{
-  // This will be called when the audio device stops, or when it is being
-  // restarted due to a setting change.
-
-  // For more details, see the help for AudioProcessor::releaseResources()
-  synthAudioSource.releaseResources();
-}
-
-//==============================================================================
-void MainComponent::paint (juce::Graphics& g)
-{
-  // (Our component is opaque, so we must completely fill the background with a solid colour)
-  g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
-
-}
-
-void MainComponent::timerCallback()
-{
-  // Animation update here
-  timerCounter++;
-  progressInLoop = (float) (timerCounter % (timerHz * secondsPerLoop)) / (float) (timerHz * secondsPerLoop);
-  if (timerCounter % (timerHz * secondsPerLoop) == 0)
-	{
-	  if ((timerCounter % (timerHz * secondsPerLoop * 2)) == timerHz * secondsPerLoop)
-		loopProgressBar.setColour (juce::ProgressBar::ColourIds::foregroundColourId,
-								   juce::Colour (20, 255, 0));
-	  else
-		loopProgressBar.setColour (juce::ProgressBar::ColourIds::foregroundColourId,
-								   juce::Colour (255, 118, 118));
-	}
-  
-}
-
-void MainComponent::resized()
-{
-  // This is called when the MainContentComponent is resized.
-  // If you add any child components, this is where you should
-  // update their positions.auto rect = getLocalBounds();
-
-  chordName.setBounds (getWidth() - 400, 100, 400, 128);
-  bgImage.setBounds (0, 0, getWidth(), getHeight());
-  auto rect = getLocalBounds();
-  audioSetupComp.setBounds (rect.removeFromLeft (proportionOfWidth (0.6f)));
-  midiInputList    .setBounds (200, 10, getWidth() - 210, 20);
-  keyboardComponent.setKeyWidth ((float) getHeight() / (float) 52);
-  keyboardComponent.setLowestVisibleKey (21);
-  keyboardComponent.setAvailableRange (21, 108);
-  keyboardComponent.setBounds (0, 0, 100, getHeight());
-  loopProgressBar.setBounds(getWidth() - 100, getHeight() - 100, 80, 80);
-}
-
+#include "MainComponent.h"
+#include "EngineLog.h"
+
+//----------------------------------------------------------------------------------------------------
+
+CircularProgressBarLaF::CircularProgressBarLaF (float elv = 0.6f)
+  : elevation (elv) {}
+
+void CircularProgressBarLaF::drawProgressBar (juce::Graphics& g, juce::ProgressBar& progressBar,
+											  int, int, double progress,
+											  const juce::String&)
+{
+  drawProgressRing (g, progressBar);
+  drawProgressArc (g, progressBar, progress);
+}
+
+void CircularProgressBarLaF::drawProgressRing (juce::Graphics& g, juce::ProgressBar& progressBar)
+{
+  auto barBounds = progressBar.getLocalBounds();
+  juce::Path inner;
+  inner.addCentredArc (barBounds.getCentreX(),
+					   barBounds.getCentreY(),
+					   barBounds.getWidth() * 0.5f * elevation,
+					   barBounds.getHeight() * 0.5f * elevation,
+					   0.0f, 0.0f, juce::MathConstants<float>::twoPi, true);
+  g.setColour (progressBar.findColour (juce::ProgressBar::backgroundColourId));
+  g.strokePath (inner, juce::PathStrokeType (barBounds.getWidth() / 5));
+}
+
+void CircularProgressBarLaF::drawProgressArc (juce::Graphics& g, juce::ProgressBar& progressBar,
+											  double progress)
+{
+  g.setColour (progressBar.findColour (juce::ProgressBar::foregroundColourId));
+  g.strokePath (createArc (progressBar, 0.0, progress),
+				juce::PathStrokeType (progressBar.getWidth() / 5));
+}
+
+juce::Rectangle<int> CircularProgressBarLaF::getProgressArcArea (juce::ProgressBar& progressBar,
+																  double fromProgress, double toProgress)
+{
+  juce::Path stroked;
+  juce::PathStrokeType (progressBar.getWidth() / 5).createStrokedPath (stroked, createArc (progressBar, fromProgress, toProgress));
+
+  // a couple of pixels extra for the antialiased edges
+  return stroked.getBounds().getSmallestIntegerContainer().expanded (2)
+				.getIntersection (progressBar.getLocalBounds());
+}
+
+juce::Path CircularProgressBarLaF::createArc (juce::ProgressBar& progressBar,
+											  double fromProgress, double toProgress) const
+{
+  auto barBounds = progressBar.getLocalBounds();
+  juce::Path outer;
+  outer.addCentredArc (barBounds.getCentreX(),
+					   barBounds.getCentreY(),
+					   barBounds.getWidth() * 2.0f / 5.0f,
+					   barBounds.getHeight() * 2.0f / 5.0f,
+					   0.0f,
+					   juce::MathConstants<float>::twoPi * (float) fromProgress,
+					   juce::MathConstants<float>::twoPi * (float) toProgress,
+					   true);
+  return outer;
+}
+
+//============================================================================
+
+LoopPlayhead::Position LoopProgressBar::getCurrentPosition() const
+{
+  return playhead.read().extrapolatedTo (LoopPlayhead::getHostTimeSeconds());
+}
+
+CircularProgressBarLaF* LoopProgressBar::getCircularLaF()
+{
+  return cachingEnabled ? dynamic_cast<CircularProgressBarLaF*> (&getLookAndFeel()) : nullptr;
+}
+
+void LoopProgressBar::advance()
+{
+  const auto newProgress = getCurrentPosition().getProgress();
+
+  if (newProgress == paintedProgress)
+	return;
+
+  auto* laf = getCircularLaF();
+
+  // going backwards means the loop wrapped, and the whole arc has to go
+  if (laf == nullptr || newProgress < paintedProgress)
+	repaint();
+  else
+	repaint (laf->getProgressArcArea (*this, paintedProgress, newProgress));
+
+  paintedProgress = newProgress;
+}
+
+void LoopProgressBar::setCachingEnabled (bool shouldCache)
+{
+  cachingEnabled = shouldCache;
+  ringCache = {};
+  repaint();
+}
+
+void LoopProgressBar::paint (juce::Graphics& g)
+{
+  auto* laf = getCircularLaF();
+
+  if (laf == nullptr)
+	{
+	  getLookAndFeel().drawProgressBar (g, *this, getWidth(), getHeight(), paintedProgress, {});
+	  return;
+	}
+
+  if (! ringCache.isValid() && ! getLocalBounds().isEmpty())
+	{
+	  const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+	  ringCache = juce::Image (juce::Image::ARGB,
+							   juce::roundToInt (getWidth() * scale),
+							   juce::roundToInt (getHeight() * scale),
+							   true);
+	  juce::Graphics imageGraphics (ringCache);
+	  imageGraphics.addTransform (juce::AffineTransform::scale (scale));
+	  laf->drawProgressRing (imageGraphics, *this);
+	}
+
+  g.drawImage (ringCache, getLocalBounds().toFloat());
+  laf->drawProgressArc (g, *this, paintedProgress);
+}
+
+void LoopProgressBar::resized()
+{
+  ringCache = {};
+}
+
+void LoopProgressBar::lookAndFeelChanged()
+{
+  ringCache = {};
+  juce::ProgressBar::lookAndFeelChanged();
+}
+
+void LoopProgressBar::colourChanged()
+{
+  ringCache = {};
+  juce::ProgressBar::colourChanged();
+}
+
+//============================================================================
+
+void BackgroundImageComponent::setImage (const juce::Image& newImage)
+{
+  sourceImage = newImage;
+  rescale();
+  repaint();
+}
+
+void BackgroundImageComponent::setCachingEnabled (bool shouldCache)
+{
+  cachingEnabled = shouldCache;
+  rescale();
+  repaint();
+}
+
+void BackgroundImageComponent::rescale()
+{
+  scaledImage = {};
+
+  if (! cachingEnabled || ! sourceImage.isValid() || getLocalBounds().isEmpty())
+	return;
+
+  scaledImage = juce::Image (juce::Image::RGB, getWidth(), getHeight(), true);
+  juce::Graphics g (scaledImage);
+  g.setImageResamplingQuality (juce::Graphics::highResamplingQuality);
+  g.drawImage (sourceImage, getLocalBounds().toFloat(), juce::RectanglePlacement::fillDestination);
+}
+
+void BackgroundImageComponent::paint (juce::Graphics& g)
+{
+  if (scaledImage.isValid())
+	{
+	  g.drawImageAt (scaledImage, 0, 0);
+	  return;
+	}
+
+  g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+  if (sourceImage.isValid())
+	g.drawImage (sourceImage, getLocalBounds().toFloat(), juce::RectanglePlacement::fillDestination);
+}
+
+void BackgroundImageComponent::resized()
+{
+  rescale();
+}
+
+//============================================================================
+
+void TitleBeltComponent::paint (juce::Graphics& g)
+{
+  g.fillAll (juce::Colour (0, 71, 87));
+  g.setColour (juce::Colours::white);
+  g.drawLine (8, 12, getWidth() - 8, 12, 8);
+  g.drawLine (8, getHeight() - 12, getWidth() - 8,  getHeight() - 12, 8);
+  g.setFont (96);
+  g.drawText (titleString, 8, 12, getWidth() - 8, getHeight() - 12, juce::Justification::Flags::left);
+}
+
+void TitleBeltComponent::setTitle (const juce::String& newTitle)
+{
+  if (newTitle == titleString)
+	return;
+
+  titleString = newTitle;
+  repaint();
+}
+
+//==============================================================================
+MidiLatencyOverlay::MidiLatencyOverlay()
+{
+  setInterceptsMouseClicks (false, false);
+}
+
+void MidiLatencyOverlay::addRecords (const MidiLatencyMonitor::Record* records, int numRecords,
+									 int numDroppedSoFar)
+{
+  if (numRecords == 0 && numDroppedSoFar == numDropped)
+	return;
+
+  numDropped = numDroppedSoFar;
+
+  for (int i = 0; i < numRecords; ++i)
+	latencies.add (records[i].getLatencySeconds() * 1000.0);
+
+  if (latencies.isEmpty())
+	return;
+
+  auto sorted = latencies.getValues();
+  sorted.sort();
+  median = getPercentile (sorted, 50);
+  percentile99 = getPercentile (sorted, 99);
+  worst = sorted.getLast();
+
+  latencyHistogram.clear();
+  jitterHistogram.clear();
+  auto sumOfSquares = 0.0;
+
+  for (auto latency : latencies.getValues())
+	{
+	  latencyHistogram.add (latency);
+	  jitterHistogram.add (latency - median);
+	  sumOfSquares += (latency - median) * (latency - median);
+	}
+
+  deviation = std::sqrt (sumOfSquares / latencies.size());
+  repaint();
+}
+
+void MidiLatencyOverlay::paint (juce::Graphics& g)
+{
+  g.fillAll (juce::Colours::black.withAlpha (0.75f));
+
+  auto area = getLocalBounds().reduced (10);
+  g.setColour (juce::Colours::white);
+  g.setFont (14.0f);
+  g.drawText (latencies.isEmpty() ? juce::String ("MIDI input to sound: play something")
+								  : "MIDI input to sound, last " + juce::String (latencies.size()) + " notes: median "
+									+ juce::String (median, 2) + " ms, 99% " + juce::String (percentile99, 2)
+									+ " ms, worst " + juce::String (worst, 2) + " ms, jitter "
+									+ juce::String (deviation, 2) + " ms rms, " + juce::String (numDropped) + " dropped",
+			  area.removeFromTop (20), juce::Justification::centredLeft);
+
+  area.removeFromTop (6);
+  drawHistogram (g, area.removeFromTop (area.getHeight() / 2 - 3), latencyHistogram, "Latency (ms)");
+  area.removeFromTop (6);
+  drawHistogram (g, area, jitterHistogram, "Jitter around the median (ms)");
+}
+
+void MidiLatencyOverlay::drawHistogram (juce::Graphics& g, juce::Rectangle<int> area,
+										const MidiLatencyMonitor::Histogram& histogram,
+										const juce::String& title) const
+{
+  g.setColour (juce::Colours::white);
+  g.setFont (12.0f);
+  g.drawText (title, area.removeFromTop (16), juce::Justification::centredLeft);
+
+  auto labels = area.removeFromBottom (14);
+  g.drawText (juce::String (histogram.getBinStart (0), 1), labels, juce::Justification::centredLeft);
+  g.drawText (juce::String (histogram.getBinStart (histogram.getNumBins()), 1), labels,
+			  juce::Justification::centredRight);
+
+  g.setColour (juce::Colour (20, 255, 0));
+  const auto barWidth = (float) area.getWidth() / (float) histogram.getNumBins();
+
+  for (int bin = 0; bin < histogram.getNumBins(); ++bin)
+	{
+	  if (histogram.getCount (bin) == 0)
+		continue;
+
+	  const auto height = (float) area.getHeight() * (float) histogram.getCount (bin)
+		/ (float) histogram.getMaxCount();
+	  g.fillRect (area.getX() + bin * barWidth, (float) area.getBottom() - height,
+				  juce::jmax (1.0f, barWidth - 1.0f), height);
+	}
+}
+
+//==============================================================================
+void BlockMetricsOverlay::setSummary (const AudioBlockMetrics::Summary& summary, int deviceXRuns,
+									  int streamingUnderruns)
+{
+  const auto percent = [] (double load) { return juce::String (load * 100.0, 1) + "%"; };
+  const auto micros = [] (double seconds) { return juce::String (seconds * 1.0e6, 0) + " us"; };
+
+  juce::StringArray newLines;
+  newLines.add ("Audio, last " + juce::String (summary.numBlocks) + " blocks (median / 99% / max)");
+  newLines.add ("Load: " + percent (summary.loadMedian) + " / " + percent (summary.load99)
+				+ " / " + percent (summary.loadMax));
+  newLines.add ("Callback: " + micros (summary.callbackMedian) + " / " + micros (summary.callback99)
+				+ " / " + micros (summary.callbackMax));
+  newLines.add ("Voices: " + juce::String (summary.voicesMedian) + " median, "
+				+ juce::String (summary.voicesMax) + " at most");
+  newLines.add ("MIDI events: up to " + juce::String (summary.midiEventsMax) + " a block");
+  newLines.add ("Late callbacks: " + juce::String (summary.numLate) + " recently, "
+				+ juce::String (summary.totalLate) + " in all; device xruns: "
+				+ (deviceXRuns >= 0 ? juce::String (deviceXRuns) : juce::String ("n/a")));
+  newLines.add ("Sample streaming underruns: " + juce::String (streamingUnderruns));
+
+  if (newLines == lines)
+	return;
+
+  lines = newLines;
+  repaint();
+}
+
+void BlockMetricsOverlay::paint (juce::Graphics& g)
+{
+  g.fillAll (juce::Colours::black.withAlpha (0.75f));
+  g.setColour (juce::Colours::white);
+  g.setFont (14.0f);
+
+  auto area = getLocalBounds().reduced (10);
+
+  for (auto& line : lines)
+	g.drawText (line, area.removeFromTop (20), juce::Justification::centredLeft);
+}
+
+//==============================================================================
+MainComponent::MainComponent()
+  : synthAudioSource (keyboardState),
+	keyboardComponent (keyboardState, juce::MidiKeyboardComponent::verticalKeyboardFacingLeft),
+	audioSetupComp (deviceManager,
+					0,     // minimum input channels
+					256,   // maximum input channels
+					0,     // minimum output channels
+					256,   // maximum output channels
+					false, // ability to select midi inputs
+					false, // ability to select midi output device
+					false, // treat channels as stereo pairs
+					false), // hide advanced options
+	loopProgressBar (progressInLoop, synthAudioSource.getPlayhead()),
+	chordName ({})
+{
+  // hears both the MIDI input and the on-screen keyboard
+  keyboardState.addListener (&chordRecogniser);
+
+  addAndMakeVisible (bgImage);
+
+  chordName.setBufferedToImage (true);
+  addAndMakeVisible (chordName);
+
+  addAndMakeVisible (keyboardComponent);
+
+  loopProgressBar.setLookAndFeel (&progressBarLaF);
+
+  loopProgressBar.setColour (juce::ProgressBar::ColourIds::foregroundColourId,
+							 juce::Colour (255, 118, 118));
+  loopProgressBar.setColour (juce::ProgressBar::ColourIds::backgroundColourId,
+							 juce::Colour (84, 84, 84));
+  loopProgressBar.setPercentageDisplay (false);
+
+  addAndMakeVisible (loopProgressBar);
+
+  addAndMakeVisible (audioSetupComp);
+
+  // Make sure you set the size of the component after
+  // you add any child components.
+  setSize (1920, 1080);
+
+  // the phrases and the background arrive later through changeListenerCallback
+  resourceLoader.addChangeListener (this);
+  resourceLoader.startLoading (ResourceLoader::getDefaultPhraseLibraryFile(),
+							   ResourceLoader::getDefaultBackgroundImageFile(),
+							   ResourceLoader::getDefaultGrooveDirectory(),
+							   ResourceLoader::getDefaultInstrumentDirectory());
+  synthAudioSource.bindResources (&resourceLoader);
+  
+  setAudioChannels (0, 2);
+
+  startTimerHz (timerHz);
+  addAndMakeVisible (midiInputListLabel);
+  midiInputListLabel.setText ("MIDI Input:", juce::dontSendNotification);
+  midiInputListLabel.attachToComponent (&midiInputList, true);
+ 
+  auto midiInputs = juce::MidiInput::getAvailableDevices();
+  addAndMakeVisible (midiInputList);
+  midiInputList.setTextWhenNoChoicesAvailable ("No MIDI Inputs Enabled");
+ 
+  juce::StringArray midiInputNames;
+  for (auto input : midiInputs)
+	midiInputNames.add (input.name);
+ 
+  midiInputList.addItemList (midiInputNames, 1);
+  midiInputList.onChange = [this] { setMidiInput (midiInputList.getSelectedItemIndex()); };
+ 
+  for (auto input : midiInputs)
+	{
+	  if (deviceManager.isMidiInputDeviceEnabled (input.identifier))
+		{
+		  setMidiInput (midiInputs.indexOf (input));
+		  break;
+		}
+	}
+ 
+  if (midiInputList.getSelectedId() == 0)
+	setMidiInput (0);
+
+  addAndMakeVisible (waveformListLabel);
+  waveformListLabel.setText ("Sound:", juce::dontSendNotification);
+  waveformListLabel.attachToComponent (&waveformList, true);
+
+  addAndMakeVisible (waveformList);
+  for (int i = 0; i < WavetableBank::numWaveforms; ++i)
+	waveformList.addItem (WavetableBank::getWaveformName ((WavetableBank::Waveform) i), i + 1);
+
+  // the sampled instruments are listed after the waveforms once they've loaded
+  waveformList.onChange = [this]
+	{
+	  const auto id = waveformList.getSelectedId();
+
+	  if (id > WavetableBank::numWaveforms)
+		{
+		  synthAudioSource.setInstrument (resourceLoader.getInstrument (id - WavetableBank::numWaveforms - 1));
+		}
+	  else
+		{
+		  synthAudioSource.setInstrument (nullptr);
+		  synthAudioSource.setWaveform ((WavetableBank::Waveform) (id - 1));
+		}
+	};
+  waveformList.setSelectedId (1, juce::dontSendNotification);
+
+  addAndMakeVisible (grooveListLabel);
+  grooveListLabel.setText ("Groove:", juce::dontSendNotification);
+  grooveListLabel.attachToComponent (&grooveList, true);
+
+  // filled in once the grooves have loaded
+  addAndMakeVisible (grooveList);
+  grooveList.setTextWhenNoChoicesAvailable ("Default");
+  grooveList.onChange = [this] { synthAudioSource.setGroove (grooveList.getSelectedItemIndex()); };
+
+  addAndMakeVisible (tempoSliderLabel);
+  tempoSliderLabel.setText ("Tempo:", juce::dontSendNotification);
+  tempoSliderLabel.attachToComponent (&tempoSlider, true);
+
+  // the looper picks the new tempo up at its next loop boundary
+  addAndMakeVisible (tempoSlider);
+  tempoSlider.setRange (40.0, 200.0, 1.0);
+  tempoSlider.setTextValueSuffix (" BPM");
+  tempoSlider.setValue (synthAudioSource.getTransportSettings().bpm, juce::dontSendNotification);
+  tempoSlider.onValueChange = [this]
+	{
+	  auto settings = synthAudioSource.getTransportSettings();
+	  settings.bpm = tempoSlider.getValue();
+	  synthAudioSource.setTransport (settings);
+	};
+
+  // the student taps a key along with the clicks; see LatencyCalibrator
+  addAndMakeVisible (calibrateButton);
+  calibrateButton.onClick = [this]
+	{
+	  auto& calibrator = synthAudioSource.getLatencyCalibrator();
+
+	  if (calibrator.getState() == LatencyCalibrator::State::running)
+		calibrator.cancel();
+	  else
+		calibrator.start();
+
+	  keyboardComponent.grabKeyboardFocus();
+	};
+
+  addAndMakeVisible (latencyLabel);
+
+  // a voice or an instrument answers instead of the MIDI keyboard; the
+  // device is reopened with its first input channel for the pitch tracker
+  addAndMakeVisible (audioInputButton);
+  audioInputButton.onClick = [this]
+	{
+	  const auto listening = audioInputButton.getToggleState();
+	  auto setup = deviceManager.getAudioDeviceSetup();
+	  setup.useDefaultInputChannels = false;
+	  setup.inputChannels.clear();
+
+	  if (listening)
+		setup.inputChannels.setBit (0);
+
+	  const auto error = deviceManager.setAudioDeviceSetup (setup, true);
+
+	  if (error.isNotEmpty())
+		EngineLog::error ("{}", error);
+
+	  synthAudioSource.setAudioInputEnabled (listening && error.isEmpty());
+	};
+
+  // a new device or block size brings its own latency with it
+  deviceManager.addChangeListener (this);
+  loadLatencyForCurrentSetup();
+}
+
+MainComponent::~MainComponent()
+{
+  // This shuts down the audio device and clears the audio source.
+  shutdownAudio();
+  keyboardState.removeListener (&chordRecogniser);
+  resourceLoader.removeChangeListener (this);
+  deviceManager.removeChangeListener (this);
+}
+
+void MainComponent::setMidiInput (int index)
+{
+  auto list = juce::MidiInput::getAvailableDevices();
+ 
+  deviceManager.removeMidiInputDeviceCallback (list[lastInputIndex].identifier, synthAudioSource.getMidiInputQueue());
+ 
+  auto newInput = list[index];
+ 
+  if (! deviceManager.isMidiInputDeviceEnabled (newInput.identifier))
+	deviceManager.setMidiInputDeviceEnabled (newInput.identifier, true);
+ 
+  deviceManager.addMidiInputDeviceCallback (newInput.identifier, synthAudioSource.getMidiInputQueue());
+  midiInputList.setSelectedId (index + 1, juce::dontSendNotification);
+ 
+  lastInputIndex = index;
+  loadLatencyForCurrentSetup();
+}
+
+void MainComponent::setRenderCacheEnabled (bool shouldCache)
+{
+  bgImage.setCachingEnabled (shouldCache);
+  chordName.setBufferedToImage (shouldCache);
+  loopProgressBar.setCachingEnabled (shouldCache);
+}
+
+void MainComponent::setUiMeasurementEnabled (bool shouldMeasure)
+{
+  if (shouldMeasure)
+	uiProfiler.reset (new UiFrameProfiler());
+  else
+	uiProfiler.reset();
+}
+
+juce::PropertiesFile::Options MainComponent::createSettingsFileOptions()
+{
+  juce::PropertiesFile::Options options;
+  options.applicationName = "Melodious";
+  options.filenameSuffix = ".settings";
+  options.folderName = "Melodious";
+  options.osxLibrarySubFolder = "Application Support";
+  return options;
+}
+
+juce::String MainComponent::getLatencySettingKey() const
+{
+  auto* device = deviceManager.getCurrentAudioDevice();
+
+  if (device == nullptr)
+	return {};
+
+  return "latency " + device->getTypeName() + " / " + device->getName()
+	+ " / " + juce::String (device->getCurrentSampleRate()) + " Hz / "
+	+ juce::String (device->getCurrentBufferSizeSamples()) + " samples / "
+	+ juce::MidiInput::getAvailableDevices()[lastInputIndex].name;
+}
+
+void MainComponent::loadLatencyForCurrentSetup()
+{
+  const auto key = getLatencySettingKey();
+  synthAudioSource.setLatencyCompensation (key.isNotEmpty() ? settingsFile.getDoubleValue (key) : 0.0);
+  updateLatencyLabel();
+}
+
+void MainComponent::updateLatencyLabel()
+{
+  const auto& calibrator = synthAudioSource.getLatencyCalibrator();
+
+  if (calibrator.getState() == LatencyCalibrator::State::running)
+	{
+	  latencyLabel.setText ("Tap along with the clicks: "
+							+ juce::String (calibrator.getNumTapsHeard()) + " of "
+							+ juce::String (LatencyCalibrator::numTapsToIgnore + LatencyCalibrator::numTapsToMeasure),
+							juce::dontSendNotification);
+	  calibrateButton.setButtonText ("Cancel");
+	}
+  else
+	{
+	  latencyLabel.setText ("Latency: " + juce::String (juce::roundToInt (synthAudioSource.getLatencyCompensation() * 1000.0))
+							+ " ms", juce::dontSendNotification);
+	  calibrateButton.setButtonText ("Calibrate latency");
+	}
+}
+
+void MainComponent::setMidiLatencyOverlayEnabled (bool shouldShow)
+{
+  if (shouldShow)
+	{
+	  midiLatencyOverlay.reset (new MidiLatencyOverlay());
+	  addAndMakeVisible (*midiLatencyOverlay);
+	  resized();
+	}
+  else
+	{
+	  midiLatencyOverlay.reset();
+	}
+
+  synthAudioSource.getMidiLatencyMonitor().setEnabled (midiLatencyOverlay != nullptr || midiLatencyCsv != nullptr);
+}
+
+void MainComponent::setMidiLatencyCsvFile (const juce::File& file)
+{
+  midiLatencyCsv.reset();
+  file.deleteFile();
+  auto stream = std::make_unique<juce::FileOutputStream> (file);
+
+  if (stream->openedOk())
+	{
+	  stream->writeText (MidiLatencyMonitor::getCsvHeader() + "\n", false, false, nullptr);
+	  midiLatencyCsv = std::move (stream);
+	}
+  else
+	{
+	  EngineLog::error ("could not write {}", file.getFullPathName());
+	}
+
+  synthAudioSource.getMidiLatencyMonitor().setEnabled (midiLatencyOverlay != nullptr || midiLatencyCsv != nullptr);
+}
+
+void MainComponent::setBlockMetricsOverlayEnabled (bool shouldShow)
+{
+  if (shouldShow)
+	{
+	  blockMetricsOverlay.reset (new BlockMetricsOverlay());
+	  addAndMakeVisible (*blockMetricsOverlay);
+	  resized();
+	}
+  else
+	{
+	  blockMetricsOverlay.reset();
+	}
+
+  updateBlockMetricsEnabled();
+}
+
+void MainComponent::setBlockMetricsLogFile (const juce::File& file)
+{
+  blockMetricsLog.reset();
+  auto stream = std::make_unique<juce::FileOutputStream> (file);
+
+  if (stream->openedOk())
+	blockMetricsLog = std::move (stream);
+  else
+	EngineLog::error ("could not write {}", file.getFullPathName());
+
+  updateBlockMetricsEnabled();
+}
+
+// A session starts at prepareToPlay, so the device is reopened to start one now
+void MainComponent::setSessionRecordingFile (const juce::File& file)
+{
+  deviceManager.closeAudioDevice();
+  sessionRecorder.setFile (file);
+  synthAudioSource.setSessionSink (&sessionRecorder);
+  deviceManager.restartLastAudioDevice();
+}
+
+void MainComponent::setOutputCaptureFile (const juce::File& file)
+{
+  deviceManager.closeAudioDevice();
+  outputCaptureFile = file;
+  numOutputCaptures = 0;
+  deviceManager.restartLastAudioDevice();
+}
+
+// Every device start begins a file of its own, as its sample rate may differ:
+// the first capture goes to the file given, the next to "name-2.wav" and so on
+void MainComponent::startOutputCapture (double sampleRate)
+{
+  auto* device = deviceManager.getCurrentAudioDevice();
+
+  if (outputCaptureFile == juce::File() || device == nullptr)
+	return;
+
+  ++numOutputCaptures;
+  const auto file = numOutputCaptures == 1
+					  ? outputCaptureFile
+					  : outputCaptureFile.getSiblingFile (outputCaptureFile.getFileNameWithoutExtension() + "-"
+														  + juce::String (numOutputCaptures)
+														  + outputCaptureFile.getFileExtension());
+  juce::String error;
+
+  if (outputCapture.start (file, sampleRate, device->getActiveOutputChannels().countNumberOfSetBits(), error))
+	EngineLog::info ("Capturing the output to {}", file.getFullPathName());
+  else
+	EngineLog::error ("{}", error);
+}
+
+void MainComponent::updateBlockMetricsEnabled()
+{
+  synthAudioSource.getBlockMetrics().setEnabled (blockMetricsOverlay != nullptr || blockMetricsLog != nullptr);
+}
+
+// Message thread: the overlay is refreshed a few times a second, the log every five seconds
+void MainComponent::readBlockMetrics()
+{
+  if (! synthAudioSource.getBlockMetrics().isEnabled())
+	return;
+
+  blockMetricsWindow.update (synthAudioSource.getBlockMetrics());
+
+  const auto now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+  const auto showOverlay = blockMetricsOverlay != nullptr && now - lastOverlayUpdate >= 0.25;
+  const auto writeLog = blockMetricsLog != nullptr && now - lastLogWrite >= 5.0;
+
+  if (! showOverlay && ! writeLog)
+	return;
+
+  const auto summary = blockMetricsWindow.getSummary();
+  auto* device = deviceManager.getCurrentAudioDevice();
+  const auto deviceXRuns = device != nullptr ? device->getXRunCount() : -1;
+
+  if (showOverlay)
+	{
+	  blockMetricsOverlay->setSummary (summary, deviceXRuns, synthAudioSource.getNumStreamingUnderruns());
+	  lastOverlayUpdate = now;
+	}
+
+  if (writeLog)
+	{
+	  blockMetricsLog->writeText (juce::Time::getCurrentTime().toISO8601 (true) + " " + summary.toString()
+								  + ", device xruns " + juce::String (deviceXRuns) + ", streaming underruns "
+								  + juce::String (synthAudioSource.getNumStreamingUnderruns()) + "\n", false, false, nullptr);
+	  blockMetricsLog->flush();
+	  lastLogWrite = now;
+	}
+}
+
+// Message thread: empties the monitor's ring buffer into the overlay and the CSV file
+void MainComponent::readMidiLatencyRecords()
+{
+  auto& monitor = synthAudioSource.getMidiLatencyMonitor();
+
+  if (! monitor.isEnabled())
+	return;
+
+  MidiLatencyMonitor::Record records[256];
+
+  for (;;)
+	{
+	  const auto numRead = monitor.readRecords (records, juce::numElementsInArray (records));
+
+	  if (midiLatencyOverlay != nullptr)
+		midiLatencyOverlay->addRecords (records, numRead, monitor.getNumDropped());
+
+	  if (midiLatencyCsv != nullptr)
+		{
+		  for (int i = 0; i < numRead; ++i)
+			midiLatencyCsv->writeText (MidiLatencyMonitor::toCsvLine (records[i]) + "\n", false, false, nullptr);
+
+		  if (numRead > 0)
+			midiLatencyCsv->flush();
+		}
+
+	  if (numRead < juce::numElementsInArray (records))
+		break;
+	}
+}
+
+void MainComponent::changeListenerCallback (juce::ChangeBroadcaster* source)
+{
+  if (source == &deviceManager)
+	{
+	  loadLatencyForCurrentSetup();
+	  return;
+	}
+
+  if (source == &resourceLoader && ! bgImage.getImage().isValid())
+	{
+	  auto image = resourceLoader.getBackgroundImage();
+	  if (image.isValid())
+		bgImage.setImage (image);
+	}
+
+  if (source == &resourceLoader && grooveList.getNumItems() == 0)
+	{
+	  for (int i = 0; i < resourceLoader.getNumGrooves(); ++i)
+		grooveList.addItem (resourceLoader.getGroove (i)->getName(), i + 1);
+
+	  if (grooveList.getNumItems() > 0)
+		grooveList.setSelectedItemIndex (0, juce::dontSendNotification);
+	}
+
+  if (source == &resourceLoader && waveformList.getNumItems() == WavetableBank::numWaveforms)
+	{
+	  for (int i = 0; i < resourceLoader.getNumInstruments(); ++i)
+		waveformList.addItem (resourceLoader.getInstrument (i)->getName() + " (sampled)",
+							  WavetableBank::numWaveforms + i + 1);
+	}
+}
+
+//==============================================================================
+void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
+{
+  // This function will be called when the audio device is started, or when
+  // its settings (i.e. sample rate, block size, etc) are changed.
+
+  // You can use this function to initialise any resources you might need,
+  // but be careful - it will be called on the audio thread, not the GUI thread.
+
+  // For more details, see the help for AudioProcessor::prepareToPlay()
+  EngineLog::info ("sampleRate: {}, tempo: {} BPM", sampleRate, synthAudioSource.getTransportSettings().bpm);
+  synthAudioSource.prepareToPlay (samplesPerBlockExpected, sampleRate);
+  startOutputCapture (sampleRate);
+
+  
+  Timer::callAfterDelay (400,
+						[&] () { keyboardComponent.grabKeyboardFocus(); });
+}
+
+void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
+{
+  // Your audio-processing code goes here!
+
+  // For more details, see the help for AudioProcessor::getNextAudioBlock()
+
+  // Right now we are not producing any data, in which case we need to clear the buffer
+  // (to prevent the output of random noise)
+  synthAudioSource.getNextAudioBlock (bufferToFill);
+
+  // a copy into a lock-free FIFO; the encoding happens on the exporter's thread
+  if (outputCapture.isActive())
+	outputCapture.write (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+}
+
+void MainComponent::releaseResources()
+{
+  // This will be called when the audio device stops, or when it is being
+  // restarted due to a setting change.
+
+  // For more details, see the help for AudioProcessor::releaseResources()
+  synthAudioSource.releaseResources();
+
+  if (outputCapture.isActive())
+	{
+	  EngineLog::info ("Captured {} s of output to {} ({} blocks dropped)",
+					   juce::String (outputCapture.getNumFramesQueued() / deviceManager.getAudioDeviceSetup().sampleRate, 1),
+					   outputCapture.getFile().getFullPathName(), outputCapture.getNumDroppedBlocks());
+	  outputCapture.stop();
+	}
+}
+
+//==============================================================================
+void MainComponent::paint (juce::Graphics& g)
+{
+  // (Our component is opaque, so we must completely fill the background with a solid colour)
+  g.fillAll (getLookAndFeel().findColour (juce::ResizableWindow::backgroundColourId));
+
+}
+
+void MainComponent::timerCallback()
+{
+  // Animation update here: the position comes from the audio clock, and the
+  // bar only repaints the part of the arc that has moved since the last frame
+  if (uiProfiler != nullptr)
+	uiProfiler->frameStarted();
+
+  auto position = loopProgressBar.getCurrentPosition();
+  progressInLoop = position.getProgress();
+
+  auto phaseColour = position.phase == 2 ? juce::Colour (20, 255, 0)
+										 : juce::Colour (255, 118, 118);
+
+  if (loopProgressBar.findColour (juce::ProgressBar::ColourIds::foregroundColourId) != phaseColour)
+	loopProgressBar.setColour (juce::ProgressBar::ColourIds::foregroundColourId, phaseColour);
+
+  loopProgressBar.advance();
+
+  // the title only changes, and repaints, when the chord held does
+  const auto chord = chordRecogniser.getCurrentChord();
+
+  if (chord != shownChord)
+	{
+	  shownChord = chord;
+	  chordName.setTitle (chord.getName());
+	}
+
+  readMidiLatencyRecords();
+  readBlockMetrics();
+
+  // a sampler voice that found its stream empty played a gap
+  const auto underruns = synthAudioSource.getNumStreamingUnderruns();
+
+  if (underruns != shownStreamingUnderruns)
+	{
+	  EngineLog::error ("Sample streaming underruns so far: {}", underruns);
+	  shownStreamingUnderruns = underruns;
+	}
+
+  // a finished calibration is kept for this setup and used from then on
+  auto& calibrator = synthAudioSource.getLatencyCalibrator();
+  const auto calibrationState = calibrator.getState();
+  const auto tapCount = calibrator.getNumTapsHeard();
+
+  if (calibrationState != shownCalibrationState || tapCount != shownTapCount)
+	{
+	  if (calibrationState == LatencyCalibrator::State::finished
+		  && shownCalibrationState == LatencyCalibrator::State::running)
+		{
+		  synthAudioSource.setLatencyCompensation (calibrator.getLatencySeconds());
+
+		  const auto key = getLatencySettingKey();
+		  if (key.isNotEmpty())
+			{
+			  settingsFile.setValue (key, calibrator.getLatencySeconds());
+			  settingsFile.saveIfNeeded();
+			}
+		}
+
+	  shownCalibrationState = calibrationState;
+	  shownTapCount = tapCount;
+	  updateLatencyLabel();
+	}
+}
+
+void MainComponent::resized()
+{
+  // This is called when the MainContentComponent is resized.
+  // If you add any child components, this is where you should
+  // update their positions.auto rect = getLocalBounds();
+
+  chordName.setBounds (getWidth() - 400, 100, 400, 128);
+  bgImage.setBounds (0, 0, getWidth(), getHeight());
+  auto rect = getLocalBounds();
+  audioSetupComp.setBounds (rect.removeFromLeft (proportionOfWidth (0.6f)));
+  midiInputList    .setBounds (200, 10, getWidth() - 210, 20);
+  waveformList     .setBounds (200, 40, 200, 20);
+  grooveList       .setBounds (200, 70, 200, 20);
+  tempoSlider      .setBounds (200, 100, 300, 20);
+  calibrateButton  .setBounds (200, 130, 140, 20);
+  latencyLabel     .setBounds (350, 130, 250, 20);
+  audioInputButton .setBounds (200, 160, 300, 20);
+  keyboardComponent.setKeyWidth ((float) getHeight() / (float) 52);
+  keyboardComponent.setLowestVisibleKey (21);
+  keyboardComponent.setAvailableRange (21, 108);
+  keyboardComponent.setBounds (0, 0, 100, getHeight());
+  loopProgressBar.setBounds(getWidth() - 100, getHeight() - 100, 80, 80);
+
+  if (midiLatencyOverlay != nullptr)
+	midiLatencyOverlay->setBounds (getWidth() - 620, getHeight() - 360, 500, 340);
+
+  if (blockMetricsOverlay != nullptr)
+	blockMetricsOverlay->setBounds (getWidth() - 620, 240, 500, 160);
+}
+
@@ -1,140 +1,253 @@
-#pragma once
-
-#include <JuceHeader.h>
-
-struct SineWaveSound : public juce::SynthesiserSound
-{
-  SineWaveSound() {}
-
-  bool appliesToNote (int) override { return true; }
-  bool appliesToChannel (int) override { return true; }
-};
-
-struct SineWaveVoice : public juce::SynthesiserVoice
-{
-  SineWaveVoice (const juce::AudioSampleBuffer&);
-  bool canPlaySound (juce::SynthesiserSound* sound) override;
-  void startNote (int, float, juce::SynthesiserSound*, int) override;
-  void stopNote (float, bool) override;
-  void pitchWheelMoved (int) override {}
-  void controllerMoved (int, int) override {}
-  void renderNextBlock (juce::AudioSampleBuffer&, int, int) override;
-  
-private:
-  double level = 0.0, tailOff = 0.0;
-  const juce::AudioSampleBuffer& wavetable;
-  const int tableSize;
-  float currentIndex = 0.0f, tableDelta = 0.0f;
-};
-
-class CircularProgressBarLaF : public juce::LookAndFeel_V4
-{
-public:
-  CircularProgressBarLaF (float);
-
-  void drawProgressBar (juce::Graphics&, juce::ProgressBar&,
-						int, int, double, const juce::String&) override;
-  private:
-	  float elevation;
-};
-
-//==============================================================================
-
-class TitleBeltComponent : public juce::Component
-{
-public:
-  TitleBeltComponent (const juce::String& titleStr, bool align = true)
-	: titleString (titleStr),
-	  alignLeft (align) {}
-  void paint (juce::Graphics&) override;
-  
-private:
-  juce::String titleString;
-  bool alignLeft;
-  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TitleBeltComponent);
-};
-
-//==============================================================================
-class LooperAudioSource   : public juce::AudioSource
-{
-public:
-  LooperAudioSource (juce::MidiKeyboardState&);
-  void setUsingSineWaveSound();
-  void setupSamplesPerLoop (int);
-  void loadPhrases();
-  void savePhrases();
-  void createWavetable();
-  void setupPhrase();  
-  void setupRythmSection();
-  void evaluateGuess();
-  void generateNextPhrase();
-  void prepareToPlay (int, double) override;  
-  void releaseResources() override {}
-  void getNextAudioBlock (const juce::AudioSourceChannelInfo&) override;    
-  juce::MidiMessageCollector* getMidiCollector();
-
-private:
-  
-  juce::AudioSampleBuffer sineTable;
-  const unsigned int tableSize = 1 << 7;
-  
-  juce::MidiKeyboardState& keyboardState;
-  juce::Synthesiser synth;
-  juce::MidiMessageCollector midiCollector;
-  int currentCyclePos = 0, currentPhase = 1; // currentPhase = 0 for none, 1 for computer playing phrase, 2 for listening to user input
-  // TODO: const static members for these values
-  juce::MidiBuffer rythmSectionBuffer, phraseBuffer, guessBuffer;
-  juce::MidiBuffer phrases[10];
-  juce::Random random;
-  int samplesPerLoop;
-};
-
-
-//==============================================================================
-/*
-  This component lives inside our window, and this is where you should put all
-  your controls and content.
-*/
-class MainComponent  : public juce::AudioAppComponent,
-					   public juce::ChangeListener,
-					   public juce::Timer
-{
-public:
-  //==============================================================================
-  MainComponent();
-  ~MainComponent() override;
-
-  //==============================================================================
-  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
-  void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
-  void releaseResources() override;
-  void setMidiInput (int);
-  void loadBgImage();
-
-  //==============================================================================
-  void paint (juce::Graphics& g) override;
-  void timerCallback() override;
-  void resized() override;
-
-private:
-  void changeListenerCallback (juce::ChangeBroadcaster*) override {}
-  //==============================================================================
-  juce::MidiKeyboardState keyboardState;
-  LooperAudioSource synthAudioSource;
-  juce::MidiKeyboardComponent keyboardComponent;
-
-  juce::ComboBox midiInputList;
-  juce::Label midiInputListLabel;
-  juce::ImageComponent bgImage;
-  int lastInputIndex = 0;
-  juce::AudioDeviceSelectorComponent audioSetupComp;
-  int timerCounter = 0;
-  int timerHz = 60;
-  double progressInLoop = 0.0;
-  int secondsPerLoop;
-  juce::ProgressBar loopProgressBar;
-  CircularProgressBarLaF progressBarLaF;
-  TitleBeltComponent chordName;
-
-  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
-};
+#pragma once
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+#include "UiFrameProfiler.h"
+#include "ChordRecogniser.h"
+#include "SessionRecorder.h"
+#include "AudioExporter.h"
+
+class CircularProgressBarLaF : public juce::LookAndFeel_V4
+{
+public:
+  CircularProgressBarLaF (float);
+
+  void drawProgressBar (juce::Graphics&, juce::ProgressBar&,
+						int, int, double, const juce::String&) override;
+
+  // drawProgressBar is these two layers: the ring never changes, so a bar can
+  // keep it in an image and only draw the arc each frame
+  void drawProgressRing (juce::Graphics&, juce::ProgressBar&);
+  void drawProgressArc (juce::Graphics&, juce::ProgressBar&, double progress);
+
+  // The area the arc covers between two progress values, for repainting just that
+  juce::Rectangle<int> getProgressArcArea (juce::ProgressBar&, double fromProgress, double toProgress);
+
+  private:
+	  juce::Path createArc (juce::ProgressBar&, double fromProgress, double toProgress) const;
+	  float elevation;
+};
+
+//==============================================================================
+
+// A progress bar that follows the audio engine's playhead. It extrapolates the
+// last published position when it advances, so it stays in step with what you
+// hear however long the session runs. With a CircularProgressBarLaF the ring
+// is cached and each frame only repaints the bit of arc that has grown.
+class LoopProgressBar : public juce::ProgressBar
+{
+public:
+  LoopProgressBar (double& progress, const LoopPlayhead& playheadToFollow)
+	: juce::ProgressBar (progress),
+	  playhead (playheadToFollow) {}
+
+  LoopPlayhead::Position getCurrentPosition() const;
+
+  // Moves the arc up to the playhead and repaints what changed
+  void advance();
+  void setCachingEnabled (bool);
+
+  void paint (juce::Graphics&) override;
+  void resized() override;
+
+protected:
+  void lookAndFeelChanged() override;
+  void colourChanged() override;
+  // ProgressBar's own timer would repaint the whole bar 30 times a second
+  void visibilityChanged() override {}
+
+private:
+  CircularProgressBarLaF* getCircularLaF();
+
+  const LoopPlayhead& playhead;
+  juce::Image ringCache;
+  double paintedProgress = 0.0;
+  bool cachingEnabled = true;
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LoopProgressBar);
+};
+
+//==============================================================================
+
+// The background picture, scaled to fill the component once per resize
+// rather than on every paint
+class BackgroundImageComponent : public juce::Component
+{
+public:
+  BackgroundImageComponent() { setOpaque (true); }
+
+  void setImage (const juce::Image&);
+  const juce::Image& getImage() const noexcept { return sourceImage; }
+  void setCachingEnabled (bool);
+
+  void paint (juce::Graphics&) override;
+  void resized() override;
+
+private:
+  void rescale();
+
+  juce::Image sourceImage, scaledImage;
+  bool cachingEnabled = true;
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BackgroundImageComponent);
+};
+
+//==============================================================================
+
+class TitleBeltComponent : public juce::Component
+{
+public:
+  TitleBeltComponent (const juce::String& titleStr, bool align = true)
+	: titleString (titleStr),
+	  alignLeft (align) {}
+  void paint (juce::Graphics&) override;
+  // Repaints only if the title has changed
+  void setTitle (const juce::String&);
+  
+private:
+  juce::String titleString;
+  bool alignLeft;
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (TitleBeltComponent);
+};
+
+//==============================================================================
+
+// Drawn over the app with --midi-latency: how long the last couple of thousand
+// notes took from the MIDI input to their first sample, and their jitter, the
+// spread of those times around the median.
+class MidiLatencyOverlay : public juce::Component
+{
+public:
+  static constexpr int historySize = 2048;
+
+  MidiLatencyOverlay();
+
+  void addRecords (const MidiLatencyMonitor::Record*, int numRecords, int numDroppedSoFar);
+  void paint (juce::Graphics&) override;
+
+private:
+  void drawHistogram (juce::Graphics&, juce::Rectangle<int>, const MidiLatencyMonitor::Histogram&,
+					  const juce::String& title) const;
+
+  MetricsHistory<double> latencies { historySize };   // in ms
+  int numDropped = 0;
+  double median = 0.0, percentile99 = 0.0, worst = 0.0, deviation = 0.0;
+  MidiLatencyMonitor::Histogram latencyHistogram { 0.0, 1.0, 50 }, jitterHistogram { -5.0, 0.25, 40 };
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiLatencyOverlay);
+};
+
+//==============================================================================
+
+// Drawn over the app with --dsp-metrics: the audio engine's recent block
+// timings, one line of figures at a time
+class BlockMetricsOverlay : public juce::Component
+{
+public:
+  BlockMetricsOverlay() { setInterceptsMouseClicks (false, false); }
+
+  void setSummary (const AudioBlockMetrics::Summary&, int deviceXRuns, int streamingUnderruns);
+  void paint (juce::Graphics&) override;
+
+private:
+  juce::StringArray lines;
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockMetricsOverlay);
+};
+
+//==============================================================================
+/*
+  This component lives inside our window, and this is where you should put all
+  your controls and content.
+*/
+class MainComponent  : public juce::AudioAppComponent,
+					   public juce::ChangeListener,
+					   public juce::Timer
+{
+public:
+  //==============================================================================
+  MainComponent();
+  ~MainComponent() override;
+
+  //==============================================================================
+  void prepareToPlay (int samplesPerBlockExpected, double sampleRate) override;
+  void getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill) override;
+  void releaseResources() override;
+  void setMidiInput (int);
+
+  // --no-render-cache: draw every layer from scratch, to compare against
+  void setRenderCacheEnabled (bool);
+  // --measure-ui: print the message thread's CPU use per frame
+  void setUiMeasurementEnabled (bool);
+  // --midi-latency: show the MIDI-to-sound latency histograms
+  void setMidiLatencyOverlayEnabled (bool);
+  // --midi-latency-csv=<file>: write every note's timing to a CSV file
+  void setMidiLatencyCsvFile (const juce::File&);
+  // --dsp-metrics: show the audio engine's load, block timing and late callbacks
+  void setBlockMetricsOverlayEnabled (bool);
+  // --dsp-metrics-log=<file>: append the same figures to a file every few seconds
+  void setBlockMetricsLogFile (const juce::File&);
+  // --record-session=<file>: record everything the engine plays, for melodious-replay
+  void setSessionRecordingFile (const juce::File&);
+  // --capture-output=<file>: write what the app plays to a WAV or FLAC file
+  void setOutputCaptureFile (const juce::File&);
+
+  //==============================================================================
+  void paint (juce::Graphics& g) override;
+  void timerCallback() override;
+  void resized() override;
+
+private:
+  static juce::PropertiesFile::Options createSettingsFileOptions();
+  void changeListenerCallback (juce::ChangeBroadcaster*) override;
+  // The latency is kept per audio device, sample rate, block size and MIDI input
+  juce::String getLatencySettingKey() const;
+  void loadLatencyForCurrentSetup();
+  void updateLatencyLabel();
+  void readMidiLatencyRecords();
+  void readBlockMetrics();
+  void updateBlockMetricsEnabled();
+  void startOutputCapture (double sampleRate);
+  //==============================================================================
+  ResourceLoader resourceLoader;
+  juce::MidiKeyboardState keyboardState;
+  ChordRecogniser chordRecogniser;
+  // declared before the engine, which writes to it until the audio stops
+  SessionRecorder sessionRecorder;
+  // the output bus, copied into the exporter's FIFO after each block
+  AudioExporter outputCapture;
+  juce::File outputCaptureFile;
+  int numOutputCaptures = 0;
+  LooperAudioSource synthAudioSource;
+  juce::MidiKeyboardComponent keyboardComponent;
+
+  juce::ComboBox midiInputList;
+  juce::Label midiInputListLabel;
+  juce::ComboBox waveformList;
+  juce::Label waveformListLabel;
+  juce::ComboBox grooveList;
+  juce::Label grooveListLabel;
+  juce::Slider tempoSlider;
+  juce::Label tempoSliderLabel;
+  juce::TextButton calibrateButton { "Calibrate latency" };
+  juce::Label latencyLabel;
+  juce::ToggleButton audioInputButton { "Sing or play into the audio input" };
+  juce::PropertiesFile settingsFile { createSettingsFileOptions() };
+  LatencyCalibrator::State shownCalibrationState = LatencyCalibrator::State::idle;
+  int shownTapCount = 0;
+  int shownStreamingUnderruns = 0;
+  BackgroundImageComponent bgImage;
+  int lastInputIndex = 0;
+  juce::AudioDeviceSelectorComponent audioSetupComp;
+  int timerHz = 60;
+  double progressInLoop = 0.0;
+  LoopProgressBar loopProgressBar;
+  CircularProgressBarLaF progressBarLaF;
+  TitleBeltComponent chordName;
+  ChordRecogniser::Chord shownChord;
+  std::unique_ptr<UiFrameProfiler> uiProfiler;
+  std::unique_ptr<MidiLatencyOverlay> midiLatencyOverlay;
+  std::unique_ptr<juce::FileOutputStream> midiLatencyCsv;
+  AudioBlockMetrics::Window blockMetricsWindow;
+  std::unique_ptr<BlockMetricsOverlay> blockMetricsOverlay;
+  std::unique_ptr<juce::FileOutputStream> blockMetricsLog;
+  double lastOverlayUpdate = 0.0, lastLogWrite = 0.0;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MainComponent)
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  The pieces the audio engine's monitors share. MidiLatencyMonitor and
+  AudioBlockMetrics each take one record per note or per block from the
+  audio thread through a MetricsFifo; whoever reads them out keeps the most
+  recent in a MetricsHistory and sums them up with getPercentile.
+*/
+
+//==============================================================================
+// Records handed from the audio thread to one reading thread through a
+// lock-free ring buffer. Nothing is pushed until it is enabled, so it costs
+// the audio thread nothing while no one is looking.
+template <typename Record, int capacity>
+class MetricsFifo
+{
+public:
+  MetricsFifo() = default;
+
+  void setEnabled (bool shouldRecord) noexcept   { enabled = shouldRecord; }
+  bool isEnabled() const noexcept                { return enabled.load(); }
+
+  // Audio thread. If the reader falls behind, records are dropped and counted.
+  void push (const Record& newRecord) noexcept
+  {
+	if (! enabled.load())
+	  return;
+
+	int start1, size1, start2, size2;
+	fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+	if (size1 == 0)
+	  {
+		++numDropped;
+		return;
+	  }
+
+	records[start1] = newRecord;
+	fifo.finishedWrite (1);
+  }
+
+  // The one reading thread. Returns how many records were copied into dest.
+  int read (Record* dest, int maxRecords) noexcept
+  {
+	int start1, size1, start2, size2;
+	fifo.prepareToRead (maxRecords, start1, size1, start2, size2);
+
+	std::copy (records + start1, records + start1 + size1, dest);
+	std::copy (records + start2, records + start2 + size2, dest + size1);
+
+	fifo.finishedRead (size1 + size2);
+	return size1 + size2;
+  }
+
+  int getNumDropped() const noexcept             { return numDropped.load(); }
+
+private:
+  std::atomic<bool> enabled { false };
+  std::atomic<int> numDropped { 0 };
+  juce::AbstractFifo fifo { capacity };
+  Record records[capacity];
+
+  JUCE_DECLARE_NON_COPYABLE (MetricsFifo)
+};
+
+//==============================================================================
+// The last maxSize values added, in no particular order: once it's full
+// the oldest is replaced first. Storage is allocated up front.
+template <typename Value>
+class MetricsHistory
+{
+public:
+  explicit MetricsHistory (int size)
+	: maxSize (juce::jmax (1, size))
+  {
+	values.ensureStorageAllocated (maxSize);
+  }
+
+  void add (const Value& value)
+  {
+	if (values.size() < maxSize)
+	  values.add (value);
+	else
+	  values.set (nextIndex, value);
+
+	nextIndex = (nextIndex + 1) % maxSize;
+  }
+
+  const juce::Array<Value>& getValues() const noexcept   { return values; }
+  int size() const noexcept                              { return values.size(); }
+  bool isEmpty() const noexcept                          { return values.isEmpty(); }
+
+private:
+  juce::Array<Value> values;
+  int maxSize, nextIndex = 0;
+};
+
+//==============================================================================
+// The value percent of the way up an array that's already sorted, which
+// mustn't be empty: 50 is the median and 100 the largest.
+template <typename Value>
+Value getPercentile (const juce::Array<Value>& sorted, int percent) noexcept
+{
+  return sorted[juce::jmin (sorted.size() - 1, sorted.size() * percent / 100)];
+}
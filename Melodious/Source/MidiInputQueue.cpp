@@ -0,0 +1,75 @@
+#include "MidiInputQueue.h"
+
+void MidiInputQueue::reset (double newSampleRate)
+{
+  const juce::SpinLock::ScopedLockType sl (writeLock);
+  sampleRate = newSampleRate;
+  fifo.reset();
+}
+
+void MidiInputQueue::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
+{
+  addMessageToQueue (message);
+}
+
+void MidiInputQueue::addMessageToQueue (const juce::MidiMessage& message)
+{
+  if (message.isSysEx() || message.getRawDataSize() > 3)
+	return;
+
+  const juce::SpinLock::ScopedLockType sl (writeLock);
+
+  int start1, size1, start2, size2;
+  fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+  // if the audio isn't running, the queue fills up and new messages go
+  if (size1 == 0)
+	return;
+
+  auto& entry = entries[start1];
+  entry.time = message.getTimeStamp() > 0.0 ? message.getTimeStamp()
+											 : juce::Time::getMillisecondCounterHiRes() * 0.001;
+  entry.size = message.getRawDataSize();
+  std::copy (message.getRawData(), message.getRawData() + entry.size, entry.data);
+
+  fifo.finishedWrite (1);
+}
+
+int MidiInputQueue::removeNextBlockOfMessages (juce::MidiBuffer& dest, int numSamples, double callbackTime,
+											   TimedNote* notes, int maxMessages) noexcept
+{
+  int numNotes = 0, numRead = 0;
+  int start1, size1, start2, size2;
+  fifo.prepareToRead (juce::jmin (maxMessages, fifo.getNumReady()), start1, size1, start2, size2);
+
+  const auto take = [&] (int start, int size)
+	{
+	  for (int i = start; i < start + size; ++i)
+		{
+		  const auto& entry = entries[i];
+
+		  // it came in after this callback started, so it waits for the next
+		  if (entry.time > callbackTime)
+			return false;
+
+		  const auto offset = juce::jlimit (0, numSamples - 1,
+											numSamples - juce::roundToInt ((callbackTime - entry.time) * sampleRate));
+		  dest.addEvent (entry.data, entry.size, offset);
+
+		  const auto type = entry.data[0] & 0xf0;
+
+		  if ((type == 0x90 || type == 0x80) && entry.size == 3)
+			notes[numNotes++] = { entry.time, entry.data[1], entry.data[2], type == 0x90 && entry.data[2] > 0, offset };
+
+		  ++numRead;
+		}
+
+	  return true;
+	};
+
+  if (take (start1, size1))
+	take (start2, size2);
+
+  fifo.finishedRead (numRead);
+  return numNotes;
+}
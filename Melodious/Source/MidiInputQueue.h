@@ -0,0 +1,62 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Takes MIDI from the input device (or a script) and hands it to the audio
+  thread a block at a time, like juce::MidiMessageCollector, but keeps the
+  time every message arrived. Each message goes into the block at the
+  position its arrival time maps to, so the spacing between notes survives,
+  and note events are also handed out with the arrival time itself, which
+  lets scoring place them to the sample rather than to the block.
+
+  Timestamps are in seconds on the Time::getMillisecondCounterHiRes() clock,
+  which is what MidiInput stamps its messages with. Only short messages are
+  kept; sysex is dropped.
+*/
+class MidiInputQueue : public juce::MidiInputCallback
+{
+public:
+  static constexpr int capacity = 1024;
+
+  struct TimedNote
+  {
+	double time;
+	int noteNumber, velocity;
+	bool isNoteOn;
+	int samplePosition;   // where it went in the block
+  };
+
+  MidiInputQueue() = default;
+
+  void reset (double sampleRate);
+
+  // Any thread. A message with no timestamp is stamped with the time now.
+  void addMessageToQueue (const juce::MidiMessage&);
+  void handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage&) override;
+
+  // Audio thread. Moves what arrived up to callbackTime into dest, treating
+  // the block as the numSamples that lead up to callbackTime, and copies the
+  // note events among them into notes with their times. At most maxMessages
+  // are taken, so that dest never outgrows what was reserved for it; the
+  // rest wait for the next block. notes needs room for maxMessages.
+  // Returns the number of notes.
+  int removeNextBlockOfMessages (juce::MidiBuffer& dest, int numSamples, double callbackTime,
+								 TimedNote* notes, int maxMessages) noexcept;
+
+private:
+  struct Entry
+  {
+	double time;
+	juce::uint8 data[3];
+	int size;
+  };
+
+  double sampleRate = 44100.0;
+  juce::SpinLock writeLock;      // there may be more than one writer
+  juce::AbstractFifo fifo { capacity };
+  Entry entries[capacity];
+
+  JUCE_DECLARE_NON_COPYABLE (MidiInputQueue)
+};
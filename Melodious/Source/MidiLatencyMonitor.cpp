@@ -0,0 +1,41 @@
+#include "MidiLatencyMonitor.h"
+
+//==============================================================================
+MidiLatencyMonitor::Histogram::Histogram (double lowest, double width, int numBins)
+  : lowestValue (lowest),
+	binWidth (width)
+{
+  counts.insertMultiple (0, 0, numBins);
+}
+
+void MidiLatencyMonitor::Histogram::clear()
+{
+  counts.fill (0);
+  maxCount = 0;
+}
+
+void MidiLatencyMonitor::Histogram::add (double value)
+{
+  const auto bin = juce::jlimit (0, counts.size() - 1, (int) std::floor ((value - lowestValue) / binWidth));
+  const auto count = counts[bin] + 1;
+  counts.set (bin, count);
+  maxCount = juce::jmax (maxCount, count);
+}
+
+//==============================================================================
+juce::String MidiLatencyMonitor::getCsvHeader()
+{
+  return "note,arrival_s,block_time_s,block_start,block_size,sample_offset,sample_rate,latency_ms";
+}
+
+juce::String MidiLatencyMonitor::toCsvLine (const Record& r)
+{
+  return juce::String (r.noteNumber) + ","
+	+ juce::String (r.arrivalTime, 6) + ","
+	+ juce::String (r.blockTime, 6) + ","
+	+ juce::String (r.blockStart) + ","
+	+ juce::String (r.blockSize) + ","
+	+ juce::String (r.sampleOffset) + ","
+	+ juce::String (r.sampleRate) + ","
+	+ juce::String (r.getLatencySeconds() * 1000.0, 3);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MetricsHistory.h"
+
+//==============================================================================
+/*
+  Follows every note from the MIDI input to the block that plays it: the time
+  the MIDI callback stamped it with, the audio callback that rendered it, and
+  where in that block it went. The audio thread records into a MetricsFifo
+  and one other thread reads them out, for the latency overlay or a CSV
+  file.
+*/
+class MidiLatencyMonitor
+{
+public:
+  static constexpr int capacity = 4096;
+
+  struct Record
+  {
+	double arrivalTime;       // from the MIDI callback, in seconds
+	double blockTime;         // when the audio callback that rendered it started
+	juce::int64 blockStart;   // samples rendered before that block
+	int blockSize, sampleOffset, noteNumber;
+	double sampleRate;
+
+	// From the MIDI callback to the note's first sample, leaving out the
+	// device's own output latency, which is the same for every note
+	double getLatencySeconds() const noexcept   { return blockTime - arrivalTime + sampleOffset / sampleRate; }
+  };
+
+  //==============================================================================
+  // Counts of values in equal bins; the end bins also take everything beyond them
+  class Histogram
+  {
+  public:
+	Histogram (double lowestValue, double binWidth, int numBins);
+
+	void clear();
+	void add (double value);
+
+	int getNumBins() const noexcept               { return counts.size(); }
+	int getCount (int bin) const noexcept         { return counts[bin]; }
+	int getMaxCount() const noexcept              { return maxCount; }
+	double getBinStart (int bin) const noexcept   { return lowestValue + bin * binWidth; }
+	double getBinWidth() const noexcept           { return binWidth; }
+
+  private:
+	double lowestValue, binWidth;
+	juce::Array<int> counts;
+	int maxCount = 0;
+  };
+
+  //==============================================================================
+  MidiLatencyMonitor() = default;
+
+  void setEnabled (bool shouldRecord) noexcept   { records.setEnabled (shouldRecord); }
+  bool isEnabled() const noexcept                { return records.isEnabled(); }
+
+  // Audio thread. If the reader falls behind, records are dropped and counted.
+  void record (const Record& newRecord) noexcept { records.push (newRecord); }
+
+  // The one reading thread. Returns how many records were copied into dest.
+  int readRecords (Record* dest, int maxRecords) noexcept   { return records.read (dest, maxRecords); }
+  int getNumDropped() const noexcept             { return records.getNumDropped(); }
+
+  static juce::String getCsvHeader();
+  static juce::String toCsvLine (const Record&);
+
+private:
+  MetricsFifo<Record, capacity> records;
+
+  JUCE_DECLARE_NON_COPYABLE (MidiLatencyMonitor)
+};
@@ -0,0 +1,153 @@
+#include "OfflineRenderer.h"
+#include "AllocationTracker.h"
+#include <algorithm>
+
+//==============================================================================
+void OfflineRenderer::setScript (std::vector<ScriptedNote> newScript)
+{
+  script = std::move (newScript);
+  useDefaultScript = false;
+}
+
+std::vector<OfflineRenderer::ScriptedNote> OfflineRenderer::createDefaultScript (int samplesPerLoop)
+{
+  const int notes[] = { 60, 64, 67, 65 };
+  std::vector<ScriptedNote> defaultScript;
+
+  for (int i = 0; i < 4; ++i)
+	defaultScript.push_back ({ notes[i], i * samplesPerLoop / 8 + 400, samplesPerLoop / 8 - 401 });
+
+  return defaultScript;
+}
+
+void OfflineRenderer::queueScriptedMidi (MidiInputQueue& midiInput, int loopIndex,
+										 int blockStartInLoop, int numSamples)
+{
+  // the engine starts by playing the phrase, so the student answers on odd loops
+  if (loopIndex % 2 == 0)
+	return;
+
+  const auto blockEnd = blockStartInLoop + numSamples;
+  const auto now = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+  for (const auto& note : script)
+	{
+	  const auto noteEnd = note.startInLoop + note.lengthInLoop;
+
+	  if (note.startInLoop >= blockStartInLoop && note.startInLoop < blockEnd)
+		midiInput.addMessageToQueue (juce::MidiMessage::noteOn (1, note.noteNumber, 0.8f)
+									 .withTimeStamp (now));
+
+	  if (noteEnd >= blockStartInLoop && noteEnd < blockEnd)
+		midiInput.addMessageToQueue (juce::MidiMessage::noteOff (1, note.noteNumber)
+									 .withTimeStamp (now));
+	}
+}
+
+//==============================================================================
+OfflineRenderer::Report OfflineRenderer::render (const Settings& settings)
+{
+  // the engine's own clock, to know where its loops fall
+  Transport transport;
+  transport.requestSettings (settings.transport);
+  transport.prepare (settings.sampleRate);
+
+  const auto samplesPerLoop = transport.getSamplesPerLoop();
+  const auto blocksPerLoop = (samplesPerLoop + settings.blockSize - 1) / settings.blockSize;
+  const auto numBlocks = blocksPerLoop * settings.numLoops;
+
+  if (useDefaultScript)
+	script = createDefaultScript (samplesPerLoop);
+
+  juce::MidiKeyboardState keyboardState;
+  LooperAudioSource engine (keyboardState, settings.numVoices);
+  engine.setTransport (settings.transport);
+  engine.setWaveform (settings.waveform);
+  engine.setSessionSink (settings.sessionSink);
+  engine.prepareToPlay (settings.blockSize, settings.sampleRate);
+
+  juce::AudioBuffer<float> buffer (settings.numChannels, settings.blockSize);
+  juce::AudioSourceChannelInfo info (&buffer, 0, settings.blockSize);
+
+  std::vector<double> blockMicros ((size_t) numBlocks);
+  juce::int64 totalAllocations = 0, maxAllocations = 0;
+  juce::int64 samplesRendered = 0;
+
+  const auto renderStart = juce::Time::getHighResolutionTicks();
+
+  for (int block = 0; block < numBlocks; ++block)
+	{
+	  const auto loopIndex = (int) (samplesRendered / samplesPerLoop);
+	  const auto posInLoop = (int) (samplesRendered % samplesPerLoop);
+	  queueScriptedMidi (*engine.getMidiInputQueue(), loopIndex, posInLoop, settings.blockSize);
+
+	  const auto allocationsBefore = AllocationTracker::getThreadAllocationCount();
+	  const auto blockStart = juce::Time::getHighResolutionTicks();
+
+	  engine.getNextAudioBlock (info);
+
+	  const auto blockEnd = juce::Time::getHighResolutionTicks();
+	  const auto allocations = AllocationTracker::getThreadAllocationCount() - allocationsBefore;
+
+	  blockMicros[(size_t) block] = juce::Time::highResolutionTicksToSeconds (blockEnd - blockStart) * 1.0e6;
+	  totalAllocations += allocations;
+	  maxAllocations = juce::jmax (maxAllocations, allocations);
+	  samplesRendered += settings.blockSize;
+	}
+
+  const auto renderSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks()
+																		 - renderStart);
+  engine.releaseResources();
+
+  Report report;
+  report.settings = settings;
+  report.numBlocks = numBlocks;
+  report.audioSeconds = (double) samplesRendered / settings.sampleRate;
+  report.renderSeconds = renderSeconds;
+  report.realTimeFactor = renderSeconds > 0.0 ? report.audioSeconds / renderSeconds : 0.0;
+  report.budgetMicros = settings.blockSize / settings.sampleRate * 1.0e6;
+  report.meanAllocationsPerBlock = numBlocks > 0 ? (double) totalAllocations / numBlocks : 0.0;
+  report.maxAllocationsPerBlock = maxAllocations;
+
+  if (numBlocks > 0)
+	{
+	  std::sort (blockMicros.begin(), blockMicros.end());
+	  const auto percentile = [&blockMicros] (double p)
+		{
+		  return blockMicros[(size_t) juce::jlimit (0, (int) blockMicros.size() - 1,
+													(int) std::ceil (p * (double) blockMicros.size()) - 1)];
+		};
+	  report.p50Micros = percentile (0.50);
+	  report.p99Micros = percentile (0.99);
+	  report.maxMicros = blockMicros.back();
+	}
+
+  return report;
+}
+
+//==============================================================================
+juce::String OfflineRenderer::formatReportHeader()
+{
+  return "  rate  block    RTF   budget(us)   p50(us)   p99(us)   max(us)  max%budget  allocs/block (max)";
+}
+
+juce::String OfflineRenderer::formatReport (const Report& r)
+{
+  const auto pad = [] (const juce::String& s, int width) { return s.paddedLeft (' ', width); };
+
+  auto line = pad (juce::String (r.settings.sampleRate, 0), 6)
+	+ pad (juce::String (r.settings.blockSize), 7)
+	+ pad (juce::String (r.realTimeFactor, 1), 7)
+	+ pad (juce::String (r.budgetMicros, 1), 13)
+	+ pad (juce::String (r.p50Micros, 2), 10)
+	+ pad (juce::String (r.p99Micros, 2), 10)
+	+ pad (juce::String (r.maxMicros, 2), 10)
+	+ pad (juce::String (100.0 * r.maxMicros / r.budgetMicros, 2) + "%", 12);
+
+  if (AllocationTracker::isEnabled())
+	line += pad (juce::String (r.meanAllocationsPerBlock, 2) + " (" + juce::String (r.maxAllocationsPerBlock) + ")", 20);
+  else
+	line += pad ("n/a", 20);
+
+  return line;
+}
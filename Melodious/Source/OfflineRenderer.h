@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+
+//==============================================================================
+/*
+  Drives a LooperAudioSource without an audio device or any GUI: it calls
+  prepareToPlay/getNextAudioBlock directly, as fast as the machine allows, and
+  times every block. MIDI can be scripted into the engine's MidiInputQueue
+  as if a student was playing along.
+*/
+class OfflineRenderer
+{
+public:
+  struct Settings
+  {
+	double sampleRate = 48000.0;
+	int blockSize = 256;
+	int numChannels = 2;
+	int numLoops = 8;
+	Transport::Settings transport;   // 96 BPM in 4/4, two bars a loop
+	WavetableBank::Waveform waveform = WavetableBank::Waveform::sine;
+	int numVoices = LooperAudioSource::defaultNumVoices;
+	SessionSink* sessionSink = nullptr;   // records the run, e.g. a SessionRecorder
+  };
+
+  // A note the scripted "student" plays, in samples relative to the loop start.
+  struct ScriptedNote
+  {
+	int noteNumber;
+	int startInLoop, lengthInLoop;
+  };
+
+  struct Report
+  {
+	Settings settings;
+	int numBlocks = 0;
+	double audioSeconds = 0.0, renderSeconds = 0.0;
+	double realTimeFactor = 0.0;                           // audio time / wall time
+	double budgetMicros = 0.0;                             // duration of one block
+	double p50Micros = 0.0, p99Micros = 0.0, maxMicros = 0.0;
+	double meanAllocationsPerBlock = 0.0;
+	juce::int64 maxAllocationsPerBlock = 0;
+  };
+
+  OfflineRenderer() = default;
+
+  // Replaces the script played into the engine during the listening loops.
+  void setScript (std::vector<ScriptedNote>);
+  // Plays the same four diatonic notes the phrase generator picks from.
+  static std::vector<ScriptedNote> createDefaultScript (int samplesPerLoop);
+
+  Report render (const Settings&);
+
+  static juce::String formatReportHeader();
+  static juce::String formatReport (const Report&);
+
+private:
+  void queueScriptedMidi (MidiInputQueue&, int loopIndex,
+						  int blockStartInLoop, int numSamples);
+
+  std::vector<ScriptedNote> script;
+  bool useDefaultScript = true;
+
+  JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
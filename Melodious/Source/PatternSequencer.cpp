@@ -0,0 +1,202 @@
+#include "PatternSequencer.h"
+#include <algorithm>
+
+namespace
+{
+  bool comesBefore (const Pattern::Event& a, const Pattern::Event& b) noexcept
+  {
+	if (a.tick != b.tick)
+	  return a.tick < b.tick;
+
+	return ! a.isNoteOn && b.isNoteOn;
+  }
+}
+
+Pattern::Pattern (const juce::String& patternName, int length, std::vector<Event> patternEvents)
+  : name (patternName),
+	lengthInTicks (juce::jmax (1, length)),
+	events (std::move (patternEvents))
+{
+  // anything past the end would never play
+  events.erase (std::remove_if (events.begin(), events.end(),
+								[this] (const Event& e) { return e.tick < 0 || e.tick >= lengthInTicks; }),
+				events.end());
+  std::stable_sort (events.begin(), events.end(), comesBefore);
+}
+
+int Pattern::findFirstEventAtOrAfter (double tick) const noexcept
+{
+  const auto found = std::lower_bound (events.begin(), events.end(), tick,
+									   [] (const Event& e, double t) { return (double) e.tick < t; });
+  return (int) (found - events.begin());
+}
+
+Pattern Pattern::createDefaultGroove()
+{
+  // two bars of 4/4, in 24ths of the loop as it was first written
+  const auto loop = 8 * ticksPerQuarterNote;
+  const auto at = [loop] (int twentyFourths) { return loop * twentyFourths / 24; };
+
+  // the old buffer's MIDI channel 0 came out as channel 16
+  const auto on  = [] (int tick, int note) { return Event { tick, 16, (juce::uint8) note, 127, true }; };
+  const auto off = [] (int tick, int note) { return Event { tick, 16, (juce::uint8) note, 0, false }; };
+
+  return Pattern ("Default", loop,
+				  {
+					on (0, 59), on (0, 53), on (0, 43),
+					off (at (5), 59), off (at (5), 53), off (at (5), 43),
+					on (at (5), 31), off (at (6), 31),
+					on (at (12), 43), off (at (17), 43),
+					on (at (17), 31), off (at (18), 31),
+					on (at (20), 36), off (at (21), 36),
+					on (at (21), 37), off (at (23), 37),
+					on (at (23), 38), off (loop - 1, 38),
+					on (at (23), 54), off (loop - 1, 54),
+					on (at (23), 58), off (loop - 1, 58)
+				  });
+}
+
+bool Pattern::loadFromMidiFile (const juce::File& file, Pattern& result, juce::String& error)
+{
+  juce::FileInputStream input (file);
+  juce::MidiFile midiFile;
+
+  if (! input.openedOk() || ! midiFile.readFrom (input))
+	{
+	  error = file.getFullPathName() + " is not a MIDI file";
+	  return false;
+	}
+
+  const auto timeFormat = midiFile.getTimeFormat();
+
+  if (timeFormat <= 0)
+	{
+	  error = file.getFullPathName() + " uses SMPTE time, which grooves can't";
+	  return false;
+	}
+
+  const auto scale = (double) ticksPerQuarterNote / timeFormat;
+  std::vector<Event> events;
+  auto lastNoteOn = 0, lastNoteOff = 0;
+  auto timeSignatureTime = -1.0;
+  int numerator = 4, denominator = 4;
+
+  for (int track = 0; track < midiFile.getNumTracks(); ++track)
+	{
+	  for (const auto* holder : *midiFile.getTrack (track))
+		{
+		  const auto& message = holder->message;
+
+		  // the earliest time signature in any track sets the bar
+		  if (message.isTimeSignatureMetaEvent()
+			  && (timeSignatureTime < 0.0 || message.getTimeStamp() < timeSignatureTime))
+			{
+			  message.getTimeSignatureInfo (numerator, denominator);
+			  timeSignatureTime = message.getTimeStamp();
+			}
+
+		  if (! message.isNoteOnOrOff())
+			continue;
+
+		  const auto tick = juce::roundToInt (message.getTimeStamp() * scale);
+		  events.push_back ({ tick, (juce::uint8) message.getChannel(), (juce::uint8) message.getNoteNumber(),
+							  message.getVelocity(), message.isNoteOn() });
+
+		  if (message.isNoteOn())
+			lastNoteOn = juce::jmax (lastNoteOn, tick);
+		  else
+			lastNoteOff = juce::jmax (lastNoteOff, tick);
+		}
+	}
+
+  if (events.empty())
+	{
+	  error = file.getFullPathName() + " has no notes in it";
+	  return false;
+	}
+
+  // Loop on the bar line after the last note: a note-off may end right on
+  // it, a note-on has to start before it. An off on the loop point itself
+  // moves back a tick, or the pattern would drop it and leave the note hanging.
+  const auto ticksPerBar = juce::jmax (1, numerator * 4 * ticksPerQuarterNote / juce::jmax (1, denominator));
+  const auto numBars = juce::jmax (1, (lastNoteOff + ticksPerBar - 1) / ticksPerBar, lastNoteOn / ticksPerBar + 1);
+  const auto length = numBars * ticksPerBar;
+
+  for (auto& event : events)
+	if (! event.isNoteOn && event.tick >= length)
+	  event.tick = length - 1;
+
+  result = Pattern (file.getFileNameWithoutExtension(), length, std::move (events));
+  return true;
+}
+
+//==============================================================================
+void PatternSequencer::setPattern (const Pattern* newPattern) noexcept
+{
+  if (newPattern != pattern)
+	{
+	  pattern = newPattern;
+	  expectedTick = -1.0;
+	}
+}
+
+void PatternSequencer::setSamplesPerTick (double newSamplesPerTick) noexcept
+{
+  if (newSamplesPerTick != samplesPerTick)
+	{
+	  samplesPerTick = newSamplesPerTick;
+	  expectedTick = -1.0;
+	}
+}
+
+void PatternSequencer::seek (double tick) noexcept
+{
+  const auto length = (double) pattern->getLengthInTicks();
+  passStart = std::floor (tick / length) * length;
+  nextEvent = pattern->findFirstEventAtOrAfter (tick - passStart);
+}
+
+void PatternSequencer::renderNextBlock (juce::MidiBuffer& buffer, double startTick,
+										int startSample, int numSamples)
+{
+  if (pattern == nullptr || samplesPerTick <= 0.0 || numSamples <= 0 || pattern->getEvents().empty())
+	return;
+
+  // carrying on from the last block is the usual case, and needs no search;
+  // when it lines up, keep our own tick so that the blocks tile exactly
+  if (std::abs (startTick - expectedTick) > 1.0e-6)
+	seek (startTick);
+  else
+	startTick = expectedTick;
+
+  const auto& events = pattern->getEvents();
+  const auto numEvents = (int) events.size();
+  const auto length = (double) pattern->getLengthInTicks();
+  const auto endTick = startTick + numSamples / samplesPerTick;
+
+  // Once a pass is used up the cursor moves on to the next, which may not
+  // start until a later block; working the pass out again from that
+  // block's start tick would play the old one twice.
+  for (;;)
+	{
+	  if (nextEvent >= numEvents)
+		{
+		  passStart += length;
+		  nextEvent = 0;
+		}
+
+	  const auto& event = events[(size_t) nextEvent];
+	  const auto eventTick = passStart + event.tick;
+
+	  if (eventTick >= endTick)
+		break;
+
+	  const auto offset = juce::jlimit (0, numSamples - 1, (int) ((eventTick - startTick) * samplesPerTick));
+	  buffer.addEvent (event.isNoteOn ? juce::MidiMessage::noteOn (event.channel, event.noteNumber, event.velocity)
+									  : juce::MidiMessage::noteOff (event.channel, event.noteNumber, event.velocity),
+					   startSample + offset);
+	  ++nextEvent;
+	}
+
+  expectedTick = endTick;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  A backing pattern in musical time: note events at tick positions (960 per
+  quarter note, like the phrase library) that repeat every lengthInTicks.
+  Events are kept sorted, with note-offs ahead of note-ons on the same tick,
+  so a note can be retriggered without the two messages swapping.
+*/
+class Pattern
+{
+public:
+  static constexpr int ticksPerQuarterNote = 960;
+
+  struct Event
+  {
+	int tick;
+	juce::uint8 channel, noteNumber, velocity;
+	bool isNoteOn;
+  };
+
+  Pattern() = default;
+  Pattern (const juce::String& name, int lengthInTicks, std::vector<Event> events);
+
+  const juce::String& getName() const noexcept         { return name; }
+  int getLengthInTicks() const noexcept               { return lengthInTicks; }
+  const std::vector<Event>& getEvents() const noexcept { return events; }
+  int getLastEventTick() const noexcept               { return events.empty() ? 0 : events.back().tick; }
+
+  // The index of the first event at or after tick, found by binary search
+  int findFirstEventAtOrAfter (double tick) const noexcept;
+
+  // The groove the looper has always played, as a two-bar pattern
+  static Pattern createDefaultGroove();
+
+  // Every note in every track of a standard MIDI file, rescaled to our tick
+  // rate and looped after the last bar that has anything in it. Bars follow
+  // the file's first time signature, 4/4 if it has none.
+  static bool loadFromMidiFile (const juce::File&, Pattern& result, juce::String& error);
+
+private:
+  juce::String name;
+  int lengthInTicks = 0;
+  std::vector<Event> events;
+};
+
+//==============================================================================
+/*
+  Plays a Pattern into a MidiBuffer a block at a time. It keeps a cursor into
+  the event list, so a block costs only the events that fall inside it; the
+  cursor is only searched for (in O(log n)) when the caller's position jumps
+  or the tempo changes. The pattern itself never has to be rebuilt for a new
+  tempo or sample rate.
+*/
+class PatternSequencer
+{
+public:
+  PatternSequencer() = default;
+
+  // The pattern isn't owned and has to outlive the sequencer's use of it.
+  void setPattern (const Pattern*) noexcept;
+  const Pattern* getPattern() const noexcept          { return pattern; }
+
+  void setSamplesPerTick (double) noexcept;
+  // Forgets the cursor, for when the pattern has been rewritten in place
+  void reset() noexcept                               { expectedTick = -1.0; }
+
+  // Adds the events between startTick and numSamples later to the buffer,
+  // at their sample offsets from startSample. startTick counts from the
+  // start of the performance, so longer patterns carry on across loops.
+  void renderNextBlock (juce::MidiBuffer&, double startTick, int startSample, int numSamples);
+
+private:
+  void seek (double tick) noexcept;
+
+  const Pattern* pattern = nullptr;
+  double samplesPerTick = 0.0;
+  double expectedTick = -1.0;   // where the last block ended
+  double passStart = 0.0;       // the tick the cursor's pass through the pattern began on
+  int nextEvent = 0;            // the cursor into pattern->getEvents()
+};
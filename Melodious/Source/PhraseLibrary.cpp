@@ -0,0 +1,131 @@
+#include "PhraseLibrary.h"
+
+using namespace PhraseLibraryFormat;
+
+bool PhraseLibrary::open (const juce::File& file)
+{
+  close();
+
+  if (! juce::ByteOrder::isLittleEndian())
+	{
+	  jassertfalse; // the library is used in place, so only little-endian hosts can read it
+	  return false;
+	}
+
+  auto mapping = std::make_unique<juce::MemoryMappedFile> (file, juce::MemoryMappedFile::readOnly);
+  const auto* data = static_cast<const char*> (mapping->getData());
+  const auto size = mapping->getSize();
+
+  if (data == nullptr || size < sizeof (Header))
+	return false;
+
+  const auto* fileHeader = reinterpret_cast<const Header*> (data);
+
+  if (fileHeader->magic != magic || fileHeader->version != currentVersion)
+	return false;
+
+  const auto expectedSize = sizeof (Header)
+	+ (size_t) fileHeader->numPhrases * sizeof (PhraseEntry)
+	+ (size_t) fileHeader->numNotes * sizeof (NoteRecord);
+
+  if (size < expectedSize)
+	return false;
+
+  header = fileHeader;
+  entries = reinterpret_cast<const PhraseEntry*> (data + sizeof (Header));
+  notes = reinterpret_cast<const NoteRecord*> (entries + fileHeader->numPhrases);
+  mappedFile = std::move (mapping);
+  return true;
+}
+
+void PhraseLibrary::close()
+{
+  header = nullptr;
+  entries = nullptr;
+  notes = nullptr;
+  mappedFile.reset();
+}
+
+int PhraseLibrary::getNumPhrases() const noexcept
+{
+  return header != nullptr ? (int) header->numPhrases : 0;
+}
+
+juce::uint32 PhraseLibrary::getTicksPerQuarterNote() const noexcept
+{
+  return header != nullptr ? header->ticksPerQuarterNote : (juce::uint32) defaultTicksPerQuarterNote;
+}
+
+PhraseLibrary::Phrase PhraseLibrary::getPhrase (int index) const noexcept
+{
+  if (! juce::isPositiveAndBelow (index, getNumPhrases()))
+	return {};
+
+  const auto& entry = entries[index];
+
+  // a damaged entry reads as an empty phrase rather than past the mapping
+  if ((juce::uint64) entry.firstNote + entry.numNotes > header->numNotes)
+	return {};
+
+  return { notes + entry.firstNote, (int) entry.numNotes, entry.lengthInTicks };
+}
+
+Pattern PhraseLibrary::createPattern (const Phrase& phrase, int loopLengthInTicks)
+{
+  if (phrase.lengthInTicks == 0)
+	return Pattern ("Phrase", loopLengthInTicks, {});
+
+  const auto scale = (double) loopLengthInTicks / (double) phrase.lengthInTicks;
+  std::vector<Pattern::Event> events;
+
+  for (int i = 0; i < phrase.numNotes; ++i)
+	{
+	  const auto& note = phrase.notes[i];
+	  const auto start = juce::roundToInt (note.startTick * scale);
+	  const auto end = juce::roundToInt ((note.startTick + note.lengthInTicks) * scale);
+	  const auto channel = (juce::uint8) juce::jlimit (1, 16, (int) note.channel);
+
+	  events.push_back ({ start, channel, note.noteNumber, note.velocity, true });
+	  // a tick after the note-on at least, as offs sort ahead of ons on the same tick
+	  events.push_back ({ juce::jmax (start + 1, end - 1), channel, note.noteNumber, 0, false });
+	}
+
+  return Pattern ("Phrase", loopLengthInTicks, std::move (events));
+}
+
+bool PhraseLibrary::writeToFile (const juce::File& file, const std::vector<PhraseData>& phrases,
+								 juce::uint32 ticksPerQuarterNote)
+{
+  Header fileHeader {};
+  fileHeader.magic = magic;
+  fileHeader.version = currentVersion;
+  fileHeader.ticksPerQuarterNote = ticksPerQuarterNote;
+  fileHeader.numPhrases = (juce::uint32) phrases.size();
+
+  std::vector<PhraseEntry> phraseEntries;
+
+  for (const auto& phrase : phrases)
+	{
+	  phraseEntries.push_back ({ fileHeader.numNotes, (juce::uint32) phrase.notes.size(),
+								 phrase.lengthInTicks, 0 });
+	  fileHeader.numNotes += (juce::uint32) phrase.notes.size();
+	}
+
+  file.deleteFile();
+  juce::FileOutputStream out (file);
+
+  if (! out.openedOk())
+	return false;
+
+  auto ok = out.write (&fileHeader, sizeof (fileHeader));
+
+  if (! phraseEntries.empty())
+	ok = ok && out.write (phraseEntries.data(), phraseEntries.size() * sizeof (PhraseEntry));
+
+  for (const auto& phrase : phrases)
+	if (! phrase.notes.empty())
+	  ok = ok && out.write (phrase.notes.data(), phrase.notes.size() * sizeof (NoteRecord));
+
+  out.flush();
+  return ok && out.getStatus().wasOk();
+}
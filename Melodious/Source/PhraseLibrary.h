@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PatternSequencer.h"
+
+//==============================================================================
+/*
+  On-disk layout of a phrase library (.mphl).
+
+  The file is a Header, then numPhrases PhraseEntry records, then numNotes
+  NoteRecord records. Each PhraseEntry points at a run of notes. Times are in
+  musical ticks rather than samples, so one file works at any sample rate.
+  Everything is little-endian and read in place through a memory map, so these
+  structs must keep their size and layout.
+*/
+namespace PhraseLibraryFormat
+{
+  static constexpr juce::uint32 magic = 0x4c48504d; // "MPHL"
+  static constexpr juce::uint32 currentVersion = 1;
+
+  struct Header
+  {
+	juce::uint32 magic, version;
+	juce::uint32 ticksPerQuarterNote;
+	juce::uint32 numPhrases, numNotes;
+	juce::uint32 reserved[3];
+  };
+
+  struct PhraseEntry
+  {
+	juce::uint32 firstNote, numNotes;
+	juce::uint32 lengthInTicks;
+	juce::uint32 reserved;
+  };
+
+  struct NoteRecord
+  {
+	juce::uint32 startTick, lengthInTicks;
+	juce::uint8 noteNumber, velocity, channel, flags;
+  };
+
+  static_assert (sizeof (Header) == 32, "the file layout depends on this");
+  static_assert (sizeof (PhraseEntry) == 16, "the file layout depends on this");
+  static_assert (sizeof (NoteRecord) == 12, "the file layout depends on this");
+}
+
+//==============================================================================
+/*
+  A read-only, memory-mapped phrase library. Opening one only checks the
+  header and the file size, so it takes the same time for ten phrases or
+  ten thousand, and phrases are read straight out of the mapping.
+*/
+class PhraseLibrary
+{
+public:
+  using NoteRecord = PhraseLibraryFormat::NoteRecord;
+
+  static constexpr juce::uint32 defaultTicksPerQuarterNote = 960;
+  // one loop of the looper is two bars of 4/4
+  static constexpr juce::uint32 defaultLoopLengthInTicks = 8 * defaultTicksPerQuarterNote;
+
+  struct Phrase
+  {
+	const NoteRecord* notes = nullptr;
+	int numNotes = 0;
+	juce::uint32 lengthInTicks = 0;
+  };
+
+  // A phrase as given to writeToFile.
+  struct PhraseData
+  {
+	juce::uint32 lengthInTicks;
+	std::vector<NoteRecord> notes;
+  };
+
+  PhraseLibrary() = default;
+
+  bool open (const juce::File&);
+  void close();
+  bool isOpen() const noexcept                       { return header != nullptr; }
+
+  int getNumPhrases() const noexcept;
+  Phrase getPhrase (int index) const noexcept;
+  juce::uint32 getTicksPerQuarterNote() const noexcept;
+
+  // The phrase's notes as a Pattern, scaled so that the phrase spans loopLengthInTicks.
+  static Pattern createPattern (const Phrase&, int loopLengthInTicks);
+
+  static bool writeToFile (const juce::File&, const std::vector<PhraseData>&,
+						   juce::uint32 ticksPerQuarterNote = defaultTicksPerQuarterNote);
+
+private:
+  std::unique_ptr<juce::MemoryMappedFile> mappedFile;
+  const PhraseLibraryFormat::Header* header = nullptr;
+  const PhraseLibraryFormat::PhraseEntry* entries = nullptr;
+  const NoteRecord* notes = nullptr;
+
+  JUCE_DECLARE_NON_COPYABLE (PhraseLibrary)
+};
@@ -0,0 +1,211 @@
+#include "PitchTracker.h"
+
+void PitchTracker::prepare (double newSampleRate, const Settings& newSettings)
+{
+  settings = newSettings;
+  sampleRate = newSampleRate;
+
+  // YIN compares the first half of the frame with lags of up to a period
+  // of the lowest note, so the frame holds two of them
+  maxLag = (int) std::ceil (sampleRate / settings.lowestFrequency);
+  minLag = juce::jmax (2, (int) std::floor (sampleRate / settings.highestFrequency));
+  frameSize = juce::nextPowerOfTwo (2 * maxLag + 2);
+
+  frame.assign ((size_t) frameSize, 0.0f);
+  spectrum.assign ((size_t) frameSize, {});
+  energies.assign ((size_t) frameSize + 1, 0.0f);
+  difference.assign ((size_t) maxLag + 2, 0.0f);
+
+  twiddles.resize ((size_t) frameSize / 2);
+  for (int i = 0; i < frameSize / 2; ++i)
+	twiddles[(size_t) i] = std::polar (1.0f, (float) (-juce::MathConstants<double>::twoPi * i / frameSize));
+
+  bitReversed.resize ((size_t) frameSize);
+  for (int i = 0, bits = juce::roundToInt (std::log2 (frameSize)); i < frameSize; ++i)
+	{
+	  int reversed = 0;
+	  for (int bit = 0; bit < bits; ++bit)
+		reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+	  bitReversed[(size_t) i] = reversed;
+	}
+
+  reset();
+}
+
+void PitchTracker::reset() noexcept
+{
+  std::fill (frame.begin(), frame.end(), 0.0f);
+  samplesSinceHop = 0;
+  currentNote = pendingNote = -1;
+  pendingHops = 0;
+  lastFrequency = 0.0f;
+  lastAperiodicity = 1.0f;
+}
+
+int PitchTracker::processBlock (const float* samples, int numSamples, juce::int64 streamPosition,
+								NoteEvent* events, int maxEvents) noexcept
+{
+  int numEvents = 0;
+
+  while (numSamples > 0)
+	{
+	  // the frame slides along a hop at a time
+	  const auto chunk = juce::jmin (numSamples, hopSize - samplesSinceHop);
+	  std::copy (frame.begin() + chunk, frame.end(), frame.begin());
+	  std::copy (samples, samples + chunk, frame.end() - chunk);
+
+	  samples += chunk;
+	  numSamples -= chunk;
+	  streamPosition += chunk;
+	  samplesSinceHop += chunk;
+
+	  if (samplesSinceHop < hopSize)
+		continue;
+
+	  samplesSinceHop = 0;
+	  lastFrequency = analyseFrame();
+
+	  auto note = -1;
+	  if (lastFrequency > 0.0f && lastLevel >= settings.gateLevel)
+		{
+		  const auto pitch = 69.0f + 12.0f * std::log2 (lastFrequency / 440.0f);
+		  // a held note bends a little further before it counts as another
+		  note = currentNote >= 0 && std::abs (pitch - currentNote) < 0.7f ? currentNote : juce::roundToInt (pitch);
+		  note = juce::isPositiveAndBelow (note, 128) ? note : -1;
+		}
+
+	  // -40 dB to full scale over the velocity range
+	  const auto decibels = juce::Decibels::gainToDecibels (lastLevel, -40.0f);
+	  const auto velocity = juce::jlimit (1, 127, juce::roundToInt ((decibels + 40.0f) / 40.0f * 127.0f));
+
+	  noteHeard (note, velocity, streamPosition - frameSize / 2, events, maxEvents, numEvents);
+	}
+
+  return numEvents;
+}
+
+void PitchTracker::noteHeard (int note, int velocity, juce::int64 framePosition,
+							  NoteEvent* events, int maxEvents, int& numEvents) noexcept
+{
+  if (note == currentNote)
+	{
+	  pendingNote = currentNote;
+	  pendingHops = 0;
+	  return;
+	}
+
+  if (note != pendingNote || pendingHops == 0)
+	{
+	  pendingNote = note;
+	  pendingHops = 0;
+	  pendingStart = framePosition;
+	}
+
+  if (++pendingHops < settings.hopsToConfirm)
+	return;
+
+  if (currentNote >= 0 && numEvents < maxEvents)
+	events[numEvents++] = { pendingStart, currentNote, 0, false };
+
+  if (note >= 0 && numEvents < maxEvents)
+	events[numEvents++] = { pendingStart, note, velocity, true };
+
+  currentNote = note;
+  pendingHops = 0;
+}
+
+// YIN's difference function is d(lag) = e(0) + e(lag) - 2 r(lag) over the
+// first half of the frame, where e is the energy of a half frame starting at
+// lag and r the correlation of the first half with the frame at lag. The real
+// frame and its first half go through one complex FFT, as the real and
+// imaginary parts, and come apart again in the spectrum.
+float PitchTracker::analyseFrame() noexcept
+{
+  const auto half = frameSize / 2;
+
+  for (int i = 0; i < frameSize; ++i)
+	spectrum[(size_t) i] = { frame[(size_t) i], i < half ? frame[(size_t) i] : 0.0f };
+
+  fft (spectrum.data(), false);
+
+  // X is the frame's spectrum and H the first half's; r is the inverse of conj (H) X
+  const auto product = [] (std::complex<float> z, std::complex<float> mirror)
+	{
+	  const auto x = 0.5f * (z + std::conj (mirror));
+	  const auto h = std::complex<float> (0.0f, -0.5f) * (z - std::conj (mirror));
+	  return std::conj (h) * x;
+	};
+
+  const auto dc = product (spectrum[0], spectrum[0]);
+  for (int k = 1; k <= half; ++k)
+	{
+	  const auto a = spectrum[(size_t) k], b = spectrum[(size_t) (frameSize - k)];
+	  spectrum[(size_t) k] = product (a, b);
+	  spectrum[(size_t) (frameSize - k)] = std::conj (spectrum[(size_t) k]);
+	}
+  spectrum[0] = dc;
+
+  fft (spectrum.data(), true);
+
+  energies[0] = 0.0f;
+  for (int i = 0; i < frameSize; ++i)
+	energies[(size_t) i + 1] = energies[(size_t) i] + frame[(size_t) i] * frame[(size_t) i];
+
+  const auto energyAt = [this, half] (int lag) { return energies[(size_t) (lag + half)] - energies[(size_t) lag]; };
+  // the level is taken around the middle of the frame, where its events go
+  lastLevel = std::sqrt (juce::jmax (0.0f, energies[(size_t) (half + hopSize)] - energies[(size_t) (half - hopSize)])
+						 / (2 * hopSize));
+
+  // the cumulative mean normalised difference, and the first dip below the threshold
+  auto runningSum = 0.0f;
+  auto bestLag = -1;
+  difference[0] = 1.0f;
+
+  for (int lag = 1; lag <= maxLag + 1; ++lag)
+	{
+	  const auto d = juce::jmax (0.0f, energyAt (0) + energyAt (lag) - 2.0f * spectrum[(size_t) lag].real() / frameSize);
+	  runningSum += d;
+	  difference[(size_t) lag] = runningSum > 0.0f ? d * lag / runningSum : 1.0f;
+
+	  if (bestLag < 0 && lag > minLag && difference[(size_t) lag - 1] < settings.threshold
+		  && difference[(size_t) lag] >= difference[(size_t) lag - 1])
+		bestLag = lag - 1;
+	}
+
+  if (bestLag < 0)
+	{
+	  lastAperiodicity = 1.0f;
+	  return 0.0f;
+	}
+
+  // a parabola through the dip and its neighbours finds the lag between samples
+  const auto before = difference[(size_t) bestLag - 1], at = difference[(size_t) bestLag],
+			 after = difference[(size_t) bestLag + 1];
+  const auto curvature = before + after - 2.0f * at;
+  const auto shift = curvature > 0.0f ? juce::jlimit (-0.5f, 0.5f, 0.5f * (before - after) / curvature) : 0.0f;
+
+  lastAperiodicity = at;
+  return (float) (sampleRate / (bestLag + shift));
+}
+
+// An iterative radix-2 FFT; the inverse is left unscaled
+void PitchTracker::fft (std::complex<float>* data, bool inverse) const noexcept
+{
+  for (int i = 0; i < frameSize; ++i)
+	if (i < bitReversed[(size_t) i])
+	  std::swap (data[i], data[bitReversed[(size_t) i]]);
+
+  for (int size = 2; size <= frameSize; size *= 2)
+	{
+	  const auto halfSize = size / 2, step = frameSize / size;
+
+	  for (int start = 0; start < frameSize; start += size)
+		for (int i = 0; i < halfSize; ++i)
+		  {
+			const auto twiddle = inverse ? std::conj (twiddles[(size_t) (i * step)]) : twiddles[(size_t) (i * step)];
+			const auto odd = twiddle * data[start + i + halfSize];
+			data[start + i + halfSize] = data[start + i] - odd;
+			data[start + i] += odd;
+		  }
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <complex>
+
+//==============================================================================
+/*
+  Follows the pitch of one voice or instrument on the audio input and turns
+  it into note-on and note-off events, so a singer or a guitarist can answer
+  the looper without a MIDI keyboard.
+
+  Every hop it runs YIN over the last frame of input: the difference function
+  comes from an FFT cross-correlation rather than the direct sum, so a frame
+  costs two FFTs whatever the lowest note. A note starts once the same
+  semitone has been heard for a few hops running and ends the same way, on
+  silence or on a different note, which keeps vibrato and the odd octave slip
+  from breaking it up.
+
+  Events are placed at the middle of the frame they were first heard in, so
+  they come out getLatencyInSamples() after the sound that started them.
+*/
+class PitchTracker
+{
+public:
+  struct Settings
+  {
+	double lowestFrequency = 70.0, highestFrequency = 1500.0;
+	float threshold = 0.15f;     // how aperiodic a frame may be and still have a pitch
+	float gateLevel = 0.01f;     // RMS below which the input counts as silence
+	int hopsToConfirm = 2;       // how long a note must hold before it starts or stops
+  };
+
+  struct NoteEvent
+  {
+	juce::int64 samplePosition;
+	int noteNumber, velocity;
+	bool isNoteOn;
+  };
+
+  static constexpr int hopSize = 256;
+
+  PitchTracker() = default;
+
+  // Sizes the frame for the lowest frequency and allocates everything. Not
+  // for the audio thread.
+  void prepare (double sampleRate, const Settings&);
+  void prepare (double sampleRate)                { prepare (sampleRate, settings); }
+  void reset() noexcept;
+
+  // Audio thread. Takes a block of mono input starting at streamPosition and
+  // writes the notes that started or stopped in it to events, up to
+  // maxEvents; returns how many.
+  int processBlock (const float* samples, int numSamples, juce::int64 streamPosition,
+					NoteEvent* events, int maxEvents) noexcept;
+
+  int getFrameSize() const noexcept               { return frameSize; }
+  int getLatencyInSamples() const noexcept        { return frameSize / 2 + hopSize * settings.hopsToConfirm; }
+
+  // The last hop's estimate, in Hz, or 0 if it had no clear pitch
+  float getLastFrequency() const noexcept         { return lastFrequency; }
+  float getLastAperiodicity() const noexcept      { return lastAperiodicity; }
+
+private:
+  // YIN over the frame: the frequency, or 0 if nothing is periodic enough
+  float analyseFrame() noexcept;
+  void fft (std::complex<float>* data, bool inverse) const noexcept;
+  void noteHeard (int noteNumber, int velocity, juce::int64 framePosition,
+				  NoteEvent* events, int maxEvents, int& numEvents) noexcept;
+
+  Settings settings;
+  double sampleRate = 44100.0;
+  int frameSize = 0, minLag = 0, maxLag = 0;
+  int samplesSinceHop = 0;
+
+  std::vector<float> frame;                          // the last frameSize input samples
+  std::vector<std::complex<float>> spectrum, twiddles;
+  std::vector<int> bitReversed;
+  std::vector<float> energies, difference;
+
+  int currentNote = -1, pendingNote = -1, pendingHops = 0;
+  juce::int64 pendingStart = 0;
+  float lastFrequency = 0.0f, lastAperiodicity = 1.0f, lastLevel = 0.0f;
+};
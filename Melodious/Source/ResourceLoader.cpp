@@ -0,0 +1,190 @@
+#include "ResourceLoader.h"
+#include "EngineLog.h"
+
+ResourceLoader::ResourceLoader()
+  : juce::Thread ("Resource loader") {}
+
+ResourceLoader::~ResourceLoader()
+{
+  stopThread (4000);
+}
+
+juce::File ResourceLoader::getDefaultPhraseLibraryFile()
+{
+  return juce::File::getSpecialLocation (juce::File::currentExecutableFile).getSiblingFile ("phrases.mphl");
+}
+
+juce::File ResourceLoader::getDefaultGrooveDirectory()
+{
+  return juce::File::getSpecialLocation (juce::File::currentExecutableFile).getSiblingFile ("grooves");
+}
+
+juce::File ResourceLoader::getDefaultInstrumentDirectory()
+{
+  return juce::File::getSpecialLocation (juce::File::currentExecutableFile).getSiblingFile ("instruments");
+}
+
+juce::File ResourceLoader::getDefaultBackgroundImageFile()
+{
+  return juce::File::getSpecialLocation (juce::File::currentExecutableFile).getSiblingFile ("houses.png");
+}
+
+void ResourceLoader::startLoading (const juce::File& phraseLibraryFile, const juce::File& backgroundImageFile,
+								   const juce::File& grooveDirectoryToScan, const juce::File& instrumentDirectoryToScan)
+{
+  // everything is loaded once per run
+  jassert (! isThreadRunning() && ! finished);
+
+  phraseFile = phraseLibraryFile;
+  imageFile = backgroundImageFile;
+  grooveDirectory = grooveDirectoryToScan;
+  instrumentDirectory = instrumentDirectoryToScan;
+  startThread();
+}
+
+bool ResourceLoader::waitUntilLoaded (int timeoutMilliseconds)
+{
+  return loadedEvent.wait (timeoutMilliseconds);
+}
+
+const PhraseLibrary* ResourceLoader::getPhraseLibrary() const noexcept
+{
+  return phrasesReady.load() ? &phraseLibrary : nullptr;
+}
+
+int ResourceLoader::getNumGrooves() const noexcept
+{
+  return numGroovesReady.load();
+}
+
+const Pattern* ResourceLoader::getGroove (int index) const noexcept
+{
+  return juce::isPositiveAndBelow (index, getNumGrooves()) ? &grooves[(size_t) index] : nullptr;
+}
+
+int ResourceLoader::getNumInstruments() const noexcept
+{
+  return numInstrumentsReady.load();
+}
+
+const SampleLibrary* ResourceLoader::getInstrument (int index) const noexcept
+{
+  return juce::isPositiveAndBelow (index, getNumInstruments()) ? instruments[(size_t) index].get() : nullptr;
+}
+
+juce::Image ResourceLoader::getBackgroundImage() const
+{
+  return imageReady.load() ? backgroundImage : juce::Image();
+}
+
+void ResourceLoader::run()
+{
+  // the phrases come first: mapping them is quick and the engine wants them
+  loadPhraseLibrary();
+  sendChangeMessage();
+
+  if (! threadShouldExit())
+	{
+	  loadGrooves();
+	  sendChangeMessage();
+	}
+
+  if (! threadShouldExit())
+	{
+	  loadInstruments();
+	  sendChangeMessage();
+	}
+
+  if (! threadShouldExit())
+	{
+	  loadBackgroundImage();
+	  sendChangeMessage();
+	}
+
+  finished = true;
+  loadedEvent.signal();
+}
+
+void ResourceLoader::loadPhraseLibrary()
+{
+  if (! phraseFile.existsAsFile())
+	EngineLog::error ("Phrase library {} does not exist", phraseFile.getFullPathName());
+  else if (! phraseLibrary.open (phraseFile))
+	EngineLog::error ("{} is not a valid phrase library", phraseFile.getFullPathName());
+  else
+	{
+	  EngineLog::info ("Number of phrases in the library: {}", phraseLibrary.getNumPhrases());
+	  phrasesReady = true;
+	}
+}
+
+void ResourceLoader::loadGrooves()
+{
+  if (grooveDirectory == juce::File() || ! grooveDirectory.isDirectory())
+	return;
+
+  auto files = grooveDirectory.findChildFiles (juce::File::findFiles, false, "*.mid;*.midi");
+  files.sort();
+
+  for (auto& file : files)
+	{
+	  Pattern groove;
+	  juce::String error;
+
+	  if (Pattern::loadFromMidiFile (file, groove, error))
+		grooves.push_back (std::move (groove));
+	  else
+		EngineLog::error ("{}", error);
+	}
+
+  EngineLog::info ("Number of grooves: {}", grooves.size());
+  numGroovesReady = (int) grooves.size();
+}
+
+// Only the attack of each sample is read here, so even a big instrument
+// loads in about the time it takes to open its files.
+void ResourceLoader::loadInstruments()
+{
+  if (instrumentDirectory == juce::File() || ! instrumentDirectory.isDirectory())
+	return;
+
+  auto files = instrumentDirectory.findChildFiles (juce::File::findFiles, false, "*.sfz");
+  files.sort();
+
+  for (auto& file : files)
+	{
+	  std::unique_ptr<SampleLibrary> instrument (new SampleLibrary());
+	  juce::String error;
+	  auto loaded = instrument->load (file, error);
+
+	  if (error.isNotEmpty())
+		EngineLog::error ("{}", error);
+
+	  if (! loaded)
+		continue;
+
+	  EngineLog::info ("Instrument {}: {} regions, {} KB preloaded, {} KB to stream",
+					   instrument->getName(), instrument->getNumRegions(),
+					   instrument->getPreloadBytes() / 1024, instrument->getStreamedBytes() / 1024);
+	  instruments.push_back (std::move (instrument));
+	}
+
+  numInstrumentsReady = (int) instruments.size();
+}
+
+void ResourceLoader::loadBackgroundImage()
+{
+  if (imageFile.existsAsFile())
+	{
+	  juce::FileInputStream inputStreamRef (imageFile);
+	  if (inputStreamRef.openedOk())
+		{
+		  backgroundImage = juce::PNGImageFormat::loadFrom (inputStreamRef);
+		  imageReady = backgroundImage.isValid();
+		}
+	  else
+		EngineLog::error ("Problem opening input stream for background image");
+	}
+  else
+	EngineLog::error ("Background image file does not exist");
+}
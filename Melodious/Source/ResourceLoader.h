@@ -0,0 +1,67 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PhraseLibrary.h"
+#include "PatternSequencer.h"
+#include "SampleLibrary.h"
+
+//==============================================================================
+/*
+  Loads everything the app reads from disk (the phrase library, the backing
+  grooves, the sampled instruments and the background image) on a
+  background thread, starting as soon as the app launches. Listeners get a
+  change message on the message thread each time something finishes.
+  The audio engine only reads data that is already loaded and never waits
+  for it.
+*/
+class ResourceLoader : public juce::ChangeBroadcaster,
+					   private juce::Thread
+{
+public:
+  ResourceLoader();
+  ~ResourceLoader() override;
+
+  // Grooves are every .mid file in grooveDirectory and instruments every .sfz
+  // file in instrumentDirectory, both in name order
+  void startLoading (const juce::File& phraseLibraryFile, const juce::File& backgroundImageFile,
+					 const juce::File& grooveDirectory = {}, const juce::File& instrumentDirectory = {});
+
+  // Blocks the caller until loading has finished; not for the audio or message thread.
+  bool waitUntilLoaded (int timeoutMilliseconds = -1);
+  bool isFinished() const noexcept                   { return finished.load(); }
+
+  // nullptr until the library has been mapped (or if it couldn't be).
+  const PhraseLibrary* getPhraseLibrary() const noexcept;
+  // 0 until the grooves have been read; after that they never change
+  int getNumGrooves() const noexcept;
+  const Pattern* getGroove (int index) const noexcept;
+  // Likewise; only the attacks are in memory, the rest streams from disk
+  int getNumInstruments() const noexcept;
+  const SampleLibrary* getInstrument (int index) const noexcept;
+  // A null image until it has been decoded.
+  juce::Image getBackgroundImage() const;
+
+  static juce::File getDefaultPhraseLibraryFile();
+  static juce::File getDefaultBackgroundImageFile();
+  static juce::File getDefaultGrooveDirectory();
+  static juce::File getDefaultInstrumentDirectory();
+
+private:
+  void run() override;
+  void loadPhraseLibrary();
+  void loadGrooves();
+  void loadInstruments();
+  void loadBackgroundImage();
+
+  juce::File phraseFile, imageFile, grooveDirectory, instrumentDirectory;
+  PhraseLibrary phraseLibrary;
+  std::vector<Pattern> grooves;
+  std::atomic<int> numGroovesReady { 0 };
+  std::vector<std::unique_ptr<SampleLibrary>> instruments;
+  std::atomic<int> numInstrumentsReady { 0 };
+  juce::Image backgroundImage;
+  std::atomic<bool> phrasesReady { false }, imageReady { false }, finished { false };
+  juce::WaitableEvent loadedEvent { true };
+
+  JUCE_DECLARE_NON_COPYABLE (ResourceLoader)
+};
@@ -0,0 +1,279 @@
+#include "SampleLibrary.h"
+
+namespace
+{
+  juce::String removeComments (const juce::String& text)
+  {
+	juce::StringArray lines;
+	lines.addLines (text);
+
+	for (auto& line : lines)
+	  line = line.upToFirstOccurrenceOf ("//", false, false);
+
+	return lines.joinIntoString ("\n");
+  }
+
+  bool isOpcodeCharacter (juce::juce_wchar c)
+  {
+	return juce::CharacterFunctions::isLetterOrDigit (c) || c == '_';
+  }
+
+  // A value runs to the end of the line, the next header or the next space.
+  // File names may contain spaces, so for those a space only ends the value
+  // when the next word is another opcode.
+  int findEndOfValue (const juce::String& text, int start, bool mayContainSpaces)
+  {
+	const auto length = text.length();
+	auto end = start;
+
+	while (end < length && text[end] != '\n' && text[end] != '<')
+	  {
+		if (juce::CharacterFunctions::isWhitespace (text[end]))
+		  {
+			if (! mayContainSpaces)
+			  break;
+
+			auto word = end;
+			while (word < length && (text[word] == ' ' || text[word] == '\t'))
+			  ++word;
+
+			auto wordEnd = word;
+			while (wordEnd < length && isOpcodeCharacter (text[wordEnd]))
+			  ++wordEnd;
+
+			if (wordEnd > word && wordEnd < length && text[wordEnd] == '=')
+			  break;
+		  }
+
+		++end;
+	  }
+
+	return end;
+  }
+
+  int parseKey (const juce::StringPairArray& opcodes, const juce::String& opcode, int fallback)
+  {
+	if (! opcodes.getAllKeys().contains (opcode, true))
+	  return fallback;
+
+	auto note = SampleLibrary::parseNoteNumber (opcodes[opcode]);
+	return note >= 0 ? note : fallback;
+  }
+}
+
+//==============================================================================
+int SampleLibrary::parseNoteNumber (const juce::String& text)
+{
+  auto s = text.trim().toLowerCase();
+
+  if (s.isEmpty())
+	return -1;
+
+  if (s.containsOnly ("0123456789"))
+	return juce::jlimit (0, 127, s.getIntValue());
+
+  static const int semitones[] = { 9, 11, 0, 2, 4, 5, 7 };   // a to g
+
+  if (s[0] < 'a' || s[0] > 'g')
+	return -1;
+
+  auto note = semitones[s[0] - 'a'];
+  auto rest = s.substring (1);
+
+  if (rest.startsWithChar ('#'))       { ++note; rest = rest.substring (1); }
+  else if (rest.startsWithChar ('b'))  { --note; rest = rest.substring (1); }
+
+  auto octave = rest.substring (rest.startsWithChar ('-') ? 1 : 0);
+
+  if (octave.isEmpty() || ! octave.containsOnly ("0123456789"))
+	return -1;
+
+  note += (rest.getIntValue() + 1) * 12;
+  return juce::isPositiveAndBelow (note, 128) ? note : -1;
+}
+
+bool SampleLibrary::load (const juce::File& mappingFile, juce::String& error, int preloadFrames)
+{
+  regions.clear();
+  name = mappingFile.getFileNameWithoutExtension();
+
+  if (! mappingFile.existsAsFile())
+	{
+	  error = mappingFile.getFullPathName() + " does not exist";
+	  return false;
+	}
+
+  juce::AudioFormatManager formats;
+  formats.registerBasicFormats();
+
+  const auto text = removeComments (mappingFile.loadFileAsString());
+  const auto length = text.length();
+  juce::StringPairArray control, group, region;
+  juce::String header;
+  juce::StringArray errors;
+
+  auto finishRegion = [&]
+	{
+	  if (header != "region")
+		return;
+
+	  auto opcodes = group;
+	  opcodes.addArray (region);
+
+	  if (opcodes["sample"].isEmpty())
+		return;
+
+	  std::unique_ptr<Region> newRegion (new Region());
+	  auto path = (control["default_path"] + opcodes["sample"]).replaceCharacter ('\\', '/');
+	  newRegion->file = mappingFile.getParentDirectory().getChildFile (path);
+
+	  auto key = parseKey (opcodes, "key", -1);
+	  newRegion->lowKey = parseKey (opcodes, "lokey", key >= 0 ? key : 0);
+	  newRegion->highKey = parseKey (opcodes, "hikey", key >= 0 ? key : 127);
+	  newRegion->rootKey = parseKey (opcodes, "pitch_keycenter", key >= 0 ? key : 60);
+	  newRegion->lowVelocity = juce::jlimit (1, 127, opcodes.getValue ("lovel", "1").getIntValue());
+	  newRegion->highVelocity = juce::jlimit (1, 127, opcodes.getValue ("hivel", "127").getIntValue());
+	  newRegion->gain = juce::Decibels::decibelsToGain (opcodes.getValue ("volume", "0").getFloatValue());
+
+	  if (opcodes.getAllKeys().contains ("ampeg_release", true))
+		newRegion->releaseSeconds = juce::jlimit (0.001f, 30.0f, opcodes["ampeg_release"].getFloatValue());
+
+	  juce::String regionError;
+
+	  if (loadRegion (*newRegion, formats, preloadFrames, regionError))
+		regions.push_back (std::move (newRegion));
+	  else
+		errors.add (regionError);
+	};
+
+  for (int i = 0; i < length;)
+	{
+	  if (juce::CharacterFunctions::isWhitespace (text[i]))
+		{
+		  ++i;
+		  continue;
+		}
+
+	  if (text[i] == '<')
+		{
+		  auto end = text.indexOfChar (i, '>');
+
+		  if (end < 0)
+			break;
+
+		  finishRegion();
+		  header = text.substring (i + 1, end).trim().toLowerCase();
+		  region.clear();
+
+		  if (header != "region" && header != "control")
+			group.clear();
+
+		  i = end + 1;
+		  continue;
+		}
+
+	  auto equals = text.indexOfChar (i, '=');
+
+	  if (equals < 0)
+		break;
+
+	  // anything before the opcode on this line that isn't one is skipped
+	  auto opcode = text.substring (i, equals).trim().fromLastOccurrenceOf (" ", false, false).toLowerCase();
+	  auto end = findEndOfValue (text, equals + 1, opcode == "sample" || opcode == "default_path");
+	  auto value = text.substring (equals + 1, end).trim();
+	  i = juce::jmax (end, equals + 1);
+
+	  if (header == "region")        region.set (opcode, value);
+	  else if (header == "control")  control.set (opcode, value);
+	  else                           group.set (opcode, value);
+	}
+
+  finishRegion();
+
+  if (! errors.isEmpty())
+	error = errors.joinIntoString ("\n");
+
+  if (regions.empty())
+	{
+	  if (error.isEmpty())
+		error = mappingFile.getFullPathName() + " has no regions";
+
+	  return false;
+	}
+
+  return true;
+}
+
+bool SampleLibrary::loadRegion (Region& region, juce::AudioFormatManager& formats,
+								int preloadFrames, juce::String& error)
+{
+  if (auto* format = formats.findFormatForFileExtension (region.file.getFileExtension()))
+	{
+	  // WAV and AIFF can be mapped; everything else comes back null here
+	  std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (region.file));
+
+	  if (mapped != nullptr && mapped->mapEntireFile())
+		{
+		  region.reader = std::move (mapped);
+		  region.memoryMapped = true;
+		}
+	}
+
+  if (region.reader == nullptr)
+	region.reader.reset (formats.createReaderFor (region.file));
+
+  if (region.reader == nullptr || region.reader->lengthInSamples <= 0)
+	{
+	  error = "could not read " + region.file.getFullPathName();
+	  return false;
+	}
+
+  auto& reader = *region.reader;
+  region.sampleRate = reader.sampleRate;
+  region.numChannels = juce::jlimit (1, 2, (int) reader.numChannels);
+  region.length = reader.lengthInSamples;
+
+  const auto numToPreload = (int) juce::jmin ((juce::int64) juce::jmax (1, preloadFrames), region.length);
+  region.preload.setSize (region.numChannels, numToPreload);
+  reader.read (&region.preload, 0, numToPreload, 0, true, region.numChannels > 1);
+  return true;
+}
+
+const SampleLibrary::Region* SampleLibrary::findRegion (int noteNumber, int velocity) const noexcept
+{
+  for (auto& region : regions)
+	if (noteNumber >= region->lowKey && noteNumber <= region->highKey
+		&& velocity >= region->lowVelocity && velocity <= region->highVelocity)
+	  return region.get();
+
+  return nullptr;
+}
+
+bool SampleLibrary::coversNote (int noteNumber) const noexcept
+{
+  for (auto& region : regions)
+	if (noteNumber >= region->lowKey && noteNumber <= region->highKey)
+	  return true;
+
+  return false;
+}
+
+juce::int64 SampleLibrary::getPreloadBytes() const noexcept
+{
+  juce::int64 bytes = 0;
+
+  for (auto& region : regions)
+	bytes += (juce::int64) region->preload.getNumChannels() * region->getPreloadLength() * (juce::int64) sizeof (float);
+
+  return bytes;
+}
+
+juce::int64 SampleLibrary::getStreamedBytes() const noexcept
+{
+  juce::int64 bytes = 0;
+
+  for (auto& region : regions)
+	bytes += (region->length - region->getPreloadLength()) * region->numChannels * (juce::int64) sizeof (float);
+
+  return bytes;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  A sampled instrument: a set of regions read from an SFZ-like mapping file,
+  each of which plays one audio file over a range of keys and velocities.
+
+  Only the attack of each sample is held in memory. The rest stays on disk
+  and is read by a SampleStreamer while the note sounds; WAV and AIFF files
+  are memory-mapped for that, other formats (FLAC) get an ordinary reader.
+
+  The mapping understands <control>, <group> and <region> headers. Opcodes
+  under a <group> are the defaults for the regions after it:
+
+    <control> default_path=piano/
+    <group> ampeg_release=0.3
+    <region> sample=C4.wav lokey=58 hikey=62 pitch_keycenter=c4
+    <region> sample=C4 soft.flac key=60 lovel=1 hivel=63 volume=-3
+
+  Keys may be numbers or note names (c4 is 60). Unknown opcodes are ignored.
+  A library is loaded once and never changes after that, so the audio thread
+  can read it without locking.
+*/
+class SampleLibrary
+{
+public:
+  // frames of each sample kept in memory; 16384 is a third of a second at 48kHz
+  static constexpr int defaultPreloadFrames = 16384;
+
+  struct Region
+  {
+	juce::File file;
+	int lowKey = 0, highKey = 127, rootKey = 60;
+	int lowVelocity = 1, highVelocity = 127;
+	float gain = 1.0f;              // from volume=, in dB
+	float releaseSeconds = 0.15f;   // ampeg_release=
+
+	double sampleRate = 44100.0;
+	int numChannels = 1;            // 1 or 2; extra channels are dropped
+	juce::int64 length = 0;         // in frames
+	bool memoryMapped = false;
+
+	// The first frames of the sample; all of it when the sample is short
+	juce::AudioBuffer<float> preload;
+	int getPreloadLength() const noexcept   { return preload.getNumSamples(); }
+	bool needsStreaming() const noexcept    { return length > getPreloadLength(); }
+
+	// Read only by the streaming thread once the library has loaded
+	std::unique_ptr<juce::AudioFormatReader> reader;
+  };
+
+  SampleLibrary() = default;
+
+  // Reads the mapping and every sample's attack. Regions whose file can't be
+  // read are left out and reported in error; false if none could be loaded.
+  bool load (const juce::File& mappingFile, juce::String& error,
+			 int preloadFrames = defaultPreloadFrames);
+
+  const juce::String& getName() const noexcept  { return name; }
+  int getNumRegions() const noexcept            { return (int) regions.size(); }
+  const Region& getRegion (int index) const     { return *regions[(size_t) index]; }
+
+  // The first region that covers the note at this velocity (1 to 127), or nullptr
+  const Region* findRegion (int noteNumber, int velocity) const noexcept;
+  bool coversNote (int noteNumber) const noexcept;
+
+  // Memory held by the preloaded attacks, and the sample data left to stream
+  juce::int64 getPreloadBytes() const noexcept;
+  juce::int64 getStreamedBytes() const noexcept;
+
+  // "c4", "C#3", "eb-1" or a plain number; -1 if it's neither
+  static int parseNoteNumber (const juce::String&);
+
+private:
+  bool loadRegion (Region&, juce::AudioFormatManager&, int preloadFrames, juce::String& error);
+
+  juce::String name;
+  std::vector<std::unique_ptr<Region>> regions;
+
+  JUCE_DECLARE_NON_COPYABLE (SampleLibrary)
+};
@@ -0,0 +1,148 @@
+#include "SampleStreamer.h"
+
+SampleStreamer::Stream::Stream (SampleStreamer& streamer)
+  : owner (streamer) {}
+
+void SampleStreamer::Stream::start (const SampleLibrary::Region& regionToPlay) noexcept
+{
+  region.store (&regionToPlay);
+  state.store (((state.load() & ~(juce::uint32) stateMask) + 4) | requested);
+}
+
+void SampleStreamer::Stream::stop() noexcept
+{
+  state.store (((state.load() & ~(juce::uint32) stateMask) + 4) | idle);
+}
+
+int SampleStreamer::Stream::read (juce::AudioBuffer<float>& dest, int destStartFrame, int numFrames) noexcept
+{
+  if (owner.blocking.load())
+	waitForFrames (numFrames);
+
+  if ((state.load() & stateMask) != streaming)
+	return 0;
+
+  int start1, size1, start2, size2;
+  fifo.prepareToRead (numFrames, start1, size1, start2, size2);
+
+  for (int channel = juce::jmin (dest.getNumChannels(), ring.getNumChannels()); --channel >= 0;)
+	{
+	  if (size1 > 0)  dest.copyFrom (channel, destStartFrame, ring, channel, start1, size1);
+	  if (size2 > 0)  dest.copyFrom (channel, destStartFrame + size1, ring, channel, start2, size2);
+	}
+
+  fifo.finishedRead (size1 + size2);
+  return size1 + size2;
+}
+
+int SampleStreamer::Stream::discard (int numFrames) noexcept
+{
+  if ((state.load() & stateMask) != streaming)
+	return 0;
+
+  const auto numToDrop = juce::jmin (numFrames, fifo.getNumReady());
+  fifo.finishedRead (numToDrop);
+  return numToDrop;
+}
+
+void SampleStreamer::Stream::waitForFrames (int numFrames) noexcept
+{
+  for (int i = 0; i < 1000; ++i)
+	{
+	  const auto currentState = state.load() & stateMask;
+
+	  if (currentState == idle || (currentState == streaming && fifo.getNumReady() >= numFrames))
+		return;
+
+	  owner.notify();
+	  juce::Thread::sleep (1);
+	}
+}
+
+// A restart while this runs is harmless: the ring is only read once this
+// thread has seen the new request and reset it.
+int SampleStreamer::Stream::service()
+{
+  auto currentState = state.load();
+
+  if ((currentState & stateMask) == requested)
+	{
+	  fifo.reset();
+	  playing = region.load();
+	  readPosition = playing->getPreloadLength();
+
+	  // restarted again already; it'll be picked up next time round
+	  if (! state.compare_exchange_strong (currentState, (currentState & ~(juce::uint32) stateMask) | streaming))
+		return 0;
+	}
+  else if ((currentState & stateMask) != streaming)
+	{
+	  return 0;
+	}
+
+  const auto numToRead = (int) juce::jmin ((juce::int64) readChunkFrames, (juce::int64) fifo.getFreeSpace(),
+										   playing->length - readPosition);
+
+  if (numToRead <= 0)
+	return 0;
+
+  int start1, size1, start2, size2;
+  fifo.prepareToWrite (numToRead, start1, size1, start2, size2);
+
+  if (size1 > 0)  playing->reader->read (&ring, start1, size1, readPosition, true, true);
+  if (size2 > 0)  playing->reader->read (&ring, start2, size2, readPosition + size1, true, true);
+
+  readPosition += size1 + size2;
+  fifo.finishedWrite (size1 + size2);
+  return size1 + size2;
+}
+
+//==============================================================================
+SampleStreamer::SampleStreamer()
+  : juce::Thread ("Sample streamer")
+{
+  // above the loader and the UI, below the audio thread
+  startThread (8);
+}
+
+SampleStreamer::~SampleStreamer()
+{
+  stopThread (2000);
+}
+
+SampleStreamer::Stream* SampleStreamer::createStream()
+{
+  const juce::ScopedLock sl (lock);
+  return streams.add (new Stream (*this));
+}
+
+void SampleStreamer::releaseStream (Stream* stream)
+{
+  const juce::ScopedLock sl (lock);
+  streams.removeObject (stream);
+}
+
+// One chunk per stream per pass, so a long sample can't hold up the others.
+// While anything is streaming the thread looks in every couple of
+// milliseconds; when nothing is, a new note's attack covers the longer wait.
+void SampleStreamer::run()
+{
+  while (! threadShouldExit())
+	{
+	  auto framesRead = 0;
+	  auto anyStreaming = false;
+
+	  {
+		const juce::ScopedLock sl (lock);
+
+		for (auto* stream : streams)
+		  {
+			framesRead += stream->service();
+			anyStreaming = anyStreaming || (stream->state.load() & Stream::stateMask) != Stream::idle;
+		  }
+	  }
+
+	  if (framesRead == 0)
+		wait (anyStreaming ? 2 : 20);
+	}
+}
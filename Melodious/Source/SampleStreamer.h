@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleLibrary.h"
+
+//==============================================================================
+/*
+  Reads the part of each sounding sample that wasn't preloaded, on its own
+  thread, so the audio thread never waits for the disk.
+
+  Every sampler voice owns a Stream: a ring buffer the streaming thread keeps
+  topped up from the region's reader while the voice takes frames from the
+  other end. A voice plays its preload first, which gives the thread the
+  length of the attack to get the ring filled.
+
+  The audio thread only stores atomics to start or stop a stream and only
+  reads from the ring; resetting the ring and reading the file happen here.
+  If the ring has run dry when the voice needs it, that's an underrun: the
+  voice plays silence for the missing frames and skips them when they come.
+*/
+class SampleStreamer : private juce::Thread
+{
+public:
+  // a third of a second at 48kHz, topped up a chunk at a time
+  static constexpr int ringFrames = 16384, readChunkFrames = 4096;
+
+  class Stream
+  {
+  public:
+	explicit Stream (SampleStreamer&);
+
+	// Audio thread. Starts reading the region from the end of its preload.
+	void start (const SampleLibrary::Region&) noexcept;
+	void stop() noexcept;
+
+	// Audio thread. Copies up to numFrames into dest, returning how many were
+	// ready; the rest are still on their way or past the end of the sample.
+	int read (juce::AudioBuffer<float>& dest, int destStartFrame, int numFrames) noexcept;
+	// Audio thread. Throws frames away, returning how many there were to drop.
+	int discard (int numFrames) noexcept;
+
+  private:
+	friend class SampleStreamer;
+
+	enum : juce::uint32 { idle = 0, requested = 1, streaming = 2, stateMask = 3 };
+
+	// Streaming thread. Reads a chunk if there's room, returning its length.
+	int service();
+	// Audio thread, blocking streamers only
+	void waitForFrames (int numFrames) noexcept;
+
+	SampleStreamer& owner;
+
+	// The low bits are the state, the rest a count of start and stop calls,
+	// so the streaming thread can tell if a stream was restarted under it.
+	std::atomic<juce::uint32> state { idle };
+	std::atomic<const SampleLibrary::Region*> region { nullptr };
+	// streaming thread only
+	const SampleLibrary::Region* playing = nullptr;
+	juce::int64 readPosition = 0;
+	juce::AbstractFifo fifo { ringFrames };
+	juce::AudioBuffer<float> ring { 2, ringFrames };
+
+	JUCE_DECLARE_NON_COPYABLE (Stream)
+  };
+
+  SampleStreamer();
+  ~SampleStreamer() override;
+
+  // Not for the audio thread. The streamer owns the stream until it's released.
+  Stream* createStream();
+  void releaseStream (Stream*);
+
+  // Replaying a session, nothing runs in real time and the audio thread can
+  // wait for the disk: a read that finds the ring short waits for the frames
+  // (for up to a second) instead of leaving a gap.
+  void setBlocking (bool shouldWait) noexcept   { blocking = shouldWait; }
+
+  // Voices call this when a stream had nothing for them
+  void noteUnderrun() noexcept                  { underruns.fetch_add (1); }
+  int getNumUnderruns() const noexcept          { return underruns.load(); }
+
+private:
+  void run() override;
+
+  juce::CriticalSection lock;   // guards streams; never taken on the audio thread
+  juce::OwnedArray<Stream> streams;
+  std::atomic<int> underruns { 0 };
+  std::atomic<bool> blocking { false };
+
+  JUCE_DECLARE_NON_COPYABLE (SampleStreamer)
+};
@@ -0,0 +1,211 @@
+#include "SamplerVoice.h"
+#include <cstring>
+
+bool SamplerSound::appliesToNote (int noteNumber)
+{
+  auto* current = library.load();
+  return current != nullptr && current->coversNote (noteNumber);
+}
+
+//----------------------------------------------------------------------------------------------------
+
+SamplerVoice::SamplerVoice (SampleStreamer& streamerToUse)
+  : streamer (streamerToUse),
+	stream (streamerToUse.createStream()) {}
+
+SamplerVoice::~SamplerVoice()
+{
+  streamer.releaseStream (stream);
+}
+
+bool SamplerVoice::canPlaySound (juce::SynthesiserSound* sound)
+{
+  return dynamic_cast<SamplerSound*> (sound) != nullptr;
+}
+
+void SamplerVoice::startNote (int midiNoteNumber, float velocity,
+							  juce::SynthesiserSound* sound, int /*currentPitchWheelPosition*/)
+{
+  auto* library = static_cast<SamplerSound*> (sound)->getLibrary();
+  region = library != nullptr ? library->findRegion (midiNoteNumber, juce::jlimit (1, 127, juce::roundToInt (velocity * 127.0f)))
+							  : nullptr;
+
+  if (region == nullptr)
+	{
+	  clearCurrentNote();
+	  return;
+	}
+
+  // samples are recorded near full scale; leave room for a chord
+  level = velocity * region->gain * 0.3f;
+  step = juce::jmin ((double) maxPitchRatio, std::pow (2.0, (midiNoteNumber - region->rootKey) / 12.0)
+										   * region->sampleRate / getSampleRate());
+  position = 0.0;
+  windowStart = nextFrame = 0;
+  framesOwed = 0;
+
+  // the sample has its own attack and decay; the envelope only shapes the release
+  if (envelope.getParameters().releaseMs != region->releaseSeconds * 1000.0f)
+	{
+	  AdsrEnvelope::Parameters parameters;
+	  parameters.attackMs = 1.0f;
+	  parameters.decayMs = 0.0f;
+	  parameters.sustainLevel = 1.0f;
+	  parameters.releaseMs = region->releaseSeconds * 1000.0f;
+	  envelope.setParameters (parameters);
+	}
+
+  envelope.setSampleRate (getSampleRate());
+  envelope.noteOn();
+
+  if (region->needsStreaming())
+	stream->start (*region);
+}
+
+void SamplerVoice::stopNote (float /*velocity*/, bool allowTailOff)
+{
+  if (allowTailOff)
+	envelope.noteOff();
+  else
+	endNote();
+}
+
+void SamplerVoice::endNote() noexcept
+{
+  envelope.reset();
+  stream->stop();
+  region = nullptr;
+  clearCurrentNote();
+}
+
+void SamplerVoice::renderNextBlock (juce::AudioSampleBuffer& outputBuffer, int startSample, int numSamples)
+{
+  while (region != nullptr && numSamples > 0)
+	{
+	  auto chunkSize = juce::jmin (numSamples, (int) maxChunkSize);
+	  auto numToRender = envelope.getNextGains (gains, chunkSize);
+	  // the note also ends with its sample
+	  numToRender = juce::jmin (numToRender, (int) std::ceil ((double) (region->length - position) / step));
+
+	  renderSampleChunk (numToRender);
+	  juce::FloatVectorOperations::multiply (gains, level, numToRender);
+
+	  for (int channel = 0; channel < region->numChannels; ++channel)
+		juce::FloatVectorOperations::multiply (chunk.getWritePointer (channel), gains, numToRender);
+
+	  // a mono sample goes to every channel, a stereo one left and right
+	  for (auto i = outputBuffer.getNumChannels(); --i >= 0;)
+		juce::FloatVectorOperations::add (outputBuffer.getWritePointer (i, startSample),
+										  chunk.getReadPointer (juce::jmin (i, region->numChannels - 1)),
+										  numToRender);
+
+	  startSample += numToRender;
+	  numSamples -= numToRender;
+
+	  if (! envelope.isActive() || position >= (double) region->length)
+		endNote();
+	}
+}
+
+// As in SineWaveVoice the position recurrence runs first, so the
+// interpolation loop, done once per channel, has no dependency to carry.
+void SamplerVoice::renderSampleChunk (int numSamples)
+{
+  const auto firstFrame = (juce::int64) position;
+  fillWindow (firstFrame, (juce::int64) (position + step * (numSamples - 1)) + 1);
+
+  auto offset = position - (double) windowStart;
+
+  for (int i = 0; i < numSamples; ++i)
+	{
+	  auto index0 = (int) offset;
+	  indices[i] = index0;
+	  fractions[i] = (float) (offset - index0);
+	  offset += step;
+	}
+
+  position += step * numSamples;
+
+  for (int channel = 0; channel < region->numChannels; ++channel)
+	{
+	  auto* frames = window.getReadPointer (channel);
+	  auto* output = chunk.getWritePointer (channel);
+
+	  for (int i = 0; i < numSamples; ++i)
+		{
+		  auto value0 = frames[indices[i]];
+		  auto value1 = frames[indices[i] + 1];
+		  output[i] = value0 + fractions[i] * (value1 - value0);
+		}
+	}
+}
+
+// Moves the window on so it holds firstFrame to lastFrame: what's behind is
+// dropped, what's missing is fetched, in order, so the stream is read through
+// exactly once.
+void SamplerVoice::fillWindow (juce::int64 firstFrame, juce::int64 lastFrame) noexcept
+{
+  if (firstFrame >= nextFrame)
+	{
+	  // a high note can step right over the frames since the last chunk
+	  while (nextFrame < firstFrame)
+		fetchFrames (0, (int) juce::jmin ((juce::int64) windowSize, firstFrame - nextFrame));
+
+	  windowStart = firstFrame;
+	}
+  else if (firstFrame > windowStart)
+	{
+	  const auto numToDrop = (int) (firstFrame - windowStart);
+	  const auto numToKeep = (int) (nextFrame - firstFrame);
+
+	  for (int channel = 0; channel < region->numChannels; ++channel)
+		{
+		  auto* frames = window.getWritePointer (channel);
+		  std::memmove (frames, frames + numToDrop, (size_t) numToKeep * sizeof (float));
+		}
+
+	  windowStart = firstFrame;
+	}
+
+  if (lastFrame >= nextFrame)
+	fetchFrames ((int) (nextFrame - windowStart), (int) (lastFrame + 1 - nextFrame));
+}
+
+// Copies the next numFrames of the sample into the window at windowOffset:
+// from the preload while it lasts, then from the stream, then silence past
+// the end of the sample.
+void SamplerVoice::fetchFrames (int windowOffset, int numFrames) noexcept
+{
+  const auto numFromPreload = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numFrames,
+												  region->getPreloadLength() - nextFrame);
+
+  if (numFromPreload > 0)
+	for (int channel = 0; channel < region->numChannels; ++channel)
+	  window.copyFrom (channel, windowOffset, region->preload, channel, (int) nextFrame, numFromPreload);
+
+  auto numDone = numFromPreload;
+  const auto numToStream = (int) juce::jlimit ((juce::int64) 0, (juce::int64) (numFrames - numDone),
+											   region->length - (nextFrame + numDone));
+
+  if (numToStream > 0)
+	{
+	  if (framesOwed > 0)
+		framesOwed -= stream->discard (framesOwed);
+
+	  const auto numStreamed = framesOwed > 0 ? 0 : stream->read (window, windowOffset + numDone, numToStream);
+
+	  if (numStreamed < numToStream)
+		{
+		  window.clear (windowOffset + numDone + numStreamed, numToStream - numStreamed);
+		  framesOwed += numToStream - numStreamed;
+		  streamer.noteUnderrun();
+		}
+
+	  numDone += numToStream;
+	}
+
+  if (numDone < numFrames)
+	window.clear (windowOffset + numDone, numFrames - numDone);
+
+  nextFrame += numFrames;
+}
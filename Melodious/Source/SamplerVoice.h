@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SampleLibrary.h"
+#include "SampleStreamer.h"
+#include "AdsrEnvelope.h"
+
+// Plays whichever library it's been given, or nothing while that's nullptr.
+// Swapping libraries leaves the notes already sounding on the old one, so a
+// library has to outlive the synth it was given to.
+struct SamplerSound : public juce::SynthesiserSound
+{
+  SamplerSound() {}
+
+  void setLibrary (const SampleLibrary* newLibrary) noexcept   { library.store (newLibrary); }
+  const SampleLibrary* getLibrary() const noexcept              { return library.load(); }
+
+  bool appliesToNote (int noteNumber) override;
+  bool appliesToChannel (int) override { return true; }
+
+private:
+  std::atomic<const SampleLibrary*> library { nullptr };
+};
+
+// Plays a region of a SampleLibrary, transposed from its root key by reading
+// the sample faster or slower with linear interpolation. The preloaded attack
+// is read straight from memory and the rest comes through the voice's stream.
+struct SamplerVoice : public juce::SynthesiserVoice
+{
+  explicit SamplerVoice (SampleStreamer&);
+  ~SamplerVoice() override;
+
+  bool canPlaySound (juce::SynthesiserSound* sound) override;
+  void startNote (int, float, juce::SynthesiserSound*, int) override;
+  void stopNote (float, bool) override;
+  void pitchWheelMoved (int) override {}
+  void controllerMoved (int, int) override {}
+  void renderNextBlock (juce::AudioSampleBuffer&, int, int) override;
+
+private:
+  void renderSampleChunk (int);
+  void fillWindow (juce::int64 firstFrame, juce::int64 lastFrame) noexcept;
+  void fetchFrames (int windowOffset, int numFrames) noexcept;
+  void endNote() noexcept;
+
+  static constexpr int maxChunkSize = AdsrEnvelope::maxBlockSize;
+  // notes more than two octaves above their root are played flat
+  static constexpr int maxPitchRatio = 4;
+  // the frames one chunk can interpolate between
+  static constexpr int windowSize = maxChunkSize * maxPitchRatio + 2;
+
+  SampleStreamer& streamer;
+  SampleStreamer::Stream* stream = nullptr;
+  const SampleLibrary::Region* region = nullptr;
+  AdsrEnvelope envelope;
+  float level = 0.0f;
+  double position = 0.0, step = 0.0;   // in frames of the sample
+
+  // The sample's frames from windowStart up to nextFrame, copied out of the
+  // preload or the stream. Frames an underrun missed are owed by the stream
+  // and thrown away when they arrive, so the note stays in time.
+  juce::AudioBuffer<float> window { 2, windowSize };
+  juce::int64 windowStart = 0, nextFrame = 0;
+  int framesOwed = 0;
+
+  juce::AudioBuffer<float> chunk { 2, maxChunkSize };
+  alignas (16) float gains[maxChunkSize];
+  alignas (16) float fractions[maxChunkSize];
+  int indices[maxChunkSize];
+};
@@ -0,0 +1,276 @@
+#include "Session.h"
+
+juce::uint32 SessionEvent::hashAudio (const juce::AudioBuffer<float>& buffer, int startSample, int numSamples) noexcept
+{
+  juce::uint32 hash = 2166136261u;
+
+  for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+	{
+	  const auto* samples = buffer.getReadPointer (channel, startSample);
+
+	  for (int i = 0; i < numSamples; ++i)
+		{
+		  juce::uint32 bits;
+		  std::memcpy (&bits, samples + i, sizeof (bits));
+
+		  for (int byte = 0; byte < 4; ++byte)
+			{
+			  hash ^= (bits >> (byte * 8)) & 0xff;
+			  hash *= 16777619u;
+			}
+		}
+	}
+
+  return hash;
+}
+
+//==============================================================================
+namespace SessionFile
+{
+  static void writeControls (juce::OutputStream& out, const LooperAudioSource::Controls& controls)
+  {
+	out.writeCompressedInt ((int) controls.waveform);
+	out.writeFloat (controls.envelope.attackMs);
+	out.writeFloat (controls.envelope.decayMs);
+	out.writeFloat (controls.envelope.sustainLevel);
+	out.writeFloat (controls.envelope.releaseMs);
+	out.writeCompressedInt ((int) controls.envelope.curve);
+	out.writeString (controls.instrument != nullptr ? controls.instrument->getName() : juce::String());
+	out.writeDouble (controls.latencyCompensation);
+	out.writeBool (controls.audioInput);
+  }
+
+  static void readControls (juce::InputStream& in, LooperAudioSource::Controls& controls,
+							juce::String& instrumentName)
+  {
+	controls.waveform = (WavetableBank::Waveform) in.readCompressedInt();
+	controls.envelope.attackMs = in.readFloat();
+	controls.envelope.decayMs = in.readFloat();
+	controls.envelope.sustainLevel = in.readFloat();
+	controls.envelope.releaseMs = in.readFloat();
+	controls.envelope.curve = (AdsrEnvelope::Curve) in.readCompressedInt();
+	instrumentName = in.readString();
+	controls.instrument = nullptr;
+	controls.latencyCompensation = in.readDouble();
+	controls.audioInput = in.readBool();
+  }
+
+  static void writeTransport (juce::OutputStream& out, const Transport::Settings& settings)
+  {
+	out.writeDouble (settings.bpm);
+	out.writeCompressedInt (settings.beatsPerBar);
+	out.writeCompressedInt (settings.beatUnit);
+	out.writeCompressedInt (settings.barsPerLoop);
+  }
+
+  static void readTransport (juce::InputStream& in, Transport::Settings& settings)
+  {
+	settings.bpm = in.readDouble();
+	settings.beatsPerBar = in.readCompressedInt();
+	settings.beatUnit = in.readCompressedInt();
+	settings.barsPerLoop = in.readCompressedInt();
+  }
+
+  void writeHeader (juce::OutputStream& out, const SessionHeader& header)
+  {
+	out.writeInt (magic);
+	out.writeInt (currentVersion);
+	out.writeDouble (header.sampleRate);
+	out.writeCompressedInt (header.blockSize);
+	out.writeInt64 (header.randomSeed);
+	writeControls (out, header.controls);
+	writeTransport (out, header.transport);
+	out.writeCompressedInt (header.groove);
+	out.writeCompressedInt (header.loopIndex);
+	out.writeCompressedInt (header.currentPhase);
+	out.writeCompressedInt (header.currentCyclePos);
+	out.writeDouble (header.loopStartTick);
+	out.writeBool (header.calibrating);
+	out.writeBool (header.calibrationStarting);
+  }
+
+  bool readHeader (juce::InputStream& in, SessionHeader& header, juce::String& instrumentName)
+  {
+	if (in.readInt() != magic || in.readInt() != currentVersion)
+	  return false;
+
+	header.sampleRate = in.readDouble();
+	header.blockSize = in.readCompressedInt();
+	header.randomSeed = in.readInt64();
+	readControls (in, header.controls, instrumentName);
+	readTransport (in, header.transport);
+	header.groove = in.readCompressedInt();
+	header.loopIndex = in.readCompressedInt();
+	header.currentPhase = in.readCompressedInt();
+	header.currentCyclePos = in.readCompressedInt();
+	header.loopStartTick = in.readDouble();
+	header.calibrating = in.readBool();
+	header.calibrationStarting = in.readBool();
+
+	return ! in.isExhausted() && header.sampleRate > 0.0 && header.blockSize > 0;
+  }
+
+  void writeEvent (juce::OutputStream& out, const SessionEvent& event)
+  {
+	using Type = SessionEvent::Type;
+
+	out.writeByte ((char) event.type);
+
+	switch (event.type)
+	  {
+	  case Type::controls:
+		writeControls (out, event.controls);
+		break;
+
+	  case Type::midi:
+	  case Type::keyboard:
+		out.writeCompressedInt (event.position);
+		out.writeByte ((char) event.size);
+		out.write (event.data, (size_t) event.size);
+		break;
+
+	  case Type::timedNote:
+		out.writeCompressedInt (event.note.samplePosition);
+		out.writeCompressedInt (event.note.noteNumber);
+		out.writeCompressedInt (event.note.velocity);
+		out.writeBool (event.note.isNoteOn);
+		out.writeDouble (event.note.time);
+		break;
+
+	  case Type::pitchNote:
+		out.writeInt64 (event.pitchNote.samplePosition);
+		out.writeCompressedInt (event.pitchNote.noteNumber);
+		out.writeCompressedInt (event.pitchNote.velocity);
+		out.writeBool (event.pitchNote.isNoteOn);
+		break;
+
+	  case Type::score:
+		out.writeBool (event.score.type == ScoreMessage::Type::note);
+
+		if (event.score.type == ScoreMessage::Type::note)
+		  {
+			out.writeCompressedInt (event.score.note.index);
+			out.writeCompressedInt (event.score.note.span.start);
+			out.writeCompressedInt (event.score.note.span.end);
+			out.writeCompressedInt (event.score.note.span.noteNumber);
+			out.writeCompressedInt (event.score.note.ticksHeld);
+		  }
+		else
+		  {
+			out.writeCompressedInt (event.score.loopLength);
+			out.writeCompressedInt (event.score.notesGotRight);
+			out.writeCompressedInt (event.score.notesInTotal);
+			out.writeFloat (event.score.harmonyAccuracy);
+		  }
+		break;
+
+	  case Type::transport:
+		writeTransport (out, event.transport);
+		break;
+
+	  case Type::calibration:
+	  case Type::groove:
+	  case Type::phraseSwitch:
+		out.writeCompressedInt (event.value);
+		break;
+
+	  case Type::endOfBlock:
+		out.writeCompressedInt (event.value);
+		out.writeCompressedInt (event.position);
+		out.writeInt ((int) event.hash);
+		break;
+
+	  case Type::numTypes:
+		break;
+	  }
+  }
+
+  bool readEvent (juce::InputStream& in, SessionEvent& event, juce::String& instrumentName)
+  {
+	using Type = SessionEvent::Type;
+
+	if (in.isExhausted())
+	  return false;
+
+	const auto type = (int) (juce::uint8) in.readByte();
+
+	if (type >= (int) Type::numTypes)
+	  return false;
+
+	event = {};
+	event.type = (Type) type;
+
+	switch (event.type)
+	  {
+	  case Type::controls:
+		readControls (in, event.controls, instrumentName);
+		break;
+
+	  case Type::midi:
+	  case Type::keyboard:
+		event.position = in.readCompressedInt();
+		event.size = (int) (juce::uint8) in.readByte();
+
+		if (event.size > SessionEvent::maxMessageSize
+			|| in.read (event.data, event.size) != event.size)
+		  return false;
+		break;
+
+	  case Type::timedNote:
+		event.note.samplePosition = in.readCompressedInt();
+		event.note.noteNumber = in.readCompressedInt();
+		event.note.velocity = in.readCompressedInt();
+		event.note.isNoteOn = in.readBool();
+		event.note.time = in.readDouble();
+		break;
+
+	  case Type::pitchNote:
+		event.pitchNote.samplePosition = in.readInt64();
+		event.pitchNote.noteNumber = in.readCompressedInt();
+		event.pitchNote.velocity = in.readCompressedInt();
+		event.pitchNote.isNoteOn = in.readBool();
+		break;
+
+	  case Type::score:
+		if (in.readBool())
+		  {
+			event.score.type = ScoreMessage::Type::note;
+			event.score.note.index = in.readCompressedInt();
+			event.score.note.span.start = in.readCompressedInt();
+			event.score.note.span.end = in.readCompressedInt();
+			event.score.note.span.noteNumber = in.readCompressedInt();
+			event.score.note.ticksHeld = in.readCompressedInt();
+		  }
+		else
+		  {
+			event.score.type = ScoreMessage::Type::endOfPhrase;
+			event.score.loopLength = in.readCompressedInt();
+			event.score.notesGotRight = in.readCompressedInt();
+			event.score.notesInTotal = in.readCompressedInt();
+			event.score.harmonyAccuracy = in.readFloat();
+		  }
+		break;
+
+	  case Type::transport:
+		readTransport (in, event.transport);
+		break;
+
+	  case Type::calibration:
+	  case Type::groove:
+	  case Type::phraseSwitch:
+		event.value = in.readCompressedInt();
+		break;
+
+	  case Type::endOfBlock:
+		event.value = in.readCompressedInt();
+		event.position = in.readCompressedInt();
+		event.hash = (juce::uint32) in.readInt();
+		break;
+
+	  case Type::numTypes:
+		return false;
+	  }
+
+	return true;
+  }
+}
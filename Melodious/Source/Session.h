@@ -0,0 +1,101 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+
+//==============================================================================
+/*
+  A session is a run of the engine from one prepareToPlay on, kept as
+  everything that decided what it played: the state it started in and the
+  seed its phrases were drawn from, then block by block the input it took
+  in, the changes it picked up, the choices it made at loop boundaries and
+  what it scored, closed by a hash of the block's audio.
+
+  Given the same start and the same events the engine makes the same
+  choices and plays the same samples, which is what lets SessionPlayer run
+  a recording back through it and check every event on the way.
+*/
+struct SessionHeader
+{
+  double sampleRate = 44100.0;
+  int blockSize = 512;
+  juce::int64 randomSeed = 0;       // what generateNextPhrase draws from
+  LooperAudioSource::Controls controls;
+  Transport::Settings transport;
+  int groove = -1;                  // the loader's groove playing, -1 for the built-in one
+  int loopIndex = 0, currentPhase = 1, currentCyclePos = 0;
+  double loopStartTick = 0.0;
+  bool calibrating = false;         // the loop was held for the calibrator
+  bool calibrationStarting = false; // and a calibration run starts with the first block
+};
+
+// One thing that happened in a block, in the order the engine did it
+struct SessionEvent
+{
+  enum class Type : juce::uint8
+  {
+	controls,       // new controls took over at the start of the block
+	midi,           // a message from the MIDI input, at position in the block
+	timedNote,      // a note from the MIDI input; its time is from the start of the callback
+	keyboard,       // a message from the on-screen keyboard, at position
+	pitchNote,      // a note the pitch tracker heard
+	calibration,    // value is 1 if a calibration run started, 0 if it was cancelled
+	score,          // what went to the GuessEvaluator
+	transport,      // new transport settings took over at a loop boundary
+	groove,         // value is the groove picked at a loop boundary
+	phraseSwitch,   // at the start of a phrase: 1 if the next one took over, 0 if it plays again
+	endOfBlock,     // value is the block's length, position its channels; hash is of its audio
+	numTypes
+  };
+
+  // MIDI messages longer than this (SysEx) aren't kept; nothing in the engine reads them
+  static constexpr int maxMessageSize = 12;
+
+  Type type = Type::endOfBlock;
+  int value = 0, position = 0;
+  juce::uint8 data[maxMessageSize] {};
+  int size = 0;
+  MidiInputQueue::TimedNote note {};
+  PitchTracker::NoteEvent pitchNote {};
+  ScoreMessage score;
+  LooperAudioSource::Controls controls;
+  Transport::Settings transport;
+  juce::uint32 hash = 0;
+
+  // FNV-1a over the samples' bit patterns, one channel after another
+  static juce::uint32 hashAudio (const juce::AudioBuffer<float>&, int startSample, int numSamples) noexcept;
+};
+
+// Where LooperAudioSource sends a session as it plays
+class SessionSink
+{
+public:
+  virtual ~SessionSink() = default;
+
+  // From prepareToPlay, with the audio stopped: a new session starts here
+  virtual void beginSession (const SessionHeader&) = 0;
+  // Audio thread
+  virtual void addEvent (const SessionEvent&) noexcept = 0;
+};
+
+//==============================================================================
+/*
+  The session file (.mses): a magic number and a version, the header, then
+  events up to the end of the file. Counts, positions and note numbers are
+  juce's compressed ints; times and the seed are written in full. A sampled
+  instrument is kept by name, and the reader is handed the name to find it
+  again among the loaded instruments.
+*/
+namespace SessionFile
+{
+  static constexpr int magic = 0x5345534d;   // "MSES"
+  static constexpr int currentVersion = 2;
+
+  void writeHeader (juce::OutputStream&, const SessionHeader&);
+  void writeEvent (juce::OutputStream&, const SessionEvent&);
+
+  // False if this isn't a session file, or not a version this can read
+  bool readHeader (juce::InputStream&, SessionHeader&, juce::String& instrumentName);
+  // False at the end of the file or on an event this can't read
+  bool readEvent (juce::InputStream&, SessionEvent&, juce::String& instrumentName);
+}
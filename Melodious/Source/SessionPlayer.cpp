@@ -0,0 +1,247 @@
+#include "SessionPlayer.h"
+
+static const SampleLibrary* findInstrument (const ResourceLoader* loader, const juce::String& name)
+{
+  if (loader != nullptr)
+	for (int i = 0; i < loader->getNumInstruments(); ++i)
+	  if (loader->getInstrument (i)->getName() == name)
+		return loader->getInstrument (i);
+
+  return nullptr;
+}
+
+bool SessionPlayer::load (const juce::File& file, const ResourceLoader* loader, juce::String& error)
+{
+  events.clear();
+  blockEnds.clear();
+
+  juce::FileInputStream fileStream (file);
+
+  if (! fileStream.openedOk())
+	{
+	  error = "Couldn't open " + file.getFullPathName();
+	  return false;
+	}
+
+  juce::BufferedInputStream in (fileStream, 65536);
+  juce::String instrumentName;
+
+  if (! SessionFile::readHeader (in, header, instrumentName))
+	{
+	  error = file.getFullPathName() + " isn't a session this version can read";
+	  return false;
+	}
+
+  const auto findControlsInstrument = [&] (LooperAudioSource::Controls& controls)
+	{
+	  if (instrumentName.isEmpty())
+		return true;
+
+	  controls.instrument = findInstrument (loader, instrumentName);
+
+	  if (controls.instrument == nullptr)
+		error = "The session plays the instrument " + instrumentName + ", which isn't loaded";
+
+	  return controls.instrument != nullptr;
+	};
+
+  if (! findControlsInstrument (header.controls))
+	return false;
+
+  SessionEvent event;
+
+  while (SessionFile::readEvent (in, event, instrumentName))
+	{
+	  if (event.type == SessionEvent::Type::controls && ! findControlsInstrument (event.controls))
+		return false;
+
+	  events.push_back (event);
+
+	  if (event.type == SessionEvent::Type::endOfBlock)
+		blockEnds.push_back ((int) events.size() - 1);
+	}
+
+  // a recording cut off mid-block ends with the last whole one
+  events.resize (blockEnds.empty() ? 0 : (size_t) blockEnds.back() + 1);
+
+  if (blockEnds.empty())
+	{
+	  error = file.getFullPathName() + " has no blocks in it";
+	  return false;
+	}
+
+  return true;
+}
+
+double SessionPlayer::getLengthInSeconds() const noexcept
+{
+  juce::int64 numSamples = 0;
+
+  for (auto end : blockEnds)
+	numSamples += events[(size_t) end].value;
+
+  return (double) numSamples / header.sampleRate;
+}
+
+SessionPlayer::Report SessionPlayer::replay (LooperAudioSource& engine, const BlockCallback& onBlock)
+{
+  report = {};
+  currentBlock = 0;
+  nextEvent = 0;
+
+  auto numChannels = 1, maxBlockSize = header.blockSize;
+
+  for (auto end : blockEnds)
+	{
+	  numChannels = juce::jmax (numChannels, events[(size_t) end].position);
+	  maxBlockSize = juce::jmax (maxBlockSize, events[(size_t) end].value);
+	}
+
+  juce::AudioBuffer<float> buffer (numChannels, maxBlockSize);
+  juce::int64 samplesRendered = 0;
+
+  engine.setReplaySession (&header);
+  engine.setSessionSink (this);
+
+  const auto startTicks = juce::Time::getHighResolutionTicks();
+  engine.prepareToPlay (header.blockSize, header.sampleRate);
+
+  for (auto firstEvent = 0; currentBlock < (int) blockEnds.size(); ++currentBlock)
+	{
+	  const auto end = blockEnds[(size_t) currentBlock];
+	  const auto numSamples = events[(size_t) end].value;
+	  nextEvent = firstEvent;
+
+	  // the block's endOfBlock is the engine's to make, not an input
+	  engine.setReplayBlock (events.data() + firstEvent, end - firstEvent);
+	  engine.getNextAudioBlock (juce::AudioSourceChannelInfo (&buffer, 0, numSamples));
+
+	  if (nextEvent <= end)
+		noteDifference ("the replay left out", &events[(size_t) nextEvent], nullptr);
+
+	  if (onBlock != nullptr)
+		onBlock (buffer, numSamples);
+
+	  firstEvent = end + 1;
+	  samplesRendered += numSamples;
+	}
+
+  report.renderSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+  engine.releaseResources();
+  engine.setSessionSink (nullptr);
+  engine.setReplaySession (nullptr);
+
+  report.numBlocks = (int) blockEnds.size();
+  report.audioSeconds = (double) samplesRendered / header.sampleRate;
+  report.realTimeFactor = report.renderSeconds > 0.0 ? report.audioSeconds / report.renderSeconds : 0.0;
+  report.matched = report.firstDifference.isEmpty();
+  return report;
+}
+
+void SessionPlayer::beginSession (const SessionHeader& replayedHeader)
+{
+  juce::MemoryOutputStream recorded, replayed;
+  SessionFile::writeHeader (recorded, header);
+  SessionFile::writeHeader (replayed, replayedHeader);
+
+  if (recorded.getMemoryBlock() != replayed.getMemoryBlock())
+	noteDifference ("the engine didn't start from the recorded state", nullptr, nullptr);
+}
+
+// The replay runs on this thread, so nothing here has to be real-time safe
+void SessionPlayer::addEvent (const SessionEvent& event) noexcept
+{
+  if (event.type == SessionEvent::Type::score)
+	{
+	  if (event.score.type == ScoreMessage::Type::note)
+		{
+		  ++report.numNotesScored;
+		  report.numNotesRight += event.score.note.isRight() ? 1 : 0;
+		}
+	  else
+		{
+		  ++report.numPhrasesScored;
+		  report.numPhrasesRight += event.score.notesGotRight == event.score.notesInTotal ? 1 : 0;
+		}
+	}
+
+  const auto end = currentBlock < (int) blockEnds.size() ? blockEnds[(size_t) currentBlock] : -1;
+
+  if (nextEvent > end)
+	noteDifference ("the replay added", nullptr, &event);
+  else if (serialise (event) != serialise (events[(size_t) nextEvent]))
+	noteDifference ("the replay changed", &events[(size_t) nextEvent], &event);
+
+  ++nextEvent;
+}
+
+void SessionPlayer::noteDifference (const juce::String& what, const SessionEvent* expected,
+									const SessionEvent* actual)
+{
+  if (report.firstDifference.isNotEmpty())
+	return;
+
+  report.firstDifference = "block " + juce::String (currentBlock) + ": " + what;
+
+  if (expected != nullptr && actual != nullptr)
+	report.firstDifference << " " << describe (*expected) << " to " << describe (*actual);
+  else if (expected != nullptr)
+	report.firstDifference << " " << describe (*expected);
+  else if (actual != nullptr)
+	report.firstDifference << " " << describe (*actual);
+}
+
+juce::MemoryBlock SessionPlayer::serialise (const SessionEvent& event)
+{
+  juce::MemoryOutputStream out;
+  SessionFile::writeEvent (out, event);
+  return out.getMemoryBlock();
+}
+
+juce::String SessionPlayer::describe (const SessionEvent& event)
+{
+  using Type = SessionEvent::Type;
+  const auto noteName = [] (int noteNumber) { return juce::MidiMessage::getMidiNoteName (noteNumber, true, true, 4); };
+
+  switch (event.type)
+	{
+	case Type::controls:      return "a change of controls";
+	case Type::midi:          return "MIDI in at " + juce::String (event.position);
+	case Type::timedNote:     return "a note " + juce::String (event.note.isNoteOn ? "on" : "off")
+								+ " for " + noteName (event.note.noteNumber);
+	case Type::keyboard:      return "a key on the keyboard at " + juce::String (event.position);
+	case Type::pitchNote:     return "a sung note " + juce::String (event.pitchNote.isNoteOn ? "on" : "off")
+								+ " for " + noteName (event.pitchNote.noteNumber);
+	case Type::calibration:   return event.value != 0 ? "a calibration start" : "a calibration cancel";
+	case Type::transport:     return "new transport settings";
+	case Type::groove:        return "groove " + juce::String (event.value);
+	case Type::phraseSwitch:  return event.value != 0 ? "a switch to the next phrase" : "the same phrase again";
+	case Type::endOfBlock:    return "audio with hash " + juce::String::toHexString ((int) event.hash);
+
+	case Type::score:
+	  if (event.score.type == ScoreMessage::Type::note)
+		return "a score of " + juce::String (event.score.note.ticksHeld) + " ticks for note "
+		  + juce::String (event.score.note.index) + " (" + noteName (event.score.note.span.noteNumber) + ")";
+
+	  return "a phrase score of " + juce::String (event.score.notesGotRight) + " of "
+		+ juce::String (event.score.notesInTotal);
+
+	case Type::numTypes:
+	  break;
+	}
+
+  return {};
+}
+
+juce::String SessionPlayer::formatReport (const Report& r)
+{
+  juce::String text;
+  text << "Replayed " << r.numBlocks << " blocks (" << juce::String (r.audioSeconds, 1) << " s of audio) in "
+	   << juce::String (r.renderSeconds, 2) << " s, " << juce::String (r.realTimeFactor, 1) << "x real time\n"
+	   << "  notes scored: " << r.numNotesScored << ", " << r.numNotesRight << " right\n"
+	   << "  phrases scored: " << r.numPhrasesScored << ", " << r.numPhrasesRight << " all right\n"
+	   << (r.matched ? juce::String ("  matches the recording, scores and audio\n")
+					 : "  differs from the recording at " + r.firstDifference + "\n");
+  return text;
+}
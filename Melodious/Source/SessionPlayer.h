@@ -0,0 +1,69 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Session.h"
+
+//==============================================================================
+/*
+  Replays a recorded session through a LooperAudioSource with no audio
+  device, as fast as the machine allows. Each block gets the input the
+  recording had and makes the choices it made where they depended on
+  timing (a phrase that was or wasn't ready in time), and everything the
+  engine does is checked against the recording as it happens: the scores,
+  the choices at loop boundaries and a hash of every block's audio.
+
+  A session that played cleanly replays bit for bit. One where the
+  streaming thread fell behind the sampler doesn't: the replay waits for
+  the disk and plays the notes the recording had gaps in.
+*/
+class SessionPlayer : private SessionSink
+{
+public:
+  struct Report
+  {
+	int numBlocks = 0;
+	double audioSeconds = 0.0, renderSeconds = 0.0;
+	double realTimeFactor = 0.0;                   // audio time / wall time
+	int numNotesScored = 0, numNotesRight = 0;
+	int numPhrasesScored = 0, numPhrasesRight = 0;
+	bool matched = false;
+	juce::String firstDifference;                  // where the replay went its own way, if it did
+  };
+
+  SessionPlayer() = default;
+
+  // Reads a session file. Sampled instruments are looked up by name among
+  // the loader's, which should have finished loading; it may be nullptr for
+  // sessions that only used the wavetables.
+  bool load (const juce::File&, const ResourceLoader*, juce::String& error);
+
+  const SessionHeader& getHeader() const noexcept   { return header; }
+  int getNumBlocks() const noexcept                 { return (int) blockEnds.size(); }
+  double getLengthInSeconds() const noexcept;
+
+  // Called with each block's audio as it's rendered, e.g. to export it
+  using BlockCallback = std::function<void (const juce::AudioBuffer<float>&, int numSamples)>;
+
+  // Runs the whole session through the engine, which should have been given
+  // the same resources. The engine is left stopped and out of replay mode.
+  Report replay (LooperAudioSource&, const BlockCallback& onBlock = nullptr);
+
+  static juce::String formatReport (const Report&);
+
+private:
+  // SessionSink: what the engine does, checked against the recording
+  void beginSession (const SessionHeader&) override;
+  void addEvent (const SessionEvent&) noexcept override;
+  void noteDifference (const juce::String& what, const SessionEvent* expected, const SessionEvent* actual);
+
+  static juce::MemoryBlock serialise (const SessionEvent&);
+  static juce::String describe (const SessionEvent&);
+
+  SessionHeader header;
+  std::vector<SessionEvent> events;
+  std::vector<int> blockEnds;             // the index of each block's endOfBlock
+
+  // during a replay
+  Report report;
+  int currentBlock = 0, nextEvent = 0;
+};
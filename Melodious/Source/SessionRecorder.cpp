@@ -0,0 +1,103 @@
+#include "SessionRecorder.h"
+#include "EngineLog.h"
+
+SessionRecorder::SessionRecorder()
+  : juce::Thread ("Session recorder"),
+	events ((size_t) numEvents)
+{
+  startThread (3);
+}
+
+SessionRecorder::~SessionRecorder()
+{
+  stopThread (2000);
+
+  const juce::ScopedLock sl (streamLock);
+  writePending();
+  stream.reset();
+}
+
+void SessionRecorder::setFile (const juce::File& newFile)
+{
+  const juce::ScopedLock sl (streamLock);
+  file = newFile;
+  numSessions = 0;
+}
+
+juce::File SessionRecorder::getCurrentFile() const
+{
+  const juce::ScopedLock sl (streamLock);
+  return currentFile;
+}
+
+// The audio is stopped, so the FIFO only holds what's left of the last session
+void SessionRecorder::beginSession (const SessionHeader& header)
+{
+  const juce::ScopedLock sl (streamLock);
+  writePending();
+  stream.reset();
+  currentFile = {};
+
+  if (file == juce::File())
+	return;
+
+  ++numSessions;
+  const auto nextFile = numSessions == 1 ? file
+										 : file.getSiblingFile (file.getFileNameWithoutExtension() + "-"
+																+ juce::String (numSessions) + file.getFileExtension());
+  nextFile.deleteFile();
+  stream = nextFile.createOutputStream();
+
+  if (stream == nullptr)
+	{
+	  EngineLog::error ("Couldn't record the session to {}", nextFile.getFullPathName());
+	  return;
+	}
+
+  currentFile = nextFile;
+  SessionFile::writeHeader (*stream, header);
+  EngineLog::info ("Recording the session to {}", nextFile.getFullPathName());
+}
+
+void SessionRecorder::addEvent (const SessionEvent& event) noexcept
+{
+  int start1, size1, start2, size2;
+  fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+  if (size1 == 0)
+	{
+	  dropped.fetch_add (1);
+	  return;
+	}
+
+  events[(size_t) start1] = event;
+  fifo.finishedWrite (1);
+}
+
+void SessionRecorder::writePending()
+{
+  int start1, size1, start2, size2;
+  fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+  if (stream != nullptr)
+	{
+	  for (int i = 0; i < size1; ++i)  SessionFile::writeEvent (*stream, events[(size_t) (start1 + i)]);
+	  for (int i = 0; i < size2; ++i)  SessionFile::writeEvent (*stream, events[(size_t) (start2 + i)]);
+	  stream->flush();
+	}
+
+  fifo.finishedRead (size1 + size2);
+}
+
+void SessionRecorder::run()
+{
+  while (! threadShouldExit())
+	{
+	  {
+		const juce::ScopedLock sl (streamLock);
+		writePending();
+	  }
+
+	  wait (20);
+	}
+}
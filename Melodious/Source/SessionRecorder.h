@@ -0,0 +1,54 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Session.h"
+
+//==============================================================================
+/*
+  Writes the sessions a LooperAudioSource plays to disk, for SessionPlayer
+  to replay. The audio thread only copies each event into a lock-free FIFO;
+  a writer thread of its own empties it into the file every 20 ms, which
+  keeps up with an offline render at hundreds of times real time.
+
+  Every prepareToPlay starts a new session, so a device restart doesn't
+  break a recording: the first goes to the file given, the next to
+  "name-2.mses" and so on. If the writer falls so far behind that the FIFO
+  fills, events are dropped and counted, and that session won't replay.
+*/
+class SessionRecorder : public SessionSink,
+						private juce::Thread
+{
+public:
+  // several seconds of a busy student's playing at 256-sample blocks
+  static constexpr int numEvents = 8192;
+
+  SessionRecorder();
+  ~SessionRecorder() override;
+
+  // Where the next session goes; an empty File stops recording
+  void setFile (const juce::File&);
+  // The file the current session is going to, if any
+  juce::File getCurrentFile() const;
+  int getNumDropped() const noexcept          { return dropped.load(); }
+
+  // SessionSink
+  void beginSession (const SessionHeader&) override;
+  void addEvent (const SessionEvent&) noexcept override;
+
+private:
+  void run() override;
+  // Moves whatever the FIFO holds into the file; called with streamLock held
+  void writePending();
+
+  juce::CriticalSection streamLock;   // guards everything below but the FIFO
+  juce::File file;
+  int numSessions = 0;
+  juce::File currentFile;
+  std::unique_ptr<juce::FileOutputStream> stream;
+
+  juce::AbstractFifo fifo { numEvents };
+  std::vector<SessionEvent> events;
+  std::atomic<int> dropped { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (SessionRecorder)
+};
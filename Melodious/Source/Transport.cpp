@@ -0,0 +1,77 @@
+#include "Transport.h"
+
+int Transport::Settings::getTicksPerBeat() const noexcept
+{
+  return ticksPerQuarterNote * 4 / beatUnit;
+}
+
+int Transport::Settings::getLoopLengthInTicks() const noexcept
+{
+  return barsPerLoop * beatsPerBar * getTicksPerBeat();
+}
+
+double Transport::getSamplesPerTick (const Settings& settings, double sampleRate) noexcept
+{
+  return 60.0 * sampleRate / (settings.bpm * settings.getTicksPerBeat());
+}
+
+Transport::Settings Transport::sanitise (Settings settings) noexcept
+{
+  settings.bpm = juce::jlimit (20.0, 400.0, settings.bpm);
+  settings.beatsPerBar = juce::jlimit (1, 32, settings.beatsPerBar);
+  settings.barsPerLoop = juce::jlimit (1, 16, settings.barsPerLoop);
+
+  // the beat has to divide a whole note into whole ticks
+  if (settings.beatUnit != 2 && settings.beatUnit != 4 && settings.beatUnit != 8 && settings.beatUnit != 16)
+	settings.beatUnit = 4;
+
+  return settings;
+}
+
+void Transport::requestSettings (const Settings& newSettings)
+{
+  const juce::SpinLock::ScopedLockType sl (pendingLock);
+  pending = sanitise (newSettings);
+  hasPending = true;
+}
+
+Transport::Settings Transport::getRequestedSettings() const
+{
+  const juce::SpinLock::ScopedLockType sl (pendingLock);
+  return hasPending.load() ? pending : current;
+}
+
+bool Transport::prepare (double newSampleRate) noexcept
+{
+  sampleRate = newSampleRate;
+  applyPendingSettings();
+  update();
+  return true;
+}
+
+bool Transport::applyPendingSettings() noexcept
+{
+  if (! hasPending.load())
+	return false;
+
+  // if the message thread is mid-request, catch it at the next boundary
+  const juce::SpinLock::ScopedTryLockType sl (pendingLock);
+
+  if (! sl.isLocked())
+	return false;
+
+  current = pending;
+  hasPending = false;
+  update();
+  return true;
+}
+
+// The loop is a whole number of samples, and the tick length is trimmed to
+// fit it exactly, so that a tick position and a sample position agree again
+// at every loop boundary rather than drifting apart over a long session.
+void Transport::update() noexcept
+{
+  loopLengthInTicks = current.getLoopLengthInTicks();
+  samplesPerLoop = juce::jmax (1, juce::roundToInt (loopLengthInTicks * getSamplesPerTick (current, sampleRate)));
+  samplesPerTick = (double) samplesPerLoop / (double) loopLengthInTicks;
+}
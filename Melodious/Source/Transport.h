@@ -0,0 +1,59 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  The looper's musical clock: tempo, time signature and loop length in bars.
+  Everything the engine plays or records is kept in ticks, and this is the
+  one place they turn into samples, so a new tempo only changes a couple of
+  numbers here.
+
+  Changes are requested from any thread and take effect when the audio
+  thread calls applyPendingSettings, which it does at loop boundaries.
+*/
+class Transport
+{
+public:
+  static constexpr int ticksPerQuarterNote = 960;
+
+  struct Settings
+  {
+	double bpm = 96.0;               // beats of beatUnit per minute
+	int beatsPerBar = 4, beatUnit = 4;
+	int barsPerLoop = 2;
+
+	int getTicksPerBeat() const noexcept;
+	int getLoopLengthInTicks() const noexcept;
+  };
+
+  Transport() = default;
+
+  void requestSettings (const Settings&);
+  // The last requested settings, applied or not
+  Settings getRequestedSettings() const;
+
+  // Audio thread. Both return true if the timing changed.
+  bool prepare (double sampleRate) noexcept;
+  bool applyPendingSettings() noexcept;
+
+  // The settings in effect, for the audio thread
+  const Settings& getSettings() const noexcept   { return current; }
+  double getSamplesPerTick() const noexcept      { return samplesPerTick; }
+  int getSamplesPerLoop() const noexcept         { return samplesPerLoop; }
+  int getLoopLengthInTicks() const noexcept      { return loopLengthInTicks; }
+
+  static double getSamplesPerTick (const Settings&, double sampleRate) noexcept;
+
+private:
+  static Settings sanitise (Settings) noexcept;
+  void update() noexcept;
+
+  Settings current;
+  double sampleRate = 44100.0, samplesPerTick = 0.0;
+  int samplesPerLoop = 0, loopLengthInTicks = 0;
+
+  mutable juce::SpinLock pendingLock;
+  Settings pending;
+  std::atomic<bool> hasPending { false };
+};
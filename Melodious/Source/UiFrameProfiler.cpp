@@ -0,0 +1,59 @@
+#include "UiFrameProfiler.h"
+#include "EngineLog.h"
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #include <time.h>
+#endif
+
+UiFrameProfiler::UiFrameProfiler (double reportIntervalSeconds)
+  : reportInterval (reportIntervalSeconds) {}
+
+double UiFrameProfiler::getThreadCpuSeconds() noexcept
+{
+ #if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+  timespec now;
+
+  if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &now) == 0)
+	return (double) now.tv_sec + (double) now.tv_nsec * 1.0e-9;
+ #endif
+
+  return juce::Time::getMillisecondCounterHiRes() * 0.001;
+}
+
+void UiFrameProfiler::frameStarted()
+{
+  const auto cpuNow = getThreadCpuSeconds();
+  const auto wallNow = juce::Time::getMillisecondCounterHiRes() * 0.001;
+
+  if (lastCpuSeconds < 0.0)
+	{
+	  lastCpuSeconds = cpuNow;
+	  intervalStartSeconds = wallNow;
+	  return;
+	}
+
+  const auto frameCpu = cpuNow - lastCpuSeconds;
+  lastCpuSeconds = cpuNow;
+
+  cpuInInterval += frameCpu;
+  worstFrame = juce::jmax (worstFrame, frameCpu);
+  ++framesInInterval;
+
+  if (wallNow - intervalStartSeconds >= reportInterval)
+	{
+	  report (wallNow - intervalStartSeconds);
+	  intervalStartSeconds = wallNow;
+	  cpuInInterval = worstFrame = 0.0;
+	  framesInInterval = 0;
+	}
+}
+
+void UiFrameProfiler::report (double wallSeconds)
+{
+  if (framesInInterval == 0 || wallSeconds <= 0.0)
+	return;
+
+  EngineLog::info ("UI: {} frames/s, CPU per frame avg {} ms, max {} ms, {}% of a core",
+				   framesInInterval / wallSeconds, cpuInInterval * 1000.0 / framesInInterval,
+				   worstFrame * 1000.0, cpuInInterval * 100.0 / wallSeconds);
+}
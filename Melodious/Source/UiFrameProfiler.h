@@ -0,0 +1,33 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Measures how much CPU the message thread spends per animation frame. Call
+  frameStarted() from the animation timer; the time charged to a frame is
+  everything the thread did since the previous call, so the repaints that
+  followed the last tick are counted too. A summary goes to the log every
+  few seconds.
+*/
+class UiFrameProfiler
+{
+public:
+  explicit UiFrameProfiler (double reportIntervalSeconds = 5.0);
+
+  void frameStarted();
+
+  // CPU time used by the calling thread so far, or wall-clock time on
+  // platforms without a per-thread clock
+  static double getThreadCpuSeconds() noexcept;
+
+private:
+  void report (double wallSeconds);
+
+  double reportInterval;
+  double lastCpuSeconds = -1.0, intervalStartSeconds = 0.0;
+  double cpuInInterval = 0.0, worstFrame = 0.0;
+  int framesInInterval = 0;
+
+  JUCE_DECLARE_NON_COPYABLE (UiFrameProfiler)
+};
@@ -0,0 +1,84 @@
+#include "VoicePool.h"
+#include <algorithm>
+
+void VoicePool::allocateVoices (int numVoices, const std::function<juce::SynthesiserVoice*()>& createVoice)
+{
+  const juce::ScopedLock sl (lock);
+
+  clearVoices();
+  activeVoices.clear();
+  activeVoices.reserve ((size_t) numVoices);
+
+  for (int i = 0; i < numVoices; ++i)
+	addVoice (createVoice());
+}
+
+juce::SynthesiserVoice* VoicePool::findFreeVoice (juce::SynthesiserSound* soundToPlay, int midiChannel,
+												  int midiNoteNumber, bool stealIfNoneAvailable) const
+{
+  auto* voice = juce::Synthesiser::findFreeVoice (soundToPlay, midiChannel, midiNoteNumber,
+												  stealIfNoneAvailable);
+
+  // a stolen voice is on the list already
+  if (voice != nullptr && std::find (activeVoices.begin(), activeVoices.end(), voice) == activeVoices.end())
+	activeVoices.push_back (voice);
+
+  return voice;
+}
+
+juce::SynthesiserVoice* VoicePool::findVoiceToSteal (juce::SynthesiserSound* soundToPlay,
+													 int, int) const
+{
+  juce::SynthesiserVoice* oldestReleasing = nullptr;
+  juce::SynthesiserVoice* oldestHeld = nullptr;
+  juce::SynthesiserVoice* lowestHeld = nullptr;
+
+  for (auto* voice : activeVoices)
+	{
+	  if (! voice->canPlaySound (soundToPlay))
+		continue;
+
+	  if (voice->isPlayingButReleased())
+		{
+		  if (oldestReleasing == nullptr || voice->wasStartedBefore (*oldestReleasing))
+			oldestReleasing = voice;
+		}
+	  else if (lowestHeld == nullptr || voice->getCurrentlyPlayingNote() < lowestHeld->getCurrentlyPlayingNote())
+		{
+		  lowestHeld = voice;
+		}
+	}
+
+  if (oldestReleasing != nullptr)
+	return oldestReleasing;
+
+  for (auto* voice : activeVoices)
+	if (voice != lowestHeld && voice->canPlaySound (soundToPlay) && ! voice->isPlayingButReleased()
+		&& (oldestHeld == nullptr || voice->wasStartedBefore (*oldestHeld)))
+	  oldestHeld = voice;
+
+  // only one note held: it has to go, bass or not
+  return oldestHeld != nullptr ? oldestHeld : lowestHeld;
+}
+
+template <typename FloatType>
+void VoicePool::renderActiveVoices (juce::AudioBuffer<FloatType>& buffer, int startSample, int numSamples)
+{
+  for (auto* voice : activeVoices)
+	voice->renderNextBlock (buffer, startSample, numSamples);
+
+  // erase never gives memory back, so the reserved capacity stays put
+  activeVoices.erase (std::remove_if (activeVoices.begin(), activeVoices.end(),
+									  [] (juce::SynthesiserVoice* voice) { return ! voice->isVoiceActive(); }),
+					  activeVoices.end());
+}
+
+void VoicePool::renderVoices (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+{
+  renderActiveVoices (buffer, startSample, numSamples);
+}
+
+void VoicePool::renderVoices (juce::AudioBuffer<double>& buffer, int startSample, int numSamples)
+{
+  renderActiveVoices (buffer, startSample, numSamples);
+}
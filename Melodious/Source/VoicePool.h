@@ -0,0 +1,46 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  A Synthesiser whose voices are all allocated up front and which only
+  renders the ones that are sounding. Voices join the active list when a note
+  is given to them and leave it on the block they fall silent in, so a big
+  pool costs nothing while it sits idle.
+
+  When every voice is busy the oldest voice that's already releasing is
+  stolen; failing that, the oldest held note that isn't the lowest one, so the
+  bass line keeps sounding under a chord.
+*/
+class VoicePool : public juce::Synthesiser
+{
+public:
+  VoicePool() = default;
+
+  // Replaces all the voices with numVoices new ones. Not for the audio thread.
+  void allocateVoices (int numVoices, const std::function<juce::SynthesiserVoice*()>& createVoice);
+
+  // Only meaningful on the thread that renders.
+  int getNumActiveVoices() const noexcept { return (int) activeVoices.size(); }
+
+protected:
+  juce::SynthesiserVoice* findFreeVoice (juce::SynthesiserSound*, int midiChannel,
+										 int midiNoteNumber, bool stealIfNoneAvailable) const override;
+  juce::SynthesiserVoice* findVoiceToSteal (juce::SynthesiserSound*, int midiChannel,
+											int midiNoteNumber) const override;
+
+  void renderVoices (juce::AudioBuffer<float>&, int startSample, int numSamples) override;
+  void renderVoices (juce::AudioBuffer<double>&, int startSample, int numSamples) override;
+
+private:
+  template <typename FloatType>
+  void renderActiveVoices (juce::AudioBuffer<FloatType>&, int startSample, int numSamples);
+
+  // findFreeVoice is const in Synthesiser, but it's where a voice gets picked
+  // for a note, so that's where it goes on the list. The capacity is reserved
+  // for the whole pool, so this never allocates on the audio thread.
+  mutable std::vector<juce::SynthesiserVoice*> activeVoices;
+
+  JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoicePool)
+};
@@ -0,0 +1,111 @@
+#include "WavetableBank.h"
+
+WavetableBank::WavetableBank()
+{
+  for (int i = 0; i < numWaveforms; ++i)
+	build ((Waveform) i);
+}
+
+int WavetableBank::getLevelForDelta (float tableDelta) noexcept
+{
+  auto level = 0;
+
+  while (level < numLevels - 1 && (float) (1 << level) < tableDelta)
+	++level;
+
+  return level;
+}
+
+const float* WavetableBank::getTable (Waveform waveform, float tableDelta) const noexcept
+{
+  return tables[(int) waveform].getReadPointer (getLevelForDelta (tableDelta));
+}
+
+juce::String WavetableBank::getWaveformName (Waveform waveform)
+{
+  switch (waveform)
+	{
+	case Waveform::sine:   return "sine";
+	case Waveform::saw:    return "saw";
+	case Waveform::square: return "square";
+	case Waveform::piano:  return "piano";
+	}
+
+  return {};
+}
+
+bool WavetableBank::parseWaveform (const juce::String& name, Waveform& result)
+{
+  for (int i = 0; i < numWaveforms; ++i)
+	{
+	  if (name.trim().equalsIgnoreCase (getWaveformName ((Waveform) i)))
+		{
+		  result = (Waveform) i;
+		  return true;
+		}
+	}
+
+  return false;
+}
+
+double WavetableBank::getHarmonicAmplitude (Waveform waveform, int harmonic)
+{
+  switch (waveform)
+	{
+	case Waveform::sine:   return harmonic == 1 ? 1.0 : 0.0;
+	case Waveform::saw:    return 1.0 / harmonic;
+	case Waveform::square: return (harmonic & 1) != 0 ? 1.0 / harmonic : 0.0;
+	case Waveform::piano:  return std::exp (-0.35 * (harmonic - 1)) / harmonic;
+	}
+
+  return 0.0;
+}
+
+// Additive synthesis from the top level down: each level is the one above it
+// plus the next octave of harmonics. sin (2 pi h n / N) is an exact lookup at
+// (h * n) mod N, so the whole bank costs one std::sin per table sample.
+void WavetableBank::build (Waveform waveform)
+{
+  auto& buffer = tables[(int) waveform];
+  buffer.setSize (numLevels, tableSize + 1);
+
+  std::vector<double> sine ((size_t) tableSize), sum ((size_t) tableSize, 0.0);
+
+  for (int i = 0; i < tableSize; ++i)
+	sine[(size_t) i] = std::sin (juce::MathConstants<double>::twoPi * i / tableSize);
+
+  auto harmonicsSoFar = 0;
+  auto peak = 0.0;
+
+  for (int level = numLevels; --level >= 0;)
+	{
+	  const auto numHarmonics = tableSize >> (level + 1);
+
+	  for (int harmonic = harmonicsSoFar + 1; harmonic <= numHarmonics; ++harmonic)
+		{
+		  const auto amplitude = getHarmonicAmplitude (waveform, harmonic);
+
+		  if (amplitude < 1.0e-6)
+			continue;
+
+		  for (int i = 0; i < tableSize; ++i)
+			sum[(size_t) i] += amplitude * sine[(size_t) ((harmonic * i) & (tableSize - 1))];
+		}
+
+	  harmonicsSoFar = numHarmonics;
+
+	  auto* samples = buffer.getWritePointer (level);
+
+	  for (int i = 0; i < tableSize; ++i)
+		{
+		  samples[i] = (float) sum[(size_t) i];
+		  peak = juce::jmax (peak, std::abs (sum[(size_t) i]));
+		}
+
+	  samples[tableSize] = samples[0];
+	}
+
+  // the same gain for every level, so notes don't jump in level between octaves
+  if (peak > 0.0)
+	buffer.applyGain ((float) (1.0 / peak));
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  Band-limited wavetables for the synth voices, one set per waveform with a
+  table for every octave (a mip level). Level n holds tableSize >> (n + 1)
+  harmonics, so a note that steps 2^n samples through the table per output
+  sample still has nothing above Nyquist. Everything is built once, when the
+  bank is constructed; a voice only picks a table when its note starts.
+*/
+class WavetableBank
+{
+public:
+  enum class Waveform
+  {
+	sine = 0,
+	saw,
+	square,
+	piano    // an additive tone whose upper harmonics fall away quickly
+  };
+
+  static constexpr int numWaveforms = 4;
+  static constexpr int tableSize = 1 << 11;  // each table has a guard sample after this
+  static constexpr int numLevels = 11;
+
+  WavetableBank();
+
+  // The richest table that doesn't alias for a note stepping tableDelta
+  // samples through the table per output sample
+  const float* getTable (Waveform, float tableDelta) const noexcept;
+  static int getLevelForDelta (float tableDelta) noexcept;
+
+  static juce::String getWaveformName (Waveform);
+  static bool parseWaveform (const juce::String&, Waveform&);
+
+private:
+  void build (Waveform);
+  static double getHarmonicAmplitude (Waveform, int harmonic);
+
+  // one buffer per waveform, one channel per level
+  juce::AudioSampleBuffer tables[numWaveforms];
+
+  JUCE_DECLARE_NON_COPYABLE (WavetableBank)
+};
@@ -0,0 +1,142 @@
+#include "WorkStealingPool.h"
+
+//==============================================================================
+class WorkStealingPool::Worker : public juce::Thread
+{
+public:
+  Worker (WorkStealingPool& p, int workerIndex, int maxJobs)
+	: juce::Thread ("Pool worker " + juce::String (workerIndex + 1)),
+	  pool (p), index (workerIndex), jobs ((size_t) maxJobs)
+  {
+  }
+
+  // The owner's end of the deque
+  bool pushBack (Job& job) noexcept
+  {
+	const juce::SpinLock::ScopedLockType sl (lock);
+
+	if (size == (int) jobs.size())
+	  return false;
+
+	jobs[(size_t) ((front + size) % (int) jobs.size())] = &job;
+	++size;
+	return true;
+  }
+
+  Job* popBack() noexcept
+  {
+	const juce::SpinLock::ScopedLockType sl (lock);
+
+	if (size == 0)
+	  return nullptr;
+
+	--size;
+	return jobs[(size_t) ((front + size) % (int) jobs.size())];
+  }
+
+  // The thieves' end
+  Job* popFront() noexcept
+  {
+	const juce::SpinLock::ScopedLockType sl (lock);
+
+	if (size == 0)
+	  return nullptr;
+
+	auto* job = jobs[(size_t) front];
+	front = (front + 1) % (int) jobs.size();
+	--size;
+	return job;
+  }
+
+  juce::WaitableEvent wake;
+
+private:
+  void run() override
+  {
+	while (! threadShouldExit())
+	  {
+		if (auto* job = pool.takeJob (index))
+		  {
+			job->runJob();
+			pool.numRun.fetch_add (1);
+			pool.numPending.fetch_sub (1);
+		  }
+		else
+		  {
+			// a job queued between the search and here has already signalled
+			wake.wait (100);
+		  }
+	  }
+  }
+
+  WorkStealingPool& pool;
+  const int index;
+  juce::SpinLock lock;
+  std::vector<Job*> jobs;
+  int front = 0, size = 0;
+};
+
+//==============================================================================
+WorkStealingPool::WorkStealingPool (int numWorkers, int maxJobsPerWorker, int threadPriority)
+{
+  for (int i = 0; i < juce::jmax (1, numWorkers); ++i)
+	workers.push_back (std::make_unique<Worker> (*this, i, juce::jmax (1, maxJobsPerWorker)));
+
+  for (auto& worker : workers)
+	worker->startThread (threadPriority);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+  for (auto& worker : workers)
+	worker->signalThreadShouldExit();
+
+  // every thread has to be gone before any deque is, or a thief could still reach it
+  for (auto& worker : workers)
+	{
+	  worker->wake.signal();
+	  worker->stopThread (2000);
+	}
+
+  workers.clear();
+}
+
+bool WorkStealingPool::addJob (Job& job, int worker) noexcept
+{
+  // counted first, so waitUntilIdle can't see the job gone before it's run
+  numPending.fetch_add (1);
+
+  if (workers[(size_t) (worker % getNumWorkers())]->pushBack (job))
+	return true;
+
+  numPending.fetch_sub (1);
+  return false;
+}
+
+void WorkStealingPool::wakeWorkers() noexcept
+{
+  for (auto& worker : workers)
+	worker->wake.signal();
+}
+
+void WorkStealingPool::waitUntilIdle() const
+{
+  while (numPending.load() > 0)
+	juce::Thread::sleep (1);
+}
+
+WorkStealingPool::Job* WorkStealingPool::takeJob (int worker) noexcept
+{
+  if (auto* job = workers[(size_t) worker]->popBack())
+	return job;
+
+  // start with the next worker along, so the thieves don't all pile on the first
+  for (int i = 1; i < getNumWorkers(); ++i)
+	if (auto* job = workers[(size_t) ((worker + i) % getNumWorkers())]->popFront())
+	  {
+		numStolen.fetch_add (1);
+		return job;
+	  }
+
+  return nullptr;
+}
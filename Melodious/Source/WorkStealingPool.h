@@ -0,0 +1,55 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+//==============================================================================
+/*
+  A fixed set of worker threads, each with a deque of jobs of its own. A
+  worker runs its own jobs newest first, while their data is still in its
+  cache, and when it runs out it steals the oldest job from another worker's
+  deque, so one worker stuck on an expensive job doesn't hold up the rest
+  of the jobs queued behind it.
+
+  Jobs aren't owned or copied: queueing one only stores its address, so the
+  queue never allocates once it's built. Each deque is a ring of fixed size
+  behind a SpinLock, held only for the few instructions of a push or a pop.
+*/
+class WorkStealingPool
+{
+public:
+  class Job
+  {
+  public:
+	virtual ~Job() = default;
+	// On one of the workers
+	virtual void runJob() noexcept = 0;
+  };
+
+  WorkStealingPool (int numWorkers, int maxJobsPerWorker, int threadPriority = 8);
+  ~WorkStealingPool();
+
+  int getNumWorkers() const noexcept                 { return (int) workers.size(); }
+
+  // Any thread. Queues the job for a worker, without waking it; false if
+  // that worker's deque is full
+  bool addJob (Job&, int worker) noexcept;
+  // Wakes every worker, to run its own jobs or steal someone else's
+  void wakeWorkers() noexcept;
+  // Blocks until every job queued has run
+  void waitUntilIdle() const;
+
+  // Since the pool was built
+  juce::int64 getNumJobsRun() const noexcept         { return numRun.load(); }
+  juce::int64 getNumJobsStolen() const noexcept      { return numStolen.load(); }
+
+private:
+  class Worker;
+
+  Job* takeJob (int worker) noexcept;
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  std::atomic<int> numPending { 0 };          // queued or running
+  std::atomic<juce::int64> numRun { 0 }, numStolen { 0 };
+
+  JUCE_DECLARE_NON_COPYABLE (WorkStealingPool)
+};
@@ -0,0 +1,243 @@
+/*
+  ==============================================================================
+
+    Classroom server: one engine per student, all rendered on a
+    work-stealing pool against real-time block deadlines, with each
+    student's MIDI coming in over a loopback socket.
+
+      melodious-server [--students=16] [--threads=<cores>] [--block=256]
+                       [--rate=48000] [--seconds=10] [--verbose]
+
+    Scripted students connect and play along as OfflineRenderer's do, and
+    the report says how close the blocks came to their deadlines and how
+    many sessions each core carries. --find-capacity doubles the class until
+    more than --max-late percent of blocks (0.1 by default) come in late,
+    then narrows down on the largest class that kept up:
+
+      melodious-server --find-capacity [--threads=4] [--block=128] [--seconds=5]
+
+    --external leaves the seats to real clients instead: juce
+    InterprocessConnections to --port on 127.0.0.1, sending raw MIDI bytes.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "ClassroomServer.h"
+#include "EngineLog.h"
+#include "OfflineRenderer.h"
+#include <algorithm>
+#include <iostream>
+
+// A student at the other end of the loopback socket; it only ever sends
+class StudentClient : public juce::InterprocessConnection
+{
+public:
+  StudentClient() : juce::InterprocessConnection (false) {}
+  ~StudentClient() override    { disconnect(); }
+
+private:
+  void connectionMade() override {}
+  void connectionLost() override {}
+  void messageReceived (const juce::MemoryBlock&) override {}
+};
+
+//==============================================================================
+// Plays every student's part in real time from a thread of its own: the
+// default script on the listening loops, each student a little later than
+// the one before so their notes don't all land in the same block.
+class ScriptedClass : private juce::Thread
+{
+public:
+  ScriptedClass (std::vector<std::unique_ptr<StudentClient>>& c, const ClassroomServer::Settings& settings,
+				 double seconds)
+	: juce::Thread ("Scripted class"), clients (c)
+  {
+	Transport transport;
+	transport.requestSettings (settings.transport);
+	transport.prepare (settings.sampleRate);
+
+	const auto samplesPerLoop = transport.getSamplesPerLoop();
+	const auto script = OfflineRenderer::createDefaultScript (samplesPerLoop);
+	const auto numLoops = (int) (seconds * settings.sampleRate / samplesPerLoop) + 1;
+
+	for (size_t student = 0; student < clients.size(); ++student)
+	  for (int loop = 1; loop < numLoops; loop += 2)
+		for (auto& note : script)
+		  {
+			const auto start = loop * samplesPerLoop + note.startInLoop + (int) (student * 53 % 2000);
+			events.push_back ({ start / settings.sampleRate, student,
+								juce::MidiMessage::noteOn (1, note.noteNumber, 0.8f) });
+			events.push_back ({ (start + note.lengthInLoop) / settings.sampleRate, student,
+								juce::MidiMessage::noteOff (1, note.noteNumber) });
+		  }
+
+	std::sort (events.begin(), events.end(),
+			   [] (const Event& a, const Event& b) { return a.time < b.time; });
+  }
+
+  ~ScriptedClass() override    { stopThread (2000); }
+
+  // From the moment the server starts playing
+  void begin()                 { startThread (8); }
+
+private:
+  struct Event
+  {
+	double time;
+	size_t student;
+	juce::MidiMessage message;
+  };
+
+  void run() override
+  {
+	const auto start = juce::Time::getMillisecondCounterHiRes();
+
+	for (auto& event : events)
+	  {
+		while (juce::Time::getMillisecondCounterHiRes() - start < event.time * 1000.0)
+		  {
+			if (threadShouldExit())
+			  return;
+
+			juce::Thread::sleep (1);
+		  }
+
+		clients[event.student]->sendMessage (juce::MemoryBlock (event.message.getRawData(),
+																(size_t) event.message.getRawDataSize()));
+	  }
+  }
+
+  std::vector<std::unique_ptr<StudentClient>>& clients;
+  std::vector<Event> events;
+};
+
+//==============================================================================
+static bool runClass (ClassroomServer::Settings settings, double seconds, bool external,
+					  ClassroomServer::Report& report)
+{
+  ClassroomServer server;
+  juce::String error;
+
+  if (! server.start (settings, error))
+	{
+	  std::cerr << error << "\n";
+	  return false;
+	}
+
+  std::vector<std::unique_ptr<StudentClient>> clients;
+
+  if (external)
+	{
+	  std::cout << "Waiting for " << settings.numStudents << " students on port " << server.getPort() << "\n";
+	  server.waitForStudents (settings.numStudents, 60000);
+	}
+  else
+	{
+	  for (int i = 0; i < settings.numStudents; ++i)
+		{
+		  clients.push_back (std::make_unique<StudentClient>());
+
+		  if (! clients.back()->connectToSocket ("127.0.0.1", server.getPort(), 2000))
+			{
+			  std::cerr << "Student " << i + 1 << " couldn't connect to port " << server.getPort() << "\n";
+			  return false;
+			}
+		}
+
+	  server.waitForStudents (settings.numStudents, 5000);
+	}
+
+  ScriptedClass scriptedClass (clients, settings, seconds);
+
+  if (! external)
+	scriptedClass.begin();
+
+  report = server.play (seconds);
+  return true;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  ClassroomServer::Settings settings;
+  auto seconds = 10.0;
+  auto maxLatePercent = 0.1;
+
+  if (args.containsOption ("--students"))  settings.numStudents = juce::jmax (1, args.getValueForOption ("--students").getIntValue());
+  if (args.containsOption ("--threads"))   settings.numThreads = juce::jmax (1, args.getValueForOption ("--threads").getIntValue());
+  if (args.containsOption ("--block"))     settings.blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+  if (args.containsOption ("--rate"))      settings.sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+  if (args.containsOption ("--port"))      settings.port = args.getValueForOption ("--port").getIntValue();
+  if (args.containsOption ("--seconds"))   seconds = juce::jmax (1.0, args.getValueForOption ("--seconds").getDoubleValue());
+  if (args.containsOption ("--max-late"))  maxLatePercent = args.getValueForOption ("--max-late").getDoubleValue();
+
+  const auto external = args.containsOption ("--external");
+
+  // every student's scores would bury the report
+  if (! args.containsOption ("--verbose"))
+	EngineLog::setMinimumLevel (EngineLog::Level::warning);
+
+  std::cout << "\nClassroom server, " << settings.numThreads << " worker threads on "
+			<< juce::SystemStats::getNumCpus() << " cores, " << settings.blockSize << "-sample blocks at "
+			<< juce::String (settings.sampleRate, 0) << " Hz\n";
+  std::cout << ClassroomServer::formatReportHeader() << "\n";
+
+  ClassroomServer::Report report;
+
+  if (! args.containsOption ("--find-capacity"))
+	{
+	  if (! runClass (settings, seconds, external, report))
+		return 1;
+
+	  std::cout << ClassroomServer::formatReport (report) << "\n";
+	  std::cout << "\n" << report.numConnected << " students connected, " << report.numMidiMessages
+				<< " MIDI messages in, " << juce::String (100.0 * report.getLateFraction(), 2)
+				<< "% of blocks late\n";
+	  return report.numLate > 0 ? 2 : 0;
+	}
+
+  // a class keeps up if no more than maxLatePercent of its blocks came in late
+  auto keepsUp = [&] (int numStudents)
+	{
+	  settings.numStudents = numStudents;
+
+	  if (! runClass (settings, seconds, false, report))
+		return false;
+
+	  std::cout << ClassroomServer::formatReport (report) << "\n";
+	  return 100.0 * report.getLateFraction() <= maxLatePercent;
+	};
+
+  auto largestKeptUp = 0, smallestFellBehind = settings.numThreads;
+  ClassroomServer::Report keptUpReport;   // from the largest class that kept up
+
+  while (keepsUp (smallestFellBehind))
+	{
+	  largestKeptUp = smallestFellBehind;
+	  keptUpReport = report;
+	  smallestFellBehind *= 2;
+	}
+
+  // to within a sixteenth of the class
+  while (smallestFellBehind - largestKeptUp > juce::jmax (1, largestKeptUp / 16))
+	{
+	  const auto middle = (largestKeptUp + smallestFellBehind) / 2;
+
+	  if (keepsUp (middle))
+		{
+		  largestKeptUp = middle;
+		  keptUpReport = report;
+		}
+	  else
+		{
+		  smallestFellBehind = middle;
+		}
+	}
+
+  std::cout << "\n" << largestKeptUp << " students kept up on " << settings.numThreads << " threads at "
+			<< settings.blockSize << "-sample blocks: "
+			<< juce::String (keptUpReport.sessionsPerCore, 1) << " sessions per core\n";
+  return 0;
+}
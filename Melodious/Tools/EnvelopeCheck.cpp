@@ -0,0 +1,185 @@
+/*
+  ==============================================================================
+
+    Envelope check: plays notes through AdsrEnvelope at 44.1, 48 and 96kHz,
+    in blocks of random sizes, and exits with 1 if a release doesn't take
+    the number of samples its milliseconds come to, or if the gain at any
+    moment differs between sample rates.
+
+      melodious-envelope-check [--verbose]
+
+    Each rate's gains are compared with the 96kHz ones at the same time,
+    read between samples where it falls between them.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "AdsrEnvelope.h"
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  const double sampleRates[] = { 44100.0, 48000.0, 96000.0 };
+  constexpr int numSampleRates = 3;
+
+  // A stage's length is rounded to whole samples, which moves its end by up
+  // to half a sample at 44.1kHz; a release scaled to the wrong rate would
+  // be out by a large fraction of the whole range.
+  constexpr float tolerance = 0.01f;
+
+  struct Case
+  {
+	const char* name;
+	AdsrEnvelope::Parameters parameters;
+	float noteOffMs;
+	int releaseSamples[numSampleRates];   // by hand, at each of sampleRates
+  };
+
+  std::vector<Case> createCases()
+  {
+	AdsrEnvelope::Parameters slow;
+	slow.attackMs = 10.0f;
+	slow.decayMs = 50.0f;
+	slow.sustainLevel = 0.5f;
+	slow.releaseMs = 200.0f;
+
+	auto slowLinear = slow;
+	slowLinear.curve = AdsrEnvelope::Curve::linear;
+
+	AdsrEnvelope::Parameters defaultLinear;
+	defaultLinear.curve = AdsrEnvelope::Curve::linear;
+
+	return {
+	  { "default, released while held",      {},            200.0f, { 662, 720, 1440 } },
+	  { "default, released in the attack",   {},            1.0f,   { 662, 720, 1440 } },
+	  { "default, released in the decay",    {},            30.0f,  { 662, 720, 1440 } },
+	  { "default made linear",               defaultLinear, 200.0f, { 662, 720, 1440 } },
+	  { "slow, exponential",                 slow,          150.0f, { 8820, 9600, 19200 } },
+	  { "slow, linear",                      slowLinear,    150.0f, { 8820, 9600, 19200 } }
+	};
+  }
+
+  int millisecondsToSamples (float milliseconds, double sampleRate)
+  {
+	return juce::roundToInt (milliseconds * 0.001 * sampleRate);
+  }
+
+  // Every gain from the note on to the end of its release, in blocks of 1 to
+  // maxBlockSize samples, with the note released on a block boundary
+  std::vector<float> render (const Case& c, double sampleRate, juce::Random& random)
+  {
+	AdsrEnvelope envelope;
+	envelope.setParameters (c.parameters);
+	envelope.setSampleRate (sampleRate);
+	envelope.noteOn();
+
+	const auto noteOffSample = millisecondsToSamples (c.noteOffMs, sampleRate);
+	const auto maxLength = noteOffSample + millisecondsToSamples (c.parameters.releaseMs + 100.0f, sampleRate);
+	std::vector<float> gains;
+
+	while (envelope.isActive() && (int) gains.size() < maxLength)
+	  {
+		const auto position = (int) gains.size();
+
+		if (position == noteOffSample)
+		  envelope.noteOff();
+
+		auto blockSize = 1 + random.nextInt (AdsrEnvelope::maxBlockSize);
+
+		if (position < noteOffSample)
+		  blockSize = juce::jmin (blockSize, noteOffSample - position);
+
+		gains.resize ((size_t) (position + blockSize));
+		gains.resize ((size_t) (position + envelope.getNextGains (gains.data() + position, blockSize)));
+	  }
+
+	return gains;
+  }
+
+  juce::String check (const Case& c, juce::Random& random, float& maxDifference)
+  {
+	juce::String problems;
+	std::vector<float> gains[numSampleRates];
+
+	for (int i = 0; i < numSampleRates; ++i)
+	  {
+		gains[i] = render (c, sampleRates[i], random);
+
+		const auto releaseSamples = (int) gains[i].size() - millisecondsToSamples (c.noteOffMs, sampleRates[i]);
+
+		if (releaseSamples != c.releaseSamples[i])
+		  problems << "the release took " << releaseSamples << " samples at " << sampleRates[i] / 1000.0
+				   << "kHz, not " << c.releaseSamples[i] << "; ";
+	  }
+
+	const auto& reference = gains[numSampleRates - 1];
+	const auto referenceRate = sampleRates[numSampleRates - 1];
+
+	for (int i = 0; i < numSampleRates - 1; ++i)
+	  {
+		auto worst = 0.0f;
+		auto worstSample = 0;
+
+		for (size_t n = 0; n < gains[i].size(); ++n)
+		  {
+			const auto position = (double) n * referenceRate / sampleRates[i];
+			const auto index = (size_t) position;
+
+			if (index + 1 >= reference.size())
+			  break;
+
+			const auto fraction = (float) (position - (double) index);
+			const auto expected = reference[index] + fraction * (reference[index + 1] - reference[index]);
+			const auto difference = std::abs (gains[i][n] - expected);
+
+			if (difference > worst)
+			  {
+				worst = difference;
+				worstSample = (int) n;
+			  }
+		  }
+
+		maxDifference = juce::jmax (maxDifference, worst);
+
+		if (worst > tolerance)
+		  problems << "at " << sampleRates[i] / 1000.0 << "kHz the gain is out by " << worst
+				   << " at sample " << worstSample << "; ";
+	  }
+
+	return problems;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+  const auto verbose = args.containsOption ("--verbose");
+
+  juce::Random random (1);
+  auto numFailed = 0;
+  auto maxDifference = 0.0f;
+  const auto cases = createCases();
+
+  std::cout << "\nAdsrEnvelope at 44.1, 48 and 96kHz, " << cases.size() << " notes\n";
+
+  for (auto& c : cases)
+	{
+	  const auto problems = check (c, random, maxDifference);
+
+	  if (problems.isNotEmpty())
+		{
+		  ++numFailed;
+		  std::cout << "  FAIL  " << c.name << ": " << problems.trimCharactersAtEnd ("; ") << "\n";
+		}
+	  else if (verbose)
+		{
+		  std::cout << "  ok    " << c.name << "\n";
+		}
+	}
+
+  std::cout << "  largest difference between rates " << maxDifference << "\n";
+  std::cout << (numFailed == 0 ? "  all passed\n" : "  " + std::to_string (numFailed) + " failed\n");
+  return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,198 @@
+/*
+  ==============================================================================
+
+    Converts between Standard MIDI Files and Melodious phrase libraries (.mphl).
+
+      melodious-phrases import <in.mid> <out.mphl> [--samples-per-loop=220500]
+      melodious-phrases export <in.mphl> <out.mid>
+      melodious-phrases info <in.mphl>
+
+    Each MIDI track becomes one phrase, one loop long. The old phrases file
+    stored sample positions at 44.1 kHz with five-second loops as its ticks;
+    --samples-per-loop tells the importer how to scale files like that. Files
+    with a tempo-based time format are rescaled from their own resolution.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PhraseLibrary.h"
+#include <iostream>
+
+static std::vector<PhraseLibrary::PhraseData> importMidiFile (const juce::MidiFile& midiFile,
+															  double samplesPerLoop)
+{
+  const auto loopLength = PhraseLibrary::defaultLoopLengthInTicks;
+  const auto timeFormat = midiFile.getTimeFormat();
+
+  // tempo-based files are rescaled to our resolution; anything else holds
+  // sample positions, which are scaled so one loop maps onto loopLength
+  const auto ticksPerSourceUnit = timeFormat > 0
+	? (double) PhraseLibrary::defaultTicksPerQuarterNote / (double) timeFormat
+	: (double) loopLength / samplesPerLoop;
+
+  std::vector<PhraseLibrary::PhraseData> phrases;
+
+  for (int i = 0; i < midiFile.getNumTracks(); ++i)
+	{
+	  juce::MidiMessageSequence track (*midiFile.getTrack (i));
+	  track.updateMatchedPairs();
+
+	  PhraseLibrary::PhraseData phrase { loopLength, {} };
+
+	  for (auto* event : track)
+		{
+		  if (! event->message.isNoteOn())
+			continue;
+
+		  const auto start = juce::roundToInt (event->message.getTimeStamp() * ticksPerSourceUnit);
+		  auto end = start;
+
+		  // the old file ends notes one sample before the next one starts
+		  if (event->noteOffObject != nullptr)
+			end = juce::roundToInt ((event->noteOffObject->message.getTimeStamp() + (timeFormat > 0 ? 0 : 1))
+									* ticksPerSourceUnit);
+
+		  phrase.notes.push_back ({ (juce::uint32) start, (juce::uint32) juce::jmax (1, end - start),
+									(juce::uint8) event->message.getNoteNumber(),
+									event->message.getVelocity(),
+									(juce::uint8) event->message.getChannel(), 0 });
+
+		  phrase.lengthInTicks = juce::jmax (phrase.lengthInTicks, (juce::uint32) juce::jmax (start, end));
+		}
+
+	  if (phrase.notes.empty())
+		continue;
+
+	  // round the phrase up to whole loops
+	  phrase.lengthInTicks = ((phrase.lengthInTicks + loopLength - 1) / loopLength) * loopLength;
+	  phrases.push_back (std::move (phrase));
+	}
+
+  return phrases;
+}
+
+static juce::MidiFile exportMidiFile (const PhraseLibrary& library)
+{
+  juce::MidiFile midiFile;
+  midiFile.setTicksPerQuarterNote ((int) library.getTicksPerQuarterNote());
+
+  for (int i = 0; i < library.getNumPhrases(); ++i)
+	{
+	  const auto phrase = library.getPhrase (i);
+	  juce::MidiMessageSequence track;
+
+	  for (int n = 0; n < phrase.numNotes; ++n)
+		{
+		  const auto& note = phrase.notes[n];
+		  const auto channel = juce::jlimit (1, 16, (int) note.channel);
+
+		  track.addEvent (juce::MidiMessage::noteOn (channel, note.noteNumber, (juce::uint8) note.velocity)
+						  .withTimeStamp (note.startTick));
+		  track.addEvent (juce::MidiMessage::noteOff (channel, note.noteNumber)
+						  .withTimeStamp (note.startTick + note.lengthInTicks));
+		}
+
+	  track.sort();
+	  midiFile.addTrack (track);
+	}
+
+  return midiFile;
+}
+
+static int printUsage()
+{
+  std::cout << "usage: melodious-phrases import <in.mid> <out.mphl> [--samples-per-loop=220500]\n"
+			<< "       melodious-phrases export <in.mphl> <out.mid>\n"
+			<< "       melodious-phrases info <in.mphl>\n";
+  return 1;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  if (args.size() < 2)
+	return printUsage();
+
+  const auto command = args[0].text;
+  const auto source = args[1].resolveAsFile();
+
+  if (command == "info")
+	{
+	  PhraseLibrary library;
+
+	  if (! library.open (source))
+		{
+		  std::cout << "ERROR: " << source.getFullPathName() << " is not a valid phrase library\n";
+		  return 1;
+		}
+
+	  int numNotes = 0;
+
+	  for (int i = 0; i < library.getNumPhrases(); ++i)
+		numNotes += library.getPhrase (i).numNotes;
+
+	  std::cout << library.getNumPhrases() << " phrases, " << numNotes << " notes, "
+				<< (int) library.getTicksPerQuarterNote() << " ticks per quarter note\n";
+	  return 0;
+	}
+
+  if (args.size() < 3)
+	return printUsage();
+
+  const auto destination = args[2].resolveAsFile();
+
+  if (command == "import")
+	{
+	  juce::FileInputStream input (source);
+	  juce::MidiFile midiFile;
+
+	  if (! input.openedOk() || ! midiFile.readFrom (input))
+		{
+		  std::cout << "ERROR: Could not read MIDI file " << source.getFullPathName() << "\n";
+		  return 1;
+		}
+
+	  auto samplesPerLoop = 220500.0;
+
+	  if (args.containsOption ("--samples-per-loop"))
+		samplesPerLoop = juce::jmax (1.0, args.getValueForOption ("--samples-per-loop").getDoubleValue());
+
+	  const auto phrases = importMidiFile (midiFile, samplesPerLoop);
+
+	  if (! PhraseLibrary::writeToFile (destination, phrases))
+		{
+		  std::cout << "ERROR: Could not write " << destination.getFullPathName() << "\n";
+		  return 1;
+		}
+
+	  std::cout << "Wrote " << (int) phrases.size() << " phrases to " << destination.getFullPathName() << "\n";
+	  return 0;
+	}
+
+  if (command == "export")
+	{
+	  PhraseLibrary library;
+
+	  if (! library.open (source))
+		{
+		  std::cout << "ERROR: " << source.getFullPathName() << " is not a valid phrase library\n";
+		  return 1;
+		}
+
+	  destination.deleteFile();
+	  juce::FileOutputStream output (destination);
+
+	  if (! output.openedOk() || ! exportMidiFile (library).writeTo (output))
+		{
+		  std::cout << "ERROR: Could not write " << destination.getFullPathName() << "\n";
+		  return 1;
+		}
+
+	  std::cout << "Wrote " << library.getNumPhrases() << " phrases to " << destination.getFullPathName() << "\n";
+	  return 0;
+	}
+
+  return printUsage();
+}
@@ -0,0 +1,166 @@
+/*
+  ==============================================================================
+
+    Runs the pitch tracker over recorded audio, as the looper would over its
+    input, and prints the notes it hears and what it cost. Without a file it
+    makes up a test melody from low E on a guitar to the top of a soprano's
+    range and checks the tracker finds every note.
+
+      melodious-pitch [file.wav ...] [--block=128] [--channel=0]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PitchTracker.h"
+#include <iostream>
+
+struct TrackedRun
+{
+  std::vector<PitchTracker::NoteEvent> events;
+  double seconds = 0.0, budgetSeconds = 0.0, worstBlockSeconds = 0.0;
+  int numBlocks = 0;
+};
+
+static TrackedRun track (const float* samples, int numSamples, double sampleRate, int blockSize)
+{
+  PitchTracker tracker;
+  tracker.prepare (sampleRate);
+
+  TrackedRun run;
+  PitchTracker::NoteEvent events[32];
+
+  for (int start = 0; start + blockSize <= numSamples; start += blockSize)
+	{
+	  const auto startTicks = juce::Time::getHighResolutionTicks();
+	  const auto numEvents = tracker.processBlock (samples + start, blockSize, start, events,
+												   juce::numElementsInArray (events));
+	  const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+	  run.seconds += seconds;
+	  run.worstBlockSeconds = juce::jmax (run.worstBlockSeconds, seconds);
+	  ++run.numBlocks;
+	  run.events.insert (run.events.end(), events, events + numEvents);
+	}
+
+  run.budgetSeconds = run.numBlocks * blockSize / sampleRate;
+  return run;
+}
+
+static void printCost (const TrackedRun& run, int blockSize)
+{
+  std::cout << "  " << run.numBlocks << " blocks of " << blockSize << ": "
+			<< juce::String (run.seconds / juce::jmax (1, run.numBlocks) * 1.0e6, 2) << " us mean, "
+			<< juce::String (run.worstBlockSeconds * 1.0e6, 2) << " us worst, "
+			<< juce::String (run.seconds / juce::jmax (1.0e-9, run.budgetSeconds) * 100.0, 2) << "% of real time\n";
+}
+
+// Notes of a buzzy tone with a soft attack, a gap of near silence after each
+static int testMelody (double sampleRate, int blockSize)
+{
+  std::vector<int> notes;
+  for (int note = 40; note <= 88; note += 3)
+	notes.push_back (note);
+
+  const auto noteLength = (int) (0.3 * sampleRate), gapLength = (int) (0.1 * sampleRate);
+  juce::AudioBuffer<float> audio (1, (int) notes.size() * (noteLength + gapLength));
+  juce::Random random (1);
+  auto phase = 0.0;
+  auto* samples = audio.getWritePointer (0);
+
+  for (size_t i = 0; i < notes.size(); ++i)
+	{
+	  const auto frequency = juce::MidiMessage::getMidiNoteInHertz (notes[i]);
+	  auto* note = samples + i * (size_t) (noteLength + gapLength);
+
+	  for (int s = 0; s < noteLength + gapLength; ++s)
+		{
+		  auto tone = 0.0;
+		  phase += frequency / sampleRate;
+
+		  for (int harmonic = 1; harmonic <= 8 && s < noteLength; ++harmonic)
+			tone += std::sin (juce::MathConstants<double>::twoPi * phase * harmonic) / harmonic;
+
+		  const auto attack = juce::jmin (1.0, s / 200.0);
+		  note[s] = (float) (0.3 * attack * tone) + 0.01f * (random.nextFloat() * 2.0f - 1.0f);
+		}
+	}
+
+  const auto run = track (samples, audio.getNumSamples(), sampleRate, blockSize);
+  auto numRight = 0, numOnsets = 0;
+  auto onsetError = 0.0;
+
+  for (auto& event : run.events)
+	{
+	  if (! event.isNoteOn)
+		continue;
+
+	  ++numOnsets;
+	  const auto index = (size_t) (event.samplePosition + noteLength / 2) / (size_t) (noteLength + gapLength);
+
+	  if (index < notes.size() && notes[index] == event.noteNumber)
+		{
+		  ++numRight;
+		  onsetError += (event.samplePosition - (juce::int64) index * (noteLength + gapLength)) / sampleRate;
+		}
+	}
+
+  std::cout << "\nTest melody at " << sampleRate << " Hz: " << numRight << " of " << notes.size()
+			<< " notes found, " << (numOnsets - numRight) << " wrong or extra, mean onset "
+			<< juce::String (onsetError / juce::jmax (1, numRight) * 1000.0, 1) << " ms late\n";
+  printCost (run, blockSize);
+
+  return numRight == (int) notes.size() && numOnsets == numRight ? 0 : 1;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  auto blockSize = 128;
+  auto channel = 0;
+
+  if (args.containsOption ("--block"))   blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+  if (args.containsOption ("--channel")) channel = juce::jmax (0, args.getValueForOption ("--channel").getIntValue());
+
+  juce::Array<juce::File> files;
+
+  for (auto& arg : args.arguments)
+	if (! arg.isOption())
+	  files.add (arg.resolveAsFile());
+
+  if (files.isEmpty())
+	return testMelody (48000.0, blockSize);
+
+  juce::AudioFormatManager formats;
+  formats.registerBasicFormats();
+
+  for (auto& file : files)
+	{
+	  std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+
+	  if (reader == nullptr)
+		{
+		  std::cout << "ERROR: can't read " << file.getFullPathName() << "\n";
+		  return 1;
+		}
+
+	  juce::AudioBuffer<float> audio ((int) reader->numChannels, (int) reader->lengthInSamples);
+	  reader->read (&audio, 0, audio.getNumSamples(), 0, true, true);
+
+	  const auto run = track (audio.getReadPointer (juce::jmin (channel, audio.getNumChannels() - 1)),
+							  audio.getNumSamples(), reader->sampleRate, blockSize);
+
+	  std::cout << "\n" << file.getFileName() << ", " << reader->sampleRate << " Hz\n";
+
+	  for (auto& event : run.events)
+		std::cout << "  " << juce::String (event.samplePosition / reader->sampleRate, 3).paddedLeft (' ', 9) << " s  "
+				  << (event.isNoteOn ? "on  " : "off ")
+				  << juce::MidiMessage::getMidiNoteName (event.noteNumber, true, true, 3)
+				  << (event.isNoteOn ? "  velocity " + juce::String (event.velocity) : juce::String()) << "\n";
+
+	  printCost (run, blockSize);
+	}
+
+  return 0;
+}
@@ -0,0 +1,74 @@
+/*
+  ==============================================================================
+
+    Headless real-time-factor benchmark for LooperAudioSource.
+
+    Renders a number of loops through the engine at several block sizes and
+    sample rates, without opening an audio device, and prints how much of each
+    block's time budget the engine used.
+
+      melodious-bench [--loops=8] [--blocks=64,128,256,512] [--rates=44100,48000,96000]
+                      [--waveform=sine|saw|square|piano] [--bpm=96]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "ToolArguments.h"
+#include <iostream>
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  auto numLoops = 8;
+  juce::Array<int> blockSizes { 64, 128, 256, 512 };
+  juce::Array<int> sampleRates { 44100, 48000, 96000 };
+  auto waveform = WavetableBank::Waveform::sine;
+  Transport::Settings transport;
+
+  if (args.containsOption ("--loops"))
+	numLoops = juce::jmax (2, args.getValueForOption ("--loops").getIntValue());
+
+  if (args.containsOption ("--blocks"))
+	blockSizes = parseIntList (args.getValueForOption ("--blocks"));
+
+  if (args.containsOption ("--rates"))
+	sampleRates = parseIntList (args.getValueForOption ("--rates"));
+
+  if (args.containsOption ("--bpm"))
+	transport.bpm = args.getValueForOption ("--bpm").getDoubleValue();
+
+  if (args.containsOption ("--waveform")
+	  && ! WavetableBank::parseWaveform (args.getValueForOption ("--waveform"), waveform))
+	{
+	  std::cout << "ERROR: unknown waveform " << args.getValueForOption ("--waveform") << "\n";
+	  return 1;
+	}
+
+  std::vector<OfflineRenderer::Report> reports;
+
+  for (auto sampleRate : sampleRates)
+	for (auto blockSize : blockSizes)
+	  {
+		OfflineRenderer::Settings settings;
+		settings.sampleRate = sampleRate;
+		settings.blockSize = blockSize;
+		settings.numLoops = numLoops;
+		settings.waveform = waveform;
+		settings.transport = transport;
+
+		OfflineRenderer renderer;
+		reports.push_back (renderer.render (settings));
+	  }
+
+  std::cout << "\nLooperAudioSource offline render, " << numLoops << " loops per run, "
+			<< WavetableBank::getWaveformName (waveform) << " voices\n";
+  std::cout << OfflineRenderer::formatReportHeader() << "\n";
+
+  for (auto& report : reports)
+	std::cout << OfflineRenderer::formatReport (report) << "\n";
+
+  return 0;
+}
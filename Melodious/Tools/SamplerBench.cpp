@@ -0,0 +1,199 @@
+/*
+  ==============================================================================
+
+    Sampler streaming benchmark: holds a chord of sampled notes and renders
+    it a block at a time at a set pace, then reports what the preloaded
+    attacks cost in memory, what each block cost and how often the streaming
+    thread fell behind. Without an instrument it writes a synthetic one, long
+    WAV and FLAC notes, to a temporary folder.
+
+      melodious-sampler-bench [--instrument=piano.sfz] [--notes=16] [--seconds=10]
+                              [--speed=1] [--rate=48000] [--block=256]
+
+    --speed=4 renders four times as fast as real time, to show how much
+    headroom the disk and the streaming thread have; --speed=0 doesn't wait.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "SamplerVoice.h"
+#include "VoicePool.h"
+#include <iostream>
+
+// A decaying tone with a few harmonics, long enough that most of it streams
+static bool writeTone (const juce::File& file, juce::AudioFormat& format, double frequency,
+					   int numChannels, double sampleRate, double seconds)
+{
+  const auto numFrames = (int) (seconds * sampleRate);
+  juce::AudioBuffer<float> audio (numChannels, numFrames);
+
+  for (int channel = 0; channel < numChannels; ++channel)
+	{
+	  auto* samples = audio.getWritePointer (channel);
+
+	  for (int i = 0; i < numFrames; ++i)
+		{
+		  const auto t = i / sampleRate;
+		  const auto phase = juce::MathConstants<double>::twoPi * frequency * t + channel * 0.3;
+		  samples[i] = (float) (std::exp (-t * 0.4) * (0.5 * std::sin (phase) + 0.25 * std::sin (2.0 * phase)
+													   + 0.12 * std::sin (3.0 * phase)));
+		}
+	}
+
+  file.deleteFile();
+  std::unique_ptr<juce::FileOutputStream> stream (file.createOutputStream());
+
+  if (stream == nullptr)
+	return false;
+
+  std::unique_ptr<juce::AudioFormatWriter> writer (format.createWriterFor (stream.get(), sampleRate,
+																		   (unsigned int) numChannels, 16, {}, 0));
+  if (writer == nullptr)
+	return false;
+
+  stream.release();   // the writer owns it now
+  return writer->writeFromAudioSampleBuffer (audio, 0, numFrames);
+}
+
+// Three regions an octave and a half apart: stereo WAV, mono WAV and FLAC
+static juce::File writeSyntheticInstrument (const juce::File& folder, double sampleRate)
+{
+  folder.createDirectory();
+
+  juce::WavAudioFormat wav;
+  juce::FlacAudioFormat flac;
+  const auto seconds = 20.0;
+
+  if (! writeTone (folder.getChildFile ("low.wav"), wav, juce::MidiMessage::getMidiNoteInHertz (42), 2, sampleRate, seconds)
+	  || ! writeTone (folder.getChildFile ("mid.wav"), wav, juce::MidiMessage::getMidiNoteInHertz (60), 1, sampleRate, seconds)
+	  || ! writeTone (folder.getChildFile ("high.flac"), flac, juce::MidiMessage::getMidiNoteInHertz (78), 1, sampleRate, seconds))
+	return {};
+
+  auto mapping = folder.getChildFile ("synthetic.sfz");
+  mapping.replaceWithText ("// written by melodious-sampler-bench\n"
+						   "<group> ampeg_release=0.2\n"
+						   "<region> sample=low.wav lokey=24 hikey=50 pitch_keycenter=42\n"
+						   "<region> sample=mid.wav lokey=51 hikey=68 pitch_keycenter=c4\n"
+						   "<region> sample=high.flac lokey=69 hikey=108 pitch_keycenter=78\n");
+  return mapping;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  auto numNotes = 16;
+  auto seconds = 10.0;
+  auto speed = 1.0;
+  auto sampleRate = 48000.0;
+  auto blockSize = 256;
+  juce::File instrumentFile;
+  const auto syntheticFolder = juce::File::getSpecialLocation (juce::File::tempDirectory)
+								 .getChildFile ("melodious-sampler-bench");
+
+  if (args.containsOption ("--notes"))      numNotes = juce::jlimit (1, 128, args.getValueForOption ("--notes").getIntValue());
+  if (args.containsOption ("--seconds"))    seconds = juce::jmax (0.1, args.getValueForOption ("--seconds").getDoubleValue());
+  if (args.containsOption ("--speed"))      speed = juce::jmax (0.0, args.getValueForOption ("--speed").getDoubleValue());
+  if (args.containsOption ("--rate"))       sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+  if (args.containsOption ("--block"))      blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+  if (args.containsOption ("--instrument")) instrumentFile = args.getFileForOption ("--instrument");
+
+  if (instrumentFile == juce::File())
+	{
+	  instrumentFile = writeSyntheticInstrument (syntheticFolder, sampleRate);
+
+	  if (instrumentFile == juce::File())
+		{
+		  std::cerr << "could not write the synthetic instrument\n";
+		  return 1;
+		}
+	}
+
+  SampleLibrary library;
+  juce::String error;
+  const auto loadTicks = juce::Time::getHighResolutionTicks();
+  const auto loaded = library.load (instrumentFile, error);
+  const auto loadMs = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - loadTicks) * 1000.0;
+
+  if (error.isNotEmpty())
+	std::cerr << error << "\n";
+
+  if (! loaded)
+	return 1;
+
+  auto numMapped = 0;
+  auto lowestKey = 127, highestKey = 0;
+
+  for (int i = 0; i < library.getNumRegions(); ++i)
+	{
+	  const auto& region = library.getRegion (i);
+	  numMapped += region.memoryMapped ? 1 : 0;
+	  lowestKey = juce::jmin (lowestKey, region.lowKey);
+	  highestKey = juce::jmax (highestKey, region.highKey);
+	}
+
+  std::cout << "\nInstrument " << library.getName() << ": " << library.getNumRegions() << " regions ("
+			<< numMapped << " memory-mapped), loaded in " << juce::String (loadMs, 1) << " ms\n"
+			<< "  preloaded attacks: " << juce::String (library.getPreloadBytes() / 1024.0, 1) << " KB\n"
+			<< "  left on disk:      " << juce::String (library.getStreamedBytes() / 1024.0, 1) << " KB\n";
+
+  SampleStreamer streamer;
+  VoicePool pool;
+  pool.allocateVoices (numNotes, [&streamer] { return new SamplerVoice (streamer); });
+
+  auto* sound = new SamplerSound();
+  sound->setLibrary (&library);
+  pool.addSound (sound);
+  pool.setCurrentPlaybackSampleRate (sampleRate);
+
+  juce::AudioBuffer<float> buffer (2, blockSize);
+  juce::MidiBuffer midi;
+
+  // spread over the instrument's keys, one per channel-and-key so none is retriggered
+  const auto numKeys = highestKey - lowestKey + 1;
+
+  for (int i = 0; i < numNotes; ++i)
+	midi.addEvent (juce::MidiMessage::noteOn (1 + i / numKeys, lowestKey + (i * 7) % numKeys, 0.8f), 0);
+
+  const auto numBlocks = juce::jmax (1, (int) (seconds * sampleRate / blockSize));
+  const auto blockMs = blockSize / sampleRate * 1000.0;
+  const auto startMs = juce::Time::getMillisecondCounterHiRes();
+  auto totalSeconds = 0.0, worstSeconds = 0.0;
+
+  for (int block = 0; block < numBlocks; ++block)
+	{
+	  if (speed > 0.0)
+		{
+		  const auto dueMs = startMs + block * blockMs / speed;
+		  const auto waitMs = (int) (dueMs - juce::Time::getMillisecondCounterHiRes());
+
+		  if (waitMs > 0)
+			juce::Thread::sleep (waitMs);
+		}
+
+	  const auto startTicks = juce::Time::getHighResolutionTicks();
+	  buffer.clear();
+	  pool.renderNextBlock (buffer, midi, 0, blockSize);
+	  midi.clear();
+
+	  const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+	  totalSeconds += elapsed;
+	  worstSeconds = juce::jmax (worstSeconds, elapsed);
+	}
+
+  const auto budgetSeconds = blockSize / sampleRate;
+
+  std::cout << numNotes << " notes, " << numBlocks << " blocks of " << blockSize << " at " << sampleRate << " Hz, "
+			<< (speed > 0.0 ? juce::String (speed, 1) + "x real time" : juce::String ("unpaced")) << "\n"
+			<< "  block cost:  " << juce::String (totalSeconds / numBlocks * 1.0e6, 2) << " us mean, "
+			<< juce::String (worstSeconds * 1.0e6, 2) << " us worst ("
+			<< juce::String (totalSeconds / numBlocks / budgetSeconds * 100.0, 2) << "% of the budget)\n"
+			<< "  still sounding: " << pool.getNumActiveVoices() << " voices\n"
+			<< "  underruns:   " << streamer.getNumUnderruns() << "\n";
+
+  if (! args.containsOption ("--instrument"))
+	syntheticFolder.deleteRecursively();
+
+  return 0;
+}
@@ -0,0 +1,103 @@
+/*
+  ==============================================================================
+
+    Scoring benchmark: the cost of scoring a whole listening loop against
+    dense polyphonic phrases, with the student playing about as many notes
+    as the phrase has. Each phrase is scored the way the audio thread does
+    it, a block at a time.
+
+      melodious-score-bench [--notes=4,64,256,512] [--loops=200]
+                            [--rate=48000] [--block=256]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "GuessScorer.h"
+#include "Transport.h"
+#include "ToolArguments.h"
+#include <iostream>
+
+// numNotes random notes over the loop, up to a bar long, on up to 16 channels
+// so the same key can sound in more than one voice
+static std::vector<Pattern::Event> createRandomNotes (juce::Random& random, int numNotes, int loopLength)
+{
+  std::vector<Pattern::Event> events;
+
+  for (int i = 0; i < numNotes; ++i)
+	{
+	  const auto start = random.nextInt (loopLength - 1);
+	  const auto end = juce::jmin (loopLength - 1, start + 1 + random.nextInt (4 * Pattern::ticksPerQuarterNote));
+	  const auto channel = (juce::uint8) (1 + i % 16);
+	  const auto note = (juce::uint8) (36 + random.nextInt (48));
+
+	  events.push_back ({ start, channel, note, 100, true });
+	  events.push_back ({ end, channel, note, 0, false });
+	}
+
+  return events;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  juce::Array<int> noteCounts { 4, 64, 256, 512 };
+  auto numLoops = 200;
+  auto sampleRate = 48000.0;
+  auto blockSize = 256;
+
+  if (args.containsOption ("--notes"))  noteCounts = parseIntList (args.getValueForOption ("--notes"));
+  if (args.containsOption ("--loops"))  numLoops = juce::jmax (1, args.getValueForOption ("--loops").getIntValue());
+  if (args.containsOption ("--rate"))   sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+  if (args.containsOption ("--block"))  blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+
+  Transport transport;
+  transport.prepare (sampleRate);
+
+  const auto loopLength = transport.getLoopLengthInTicks();
+  const auto ticksPerBlock = blockSize / transport.getSamplesPerTick();
+  juce::Random random (1);
+  GuessScorer scorer;
+
+  std::cout << "\nScoring a " << loopLength << "-tick loop in " << blockSize << "-sample blocks at "
+			<< sampleRate << " Hz, mean over " << numLoops << " loops\n"
+			<< "  notes   us per loop   worst us per block\n";
+
+  for (auto numNotes : noteCounts)
+	{
+	  const Pattern phrase ("Bench", loopLength, createRandomNotes (random, numNotes, loopLength));
+	  const auto target = GuessScorer::createTarget (phrase, loopLength);
+	  const Pattern guess ("Guess", loopLength, createRandomNotes (random, numNotes, loopLength));
+
+	  auto totalSeconds = 0.0, worstBlockSeconds = 0.0;
+
+	  for (int loop = 0; loop < numLoops; ++loop)
+		{
+		  const auto& events = guess.getEvents();
+		  size_t nextEvent = 0;
+		  scorer.begin (target);
+
+		  for (auto blockStart = 0.0; blockStart < loopLength; blockStart += ticksPerBlock)
+			{
+			  const auto start = juce::Time::getHighResolutionTicks();
+
+			  for (; nextEvent < events.size() && events[nextEvent].tick < blockStart + ticksPerBlock; ++nextEvent)
+				scorer.addEvent (events[nextEvent].tick, events[nextEvent].noteNumber,
+								 events[nextEvent].isNoteOn, events[nextEvent].velocity);
+
+			  scorer.advanceTo ((int) (blockStart + ticksPerBlock));
+
+			  const auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+			  totalSeconds += seconds;
+			  worstBlockSeconds = juce::jmax (worstBlockSeconds, seconds);
+			}
+		}
+
+	  std::cout << juce::String (numNotes).paddedLeft (' ', 7)
+				<< juce::String (totalSeconds * 1.0e6 / numLoops, 2).paddedLeft (' ', 14)
+				<< juce::String (worstBlockSeconds * 1.0e6, 2).paddedLeft (' ', 21) << "\n";
+	}
+
+  return 0;
+}
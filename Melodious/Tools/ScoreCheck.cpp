@@ -0,0 +1,245 @@
+/*
+  ==============================================================================
+
+    Scoring check: runs GuessScorer over a corpus of hand-labelled cases
+    (a phrase, what the student played, and which notes a teacher would
+    mark right) and exits with 1 if any verdict comes out differently.
+
+      melodious-score-check [--verbose]
+
+    The playing is fed in the way the audio thread feeds it, in short
+    steps, and every note also has to be scored in the step its end falls
+    in, not later.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "GuessScorer.h"
+#include <algorithm>
+#include <iostream>
+
+namespace
+{
+  constexpr int q = Pattern::ticksPerQuarterNote;
+  constexpr int loopLength = 8 * q;   // two bars of 4/4
+  constexpr int stepTicks = 64;       // about a 256-sample block at 96 BPM and 48kHz
+
+  enum Note { C3 = 48, C4 = 60, D4 = 62, E3 = 52, E4 = 64, F4 = 65, Fs4 = 66, G4 = 67, A4 = 69,
+			  C5 = 72, E5 = 76, F5 = 77, G5 = 79 };
+
+  struct TargetNote
+  {
+	int start, end, noteNumber;
+	bool right;        // the verdict by hand
+  };
+
+  struct Played
+  {
+	int start, end, noteNumber;
+  };
+
+  struct Case
+  {
+	const char* name;
+	std::vector<TargetNote> phrase;
+	std::vector<Played> playing;
+	int harmonyPercent;   // -1 leaves it unchecked
+  };
+
+  // A note is right when its pitch class, in any octave, sounds for more
+  // than 30% of it; harmony is the share of the phrase's time the set of
+  // pitch classes sounding matched it exactly.
+  std::vector<Case> createCorpus()
+  {
+	return {
+	  { "melody played exactly",
+		{ { 0, q, C4, true }, { q, 2 * q, E4, true }, { 2 * q, 3 * q, G4, true } },
+		{ { 0, q, C4 }, { q, 2 * q, E4 }, { 2 * q, 3 * q, G4 } }, 100 },
+
+	  { "nothing played",
+		{ { 0, q, C4, false }, { q, 2 * q, E4, false }, { 2 * q, 3 * q, G4, false } },
+		{}, 0 },
+
+	  { "every note a step off",
+		{ { 0, q, C4, false }, { q, 2 * q, E4, false }, { 2 * q, 3 * q, G4, false } },
+		{ { 0, q, D4 }, { q, 2 * q, F4 }, { 2 * q, 3 * q, A4 } }, 0 },
+
+	  { "right notes in other octaves",
+		{ { 0, q, C4, true }, { q, 2 * q, E4, true } },
+		{ { 0, q, C5 }, { q, 2 * q, E3 } }, 100 },
+
+	  { "late, but held for more than 30%",
+		{ { 0, q, C4, true } },
+		{ { 600, q, C4 } }, 0 },
+
+	  { "too late to count",
+		{ { 0, q, C4, false } },
+		{ { 700, q, C4 } }, -1 },
+
+	  { "exactly 30% isn't enough",
+		{ { 0, q, C4, false } },
+		{ { 672, q, C4 } }, -1 },
+
+	  { "a short stab",
+		{ { 0, q, C4, false } },
+		{ { 0, 200, C4 } }, -1 },
+
+	  { "two short taps add up",
+		{ { 0, q, C4, true } },
+		{ { 0, 200, C4 }, { 400, 600, C4 } }, -1 },
+
+	  { "taps in two octaves add up",
+		{ { 0, q, C4, true } },
+		{ { 0, 200, C3 }, { 300, 500, C5 } }, -1 },
+
+	  { "held on into the next beat",
+		{ { 0, q, C4, false } },
+		{ { 900, 3 * q, C4 } }, -1 },
+
+	  { "a repeated note held through",
+		{ { 0, q, C4, true }, { q, 2 * q, C4, true } },
+		{ { 0, 2 * q, C4 } }, 100 },
+
+	  { "an extra note doesn't cost the melody",
+		{ { 0, q, C4, true } },
+		{ { 0, q, C4 }, { 0, q, Fs4 } }, 0 },
+
+	  { "whole chord, any voicing",
+		{ { 0, 2 * q, C4, true }, { 0, 2 * q, E4, true }, { 0, 2 * q, G4, true } },
+		{ { 0, 2 * q, C3 }, { 0, 2 * q, E4 }, { 0, 2 * q, G5 } }, 100 },
+
+	  { "chord with the fifth missing",
+		{ { 0, 2 * q, C4, true }, { 0, 2 * q, E4, true }, { 0, 2 * q, G4, false } },
+		{ { 0, 2 * q, C4 }, { 0, 2 * q, E4 } }, 0 },
+
+	  { "two voices, the upper one slipping",
+		{ { 0, 2 * q, C4, true }, { 0, q, E5, true }, { q, 2 * q, F5, false } },
+		{ { 0, 2 * q, C4 }, { 0, q, E5 }, { q, 2 * q, G5 } }, 50 },
+
+	  { "chords changing on the beat",
+		{ { 0, q, C4, true }, { 0, q, E4, true }, { q, 2 * q, D4, true }, { q, 2 * q, F4, true } },
+		{ { 0, q, C4 }, { 0, q, E4 }, { q, 2 * q, D4 }, { q, 2 * q, F4 } }, 100 },
+	};
+  }
+
+  Pattern createPhrase (const Case& c)
+  {
+	std::vector<Pattern::Event> events;
+
+	for (auto& note : c.phrase)
+	  {
+		events.push_back ({ note.start, 1, (juce::uint8) note.noteNumber, 100, true });
+		events.push_back ({ note.end, 1, (juce::uint8) note.noteNumber, 0, false });
+	  }
+
+	return Pattern (c.name, loopLength, std::move (events));
+  }
+
+  struct PlayedEvent
+  {
+	int tick, noteNumber;
+	bool isNoteOn;
+  };
+
+  // Returns what went wrong, or an empty string
+  juce::String check (const Case& c, GuessScorer& scorer)
+  {
+	const auto target = GuessScorer::createTarget (createPhrase (c), loopLength);
+	scorer.begin (target);
+
+	std::vector<PlayedEvent> events;
+
+	for (auto& note : c.playing)
+	  {
+		events.push_back ({ note.start, note.noteNumber, true });
+		events.push_back ({ note.end, note.noteNumber, false });
+	  }
+
+	// at the same tick a key comes up before another goes down
+	std::stable_sort (events.begin(), events.end(), [] (const PlayedEvent& a, const PlayedEvent& b)
+					  { return a.tick != b.tick ? a.tick < b.tick : (! a.isNoteOn && b.isNoteOn); });
+
+	size_t nextEvent = 0;
+	int numScored = 0;
+	juce::String problems;
+
+	for (int stepEnd = stepTicks; stepEnd - stepTicks < loopLength; stepEnd += stepTicks)
+	  {
+		for (; nextEvent < events.size() && events[nextEvent].tick < stepEnd; ++nextEvent)
+		  scorer.addEvent (events[nextEvent].tick, events[nextEvent].noteNumber, events[nextEvent].isNoteOn, 100);
+
+		scorer.advanceTo (stepEnd);
+
+		// every note that ended in this step, and none still going
+		for (; numScored < scorer.getNumScored(); ++numScored)
+		  if (scorer.getScore (numScored).span.end <= stepEnd - stepTicks)
+			problems << "note " << numScored << " scored late; ";
+
+		for (auto& note : c.phrase)
+		  if (note.end <= stepEnd && note.end > stepEnd - stepTicks)
+			{
+			  auto found = false;
+
+			  for (int i = 0; i < scorer.getNumScored(); ++i)
+				found = found || (scorer.getScore (i).span.start == note.start
+								  && scorer.getScore (i).span.noteNumber == note.noteNumber);
+
+			  if (! found)
+				problems << "note at " << note.start << " not scored when it ended; ";
+			}
+	  }
+
+	if (! scorer.isFinished())
+	  problems << scorer.getNumScored() << " of " << scorer.getNumTargets() << " notes scored; ";
+
+	for (int i = 0; i < scorer.getNumScored(); ++i)
+	  {
+		const auto& score = scorer.getScore (i);
+
+		for (auto& note : c.phrase)
+		  if (note.start == score.span.start && note.noteNumber == score.span.noteNumber
+			  && note.right != score.isRight())
+			problems << juce::MidiMessage::getMidiNoteName (note.noteNumber, true, true, 4) << " at "
+					 << note.start << " marked " << (score.isRight() ? "right" : "wrong") << " ("
+					 << juce::roundToInt (score.getAccuracy() * 100.0f) << "%); ";
+	  }
+
+	const auto harmony = juce::roundToInt (scorer.getHarmonyAccuracy() * 100.0f);
+
+	if (c.harmonyPercent >= 0 && harmony != c.harmonyPercent)
+	  problems << "harmony " << harmony << "%, expected " << c.harmonyPercent << "%; ";
+
+	return problems;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+  const auto verbose = args.containsOption ("--verbose");
+
+  GuessScorer scorer;
+  auto numFailed = 0;
+  const auto corpus = createCorpus();
+
+  std::cout << "\nGuessScorer against " << corpus.size() << " hand-labelled cases\n";
+
+  for (auto& c : corpus)
+	{
+	  const auto problems = check (c, scorer);
+
+	  if (problems.isNotEmpty())
+		{
+		  ++numFailed;
+		  std::cout << "  FAIL  " << c.name << ": " << problems.trimCharactersAtEnd ("; ") << "\n";
+		}
+	  else if (verbose)
+		{
+		  std::cout << "  ok    " << c.name << "\n";
+		}
+	}
+
+  std::cout << (numFailed == 0 ? "  all passed\n" : "  " + std::to_string (numFailed) + " failed\n");
+  return numFailed == 0 ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+/*
+  ==============================================================================
+
+    Sequencer check: plays patterns through PatternSequencer in blocks of
+    random sizes, now and then jumping to another position or changing the
+    tempo, and exits with 1 if any block gets an event dropped, doubled or
+    more than a sample away from where its tick falls.
+
+      melodious-sequencer-check [--verbose]
+
+    What each block should hold is worked out from scratch, by going
+    through every pass of the pattern that the block touches.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "PatternSequencer.h"
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  constexpr int q = Pattern::ticksPerQuarterNote;
+
+  struct Played
+  {
+	int channel, noteNumber;
+	bool isNoteOn;
+	double sample;   // the ideal position, or where it was put
+
+	bool isSameNoteAs (const Played& other) const noexcept
+	{
+	  return channel == other.channel && noteNumber == other.noteNumber && isNoteOn == other.isNoteOn;
+	}
+  };
+
+  struct Case
+  {
+	juce::String name;
+	Pattern pattern;
+	int maxBlockSize;
+	bool changesTempo, jumps;
+  };
+
+  Pattern::Event on (int tick, int noteNumber)   { return { tick, 1, (juce::uint8) noteNumber, 100, true }; }
+  Pattern::Event off (int tick, int noteNumber)  { return { tick, 1, (juce::uint8) noteNumber, 0, false }; }
+
+  std::vector<Pattern> createPatterns()
+  {
+	juce::Random random (7);
+	std::vector<Pattern::Event> dense;
+
+	for (int i = 0; i < 300; ++i)
+	  {
+		const auto tick = random.nextInt (16 * q);
+		const auto noteNumber = 36 + random.nextInt (48);
+		dense.push_back (on (tick, noteNumber));
+		dense.push_back (off (juce::jmin (16 * q - 1, tick + random.nextInt (q)), noteNumber));
+	  }
+
+	return {
+	  Pattern::createDefaultGroove(),
+	  Pattern ("one note", 4 * q, { on (0, 60), off (q, 60) }),
+	  Pattern ("over by half way", 8 * q, { on (0, 60), off (q, 60), on (2 * q, 64), off (4 * q, 64) }),
+	  Pattern ("first and last tick", 4 * q, { on (0, 60), off (4 * q - 1, 60) }),
+	  Pattern ("seven ticks long", 7, { on (0, 60), off (3, 60), on (3, 61), off (6, 61) }),
+	  Pattern ("dense", 16 * q, dense)
+	};
+  }
+
+  // Every event whose tick falls in [startTick, endTick), in order
+  std::vector<Played> findExpected (const Pattern& pattern, double startTick, double endTick, double samplesPerTick)
+  {
+	std::vector<Played> expected;
+	const auto length = (double) pattern.getLengthInTicks();
+
+	for (auto passStart = std::floor (startTick / length) * length; passStart < endTick; passStart += length)
+	  for (auto& event : pattern.getEvents())
+		{
+		  const auto tick = passStart + event.tick;
+
+		  if (tick >= startTick && tick < endTick)
+			expected.push_back ({ event.channel, event.noteNumber, event.isNoteOn, (tick - startTick) * samplesPerTick });
+		}
+
+	return expected;
+  }
+
+  juce::String describe (const Played& played)
+  {
+	return juce::String (played.isNoteOn ? "on " : "off ") + juce::String (played.noteNumber)
+		   + " at " + juce::String (played.sample, 1);
+  }
+
+  juce::String check (const Case& c, juce::Random& random)
+  {
+	juce::String problems;
+	const auto length = (double) c.pattern.getLengthInTicks();
+	const double samplesPerTickChoices[] = { 31.25, 20.117, 46.875, 0.9 };
+
+	PatternSequencer sequencer;
+	sequencer.setPattern (&c.pattern);
+	auto samplesPerTick = samplesPerTickChoices[0];
+	sequencer.setSamplesPerTick (samplesPerTick);
+
+	juce::MidiBuffer buffer;
+	auto tick = 0.0;
+	auto numWrongBlocks = 0, numExpected = 0, numPlayed = 0;
+
+	for (int block = 0; block < 3000; ++block)
+	  {
+		if (c.changesTempo && random.nextInt (50) == 0)
+		  {
+			samplesPerTick = samplesPerTickChoices[random.nextInt (juce::numElementsInArray (samplesPerTickChoices))];
+			sequencer.setSamplesPerTick (samplesPerTick);
+		  }
+
+		// back to the loop point, or anywhere at all
+		if (c.jumps && random.nextInt (40) == 0)
+		  tick = random.nextBool() ? std::floor (tick / length) * length
+								   : random.nextDouble() * 4.0 * length;
+
+		const auto numSamples = 1 + random.nextInt (c.maxBlockSize);
+		const auto startSample = random.nextInt (64);
+		const auto endTick = tick + numSamples / samplesPerTick;
+
+		buffer.clear();
+		sequencer.renderNextBlock (buffer, tick, startSample, numSamples);
+
+		std::vector<Played> played;
+
+		for (const auto metadata : buffer)
+		  {
+			const auto message = metadata.getMessage();
+			played.push_back ({ message.getChannel(), message.getNoteNumber(), message.isNoteOn(),
+								(double) (metadata.samplePosition - startSample) });
+		  }
+
+		const auto expected = findExpected (c.pattern, tick, endTick, samplesPerTick);
+		numExpected += (int) expected.size();
+		numPlayed += (int) played.size();
+
+		// the first event that's out, if any
+		size_t i = 0;
+
+		while (i < expected.size() && i < played.size()
+			   && played[i].isSameNoteAs (expected[i])
+			   && played[i].sample >= 0.0 && played[i].sample < numSamples
+			   && std::abs (played[i].sample - expected[i].sample) <= 1.0)
+		  ++i;
+
+		if ((i < expected.size() || i < played.size()) && numWrongBlocks++ == 0)
+		  {
+			problems << "the block of " << numSamples << " at tick " << juce::String (tick, 2) << " played "
+					 << (i < played.size() ? describe (played[i]) : juce::String ("nothing more"))
+					 << " where it should have played "
+					 << (i < expected.size() ? describe (expected[i]) : juce::String ("nothing more")) << "; ";
+		  }
+
+		tick = endTick;
+	  }
+
+	if (numWrongBlocks > 0)
+	  problems << numWrongBlocks << " blocks wrong, " << numPlayed << " events played of " << numExpected << "; ";
+
+	return problems;
+  }
+
+  std::vector<Case> createCases()
+  {
+	std::vector<Case> cases;
+
+	for (auto& pattern : createPatterns())
+	  for (auto maxBlockSize : { 1, 512, 4096 })
+		for (int variation = 0; variation < 3; ++variation)
+		  {
+			const auto changesTempo = variation == 1;
+			const auto jumps = variation == 2;
+			const auto name = pattern.getName() + ", blocks of up to " + juce::String (maxBlockSize)
+							  + (changesTempo ? ", changing tempo" : jumps ? ", jumping about" : "");
+
+			cases.push_back ({ name, pattern, maxBlockSize, changesTempo, jumps });
+		  }
+
+	return cases;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+  const auto verbose = args.containsOption ("--verbose");
+
+  juce::Random random (1);
+  auto numFailed = 0;
+  const auto cases = createCases();
+
+  std::cout << "\nPatternSequencer against every pass of the pattern, " << cases.size() << " runs\n";
+
+  for (auto& c : cases)
+	{
+	  const auto problems = check (c, random);
+
+	  if (problems.isNotEmpty())
+		{
+		  ++numFailed;
+		  std::cout << "  FAIL  " << c.name << ": " << problems.trimCharactersAtEnd ("; ") << "\n";
+		}
+	  else if (verbose)
+		{
+		  std::cout << "  ok    " << c.name << "\n";
+		}
+	}
+
+  std::cout << (numFailed == 0 ? "  all passed\n" : "  " + std::to_string (numFailed) + " failed\n");
+  return numFailed == 0 ? 0 : 1;
+}
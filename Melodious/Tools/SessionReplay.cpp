@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    Session replay: runs a session recorded with --record-session back
+    through the engine with no audio device, as fast as it'll go, and checks
+    that the scores, the loop-boundary choices and every block's audio come
+    out exactly as they did live. Exits with 2 if they don't.
+
+      melodious-replay --session=practice.mses [--export=practice.flac]
+                       [--phrases=phrases.mphl] [--grooves=dir] [--instruments=dir]
+
+    --export writes what the session played, the phrases, the groove and the
+    student's answers, to a WAV or FLAC file as it's replayed. The encoding
+    runs on the exporter's own thread, so it doesn't slow the replay down.
+
+    Without a session it records one itself first, from the scripted
+    student OfflineRenderer plays, and replays that:
+
+      melodious-replay --record=scripted.mses [--loops=8] [--rate=48000] [--block=256]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include "SessionRecorder.h"
+#include "SessionPlayer.h"
+#include "AudioExporter.h"
+#include "ResourceLoader.h"
+#include <iostream>
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  auto phraseFile = ResourceLoader::getDefaultPhraseLibraryFile();
+  auto grooveDirectory = ResourceLoader::getDefaultGrooveDirectory();
+  auto instrumentDirectory = ResourceLoader::getDefaultInstrumentDirectory();
+
+  if (args.containsOption ("--phrases"))      phraseFile = args.getFileForOption ("--phrases");
+  if (args.containsOption ("--grooves"))      grooveDirectory = args.getFileForOption ("--grooves");
+  if (args.containsOption ("--instruments"))  instrumentDirectory = args.getFileForOption ("--instruments");
+
+  juce::File sessionFile;
+
+  if (args.containsOption ("--session"))
+	{
+	  sessionFile = args.getFileForOption ("--session");
+	}
+  else if (args.containsOption ("--record"))
+	{
+	  sessionFile = args.getFileForOption ("--record");
+
+	  OfflineRenderer::Settings settings;
+	  if (args.containsOption ("--loops"))  settings.numLoops = juce::jmax (2, args.getValueForOption ("--loops").getIntValue());
+	  if (args.containsOption ("--rate"))   settings.sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+	  if (args.containsOption ("--block"))  settings.blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+
+	  SessionRecorder recorder;
+	  recorder.setFile (sessionFile);
+	  settings.sessionSink = &recorder;
+
+	  OfflineRenderer renderer;
+	  const auto recorded = renderer.render (settings);
+
+	  std::cout << "\nRecorded " << recorded.numBlocks << " blocks of scripted playing to "
+				<< sessionFile.getFullPathName() << " (" << recorder.getNumDropped() << " events dropped)\n";
+	}
+  else
+	{
+	  std::cerr << "usage: melodious-replay --session=file.mses | --record=file.mses [--loops=8]\n";
+	  return 1;
+	}
+
+  // the replay has to see the grooves and instruments the recording did
+  ResourceLoader loader;
+  loader.startLoading (phraseFile, {}, grooveDirectory, instrumentDirectory);
+  loader.waitUntilLoaded();
+
+  SessionPlayer player;
+  juce::String error;
+
+  if (! player.load (sessionFile, &loader, error))
+	{
+	  std::cerr << error << "\n";
+	  return 1;
+	}
+
+  const auto& header = player.getHeader();
+  std::cout << "\nSession " << sessionFile.getFileName() << ": " << player.getNumBlocks() << " blocks, "
+			<< juce::String (player.getLengthInSeconds(), 1) << " s at " << header.sampleRate << " Hz, seed "
+			<< juce::String::toHexString (header.randomSeed) << "\n";
+
+  juce::MidiKeyboardState keyboardState;
+  LooperAudioSource engine (keyboardState);
+  engine.bindResources (&loader);
+
+  AudioExporter exporter;
+  SessionPlayer::BlockCallback exportBlock;
+
+  if (args.containsOption ("--export"))
+	{
+	  // the first block says how many channels the session played
+	  exportBlock = [&] (const juce::AudioBuffer<float>& audio, int numSamples)
+		{
+		  if (! exporter.isActive()
+			  && (error.isNotEmpty() || ! exporter.start (args.getFileForOption ("--export"), header.sampleRate,
+														  audio.getNumChannels(), error)))
+			return;
+
+		  exporter.writeWaiting (audio, 0, numSamples);
+		};
+	}
+
+  const auto startTicks = juce::Time::getHighResolutionTicks();
+  const auto report = player.replay (engine, exportBlock);
+  std::cout << SessionPlayer::formatReport (report);
+
+  if (error.isNotEmpty())
+	{
+	  std::cerr << error << "\n";
+	  return 1;
+	}
+
+  if (exporter.isActive())
+	{
+	  const auto framesWritten = exporter.getNumFramesQueued();
+	  const auto exportFile = exporter.getFile();
+	  exporter.stop();
+
+	  // the encoder finishes what's still queued once the replay is over
+	  const auto totalSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks()
+																		   - startTicks);
+	  std::cout << "  exported " << juce::String (framesWritten / header.sampleRate, 1) << " s to "
+				<< exportFile.getFullPathName() << " (" << juce::String (exportFile.getSize() / 1024.0, 0)
+				<< " KB), " << juce::String (report.audioSeconds / totalSeconds, 1)
+				<< "x real time with the encoding\n";
+	}
+
+  return report.matched ? 0 : 2;
+}
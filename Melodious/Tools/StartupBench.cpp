@@ -0,0 +1,105 @@
+/*
+  ==============================================================================
+
+    Startup-time benchmark: how long until the engine makes its first sound,
+    and how long a device restart (releaseResources + prepareToPlay) takes,
+    with the ResourceLoader running in the background as it does in the app.
+
+      melodious-startup-bench [--restarts=20] [--rate=48000] [--block=256]
+                              [--phrases=phrases.mphl] [--image=houses.png]
+                              [--grooves=grooves]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+#include "ResourceLoader.h"
+#include <iostream>
+
+static double millisecondsSince (juce::int64 startTicks)
+{
+  return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+}
+
+int main (int argc, char* argv[])
+{
+  const auto startTicks = juce::Time::getHighResolutionTicks();
+  juce::ArgumentList args (argc, argv);
+
+  auto numRestarts = 20;
+  auto sampleRate = 48000.0;
+  auto blockSize = 256;
+  auto phraseFile = ResourceLoader::getDefaultPhraseLibraryFile();
+  auto imageFile = ResourceLoader::getDefaultBackgroundImageFile();
+  auto grooveDirectory = ResourceLoader::getDefaultGrooveDirectory();
+
+  if (args.containsOption ("--restarts"))  numRestarts = juce::jmax (1, args.getValueForOption ("--restarts").getIntValue());
+  if (args.containsOption ("--rate"))      sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+  if (args.containsOption ("--block"))     blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+  if (args.containsOption ("--phrases"))   phraseFile = args.getFileForOption ("--phrases");
+  if (args.containsOption ("--image"))     imageFile = args.getFileForOption ("--image");
+  if (args.containsOption ("--grooves"))   grooveDirectory = args.getFileForOption ("--grooves");
+
+  ResourceLoader loader;
+  loader.startLoading (phraseFile, imageFile, grooveDirectory);
+
+  juce::MidiKeyboardState keyboardState;
+  LooperAudioSource engine (keyboardState);
+  engine.bindResources (&loader);
+
+  const auto prepareTicks = juce::Time::getHighResolutionTicks();
+  engine.prepareToPlay (blockSize, sampleRate);
+  const auto firstPrepareMs = millisecondsSince (prepareTicks);
+
+  // render until something comes out, as the audio device would
+  juce::AudioBuffer<float> buffer (2, blockSize);
+  juce::AudioSourceChannelInfo info (&buffer, 0, blockSize);
+  auto timeToFirstSoundMs = -1.0;
+
+  for (int block = 0; block < (int) (sampleRate / blockSize) * 10; ++block)
+	{
+	  engine.getNextAudioBlock (info);
+
+	  if (buffer.getMagnitude (0, blockSize) > 0.0f)
+		{
+		  timeToFirstSoundMs = millisecondsSince (startTicks);
+		  break;
+		}
+	}
+
+  juce::Array<double> restartMs;
+
+  for (int i = 0; i < numRestarts; ++i)
+	{
+	  const auto restartTicks = juce::Time::getHighResolutionTicks();
+	  engine.releaseResources();
+	  engine.prepareToPlay (blockSize, sampleRate);
+	  restartMs.add (millisecondsSince (restartTicks));
+	}
+
+  engine.releaseResources();
+
+  loader.waitUntilLoaded();
+  const auto resourcesLoadedMs = millisecondsSince (startTicks);
+
+  auto meanRestartMs = 0.0, maxRestartMs = 0.0;
+
+  for (auto ms : restartMs)
+	{
+	  meanRestartMs += ms / restartMs.size();
+	  maxRestartMs = juce::jmax (maxRestartMs, ms);
+	}
+
+  std::cout << "\nStartup at " << sampleRate << " Hz, " << blockSize << "-sample blocks\n"
+			<< "  first prepareToPlay:       " << juce::String (firstPrepareMs, 3) << " ms\n"
+			<< "  time to first sound:       " << juce::String (timeToFirstSoundMs, 3) << " ms\n"
+			<< "  device restart (mean/max): " << juce::String (meanRestartMs, 3) << " / "
+			<< juce::String (maxRestartMs, 3) << " ms over " << numRestarts << " restarts\n"
+			<< "  background loading done:   " << juce::String (resourcesLoadedMs, 3) << " ms ("
+			<< (loader.getPhraseLibrary() != nullptr ? "phrases" : "no phrases") << ", "
+			<< loader.getNumGrooves() << " grooves, "
+			<< (loader.getBackgroundImage().isValid() ? "image" : "no image") << ")\n";
+
+  return 0;
+}
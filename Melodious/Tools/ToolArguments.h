@@ -0,0 +1,20 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Parses a comma-separated option such as --blocks=64,256,1024. Values
+// below 1 are left out, other than zeros when allowZero is set.
+inline juce::Array<int> parseIntList (const juce::String& text, bool allowZero = false)
+{
+  juce::Array<int> values;
+
+  for (auto& token : juce::StringArray::fromTokens (text, ",", {}))
+	{
+	  const auto value = token.trim().getIntValue();
+
+	  if (value > 0 || (allowZero && value == 0))
+		values.add (value);
+	}
+
+  return values;
+}
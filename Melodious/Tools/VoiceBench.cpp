@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Voice pool benchmark: the cost of a block for a range of pool sizes and
+    numbers of sounding notes. With the active-voice list the time should
+    follow the number of notes held and stay flat as the pool grows.
+
+      melodious-voice-bench [--pools=8,64,256] [--notes=0,1,8,32,64]
+                            [--rate=48000] [--block=256] [--seconds=4]
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+#include "ToolArguments.h"
+#include <iostream>
+
+// Mean time per block, in microseconds, with numNotes held in a pool of poolSize
+static double timeBlocks (const WavetableBank& wavetables, int poolSize, int numNotes,
+						  double sampleRate, int blockSize, double seconds)
+{
+  VoicePool pool;
+  pool.allocateVoices (poolSize, [&wavetables] { return new SineWaveVoice (wavetables); });
+  pool.addSound (new SineWaveSound());
+  pool.setCurrentPlaybackSampleRate (sampleRate);
+
+  juce::AudioBuffer<float> buffer (2, blockSize);
+  juce::MidiBuffer midi;
+
+  // spread the notes over the keyboard, one per channel-and-key so none is retriggered
+  for (int i = 0; i < numNotes; ++i)
+	midi.addEvent (juce::MidiMessage::noteOn (1 + i / 88, 21 + i % 88, 0.5f), 0);
+
+  pool.renderNextBlock (buffer, midi, 0, blockSize);
+  midi.clear();
+
+  const auto numBlocks = juce::jmax (1, (int) (seconds * sampleRate / blockSize));
+  const auto start = juce::Time::getHighResolutionTicks();
+
+  for (int block = 0; block < numBlocks; ++block)
+	{
+	  buffer.clear();
+	  pool.renderNextBlock (buffer, midi, 0, blockSize);
+	}
+
+  const auto elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start);
+  return elapsed * 1.0e6 / numBlocks;
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+
+  juce::Array<int> poolSizes { 8, 64, 256 };
+  juce::Array<int> noteCounts { 0, 1, 8, 32, 64 };
+  auto sampleRate = 48000.0;
+  auto blockSize = 256;
+  auto seconds = 4.0;
+
+  if (args.containsOption ("--pools"))   poolSizes = parseIntList (args.getValueForOption ("--pools"));
+  if (args.containsOption ("--notes"))   noteCounts = parseIntList (args.getValueForOption ("--notes"), true);
+  if (args.containsOption ("--rate"))    sampleRate = juce::jmax (8000.0, args.getValueForOption ("--rate").getDoubleValue());
+  if (args.containsOption ("--block"))   blockSize = juce::jmax (16, args.getValueForOption ("--block").getIntValue());
+  if (args.containsOption ("--seconds")) seconds = juce::jmax (0.1, args.getValueForOption ("--seconds").getDoubleValue());
+
+  WavetableBank wavetables;
+  const auto budgetMicros = blockSize / sampleRate * 1.0e6;
+
+  std::cout << "\nVoice pool, " << blockSize << "-sample blocks at " << sampleRate
+			<< " Hz (budget " << juce::String (budgetMicros, 1) << " us), mean us per block\n";
+
+  auto header = juce::String ("  notes");
+  for (auto poolSize : poolSizes)
+	header += juce::String ("pool " + juce::String (poolSize)).paddedLeft (' ', 12);
+  std::cout << header << "\n";
+
+  for (auto numNotes : noteCounts)
+	{
+	  auto line = juce::String (numNotes).paddedLeft (' ', 7);
+
+	  for (auto poolSize : poolSizes)
+		line += (numNotes <= poolSize ? juce::String (timeBlocks (wavetables, poolSize, numNotes,
+																   sampleRate, blockSize, seconds), 2)
+									  : juce::String ("-")).paddedLeft (' ', 12);
+
+	  std::cout << line << "\n";
+	}
+
+  return 0;
+}
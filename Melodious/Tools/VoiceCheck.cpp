@@ -0,0 +1,258 @@
+/*
+  ==============================================================================
+
+    Voice check: renders notes through SineWaveVoice, which works in chunks
+    of up to 256 samples, and through a plain loop that does one sample at
+    a time the way the voice used to, and exits with 1 if they differ.
+
+      melodious-voice-check [--verbose]
+
+    Every waveform is played at several pitches, sample rates and envelopes,
+    in blocks of random sizes that split the voice's chunks anywhere. Each
+    note is released and has to fall silent on the same sample in both.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "LooperAudioSource.h"
+#include <iostream>
+#include <vector>
+
+namespace
+{
+  constexpr float velocity = 0.8f;
+
+  // The envelope's gains come out in different block sizes in the two
+  // renders, and a long ramp built up a sample at a time drifts by about
+  // 1e-5 by its end. The lowest note a sample out of step would be out by
+  // 2e-4 or more.
+  constexpr float tolerance = 5.0e-5f;
+
+  struct Envelope
+  {
+	const char* name;
+	AdsrEnvelope::Parameters parameters;
+	float noteOffMs;
+  };
+
+  struct Case
+  {
+	juce::String name;
+	WavetableBank::Waveform waveform;
+	int noteNumber;
+	double sampleRate;
+	Envelope envelope;
+	int maxBlockSize;
+  };
+
+  std::vector<Envelope> createEnvelopes()
+  {
+	AdsrEnvelope::Parameters linear;
+	linear.attackMs = 10.0f;
+	linear.decayMs = 50.0f;
+	linear.sustainLevel = 0.5f;
+	linear.releaseMs = 200.0f;
+	linear.curve = AdsrEnvelope::Curve::linear;
+
+	AdsrEnvelope::Parameters instant;
+	instant.attackMs = 0.0f;
+	instant.decayMs = 0.0f;
+	instant.sustainLevel = 1.0f;
+	instant.releaseMs = 0.0f;
+
+	AdsrEnvelope::Parameters slowAttack;
+	slowAttack.attackMs = 30.0f;
+
+	return {
+	  { "default envelope", {}, 250.0f },
+	  { "linear envelope", linear, 250.0f },
+	  { "no envelope", instant, 100.0f },
+	  { "released in the attack", slowAttack, 10.0f }
+	};
+  }
+
+  int millisecondsToSamples (float milliseconds, double sampleRate)
+  {
+	return juce::roundToInt (milliseconds * 0.001 * sampleRate);
+  }
+
+  // One sample at a time, with the envelope's gains taken one at a time too
+  std::vector<float> renderPerSample (const WavetableBank& bank, const Case& c, int numSamples)
+  {
+	AdsrEnvelope envelope;
+	envelope.setParameters (c.envelope.parameters);
+	envelope.setSampleRate (c.sampleRate);
+	envelope.noteOn();
+
+	const auto noteOffSample = millisecondsToSamples (c.envelope.noteOffMs, c.sampleRate);
+	const auto level = velocity * 0.15f;
+	const auto size = (float) WavetableBank::tableSize;
+	const auto tableDelta = (float) (juce::MidiMessage::getMidiNoteInHertz (c.noteNumber) / c.sampleRate * size);
+	const auto* table = bank.getTable (c.waveform, tableDelta);
+	auto currentIndex = 0.0f;
+
+	std::vector<float> output ((size_t) numSamples, 0.0f);
+
+	for (int i = 0; i < numSamples; ++i)
+	  {
+		if (i == noteOffSample)
+		  envelope.noteOff();
+
+		float gain;
+
+		if (envelope.getNextGains (&gain, 1) == 0)
+		  break;
+
+		auto index0 = (int) currentIndex;
+		auto fraction = currentIndex - (float) index0;
+		auto value = table[index0] + fraction * (table[index0 + 1] - table[index0]);
+		output[(size_t) i] = value * (gain * level);
+
+		if ((currentIndex += tableDelta) >= size)
+		  currentIndex -= size;
+	  }
+
+	return output;
+  }
+
+  // The voice in blocks of 1 to maxBlockSize samples, each at its own
+  // offset into the buffer, with the note released on a block boundary
+  juce::AudioSampleBuffer renderVoice (const WavetableBank& bank, const Case& c, int numSamples, juce::Random& random)
+  {
+	SineWaveVoice voice (bank);
+	voice.setCurrentPlaybackSampleRate (c.sampleRate);
+	voice.setWaveform (c.waveform);
+	voice.setEnvelope (c.envelope.parameters);
+	voice.startNote (c.noteNumber, velocity, nullptr, 8192);
+
+	const auto noteOffSample = millisecondsToSamples (c.envelope.noteOffMs, c.sampleRate);
+
+	juce::AudioSampleBuffer output (2, numSamples);
+	output.clear();
+
+	for (int position = 0; position < numSamples;)
+	  {
+		if (position == noteOffSample)
+		  voice.stopNote (0.0f, true);
+
+		auto blockSize = juce::jmin (numSamples - position, 1 + random.nextInt (c.maxBlockSize));
+
+		if (position < noteOffSample)
+		  blockSize = juce::jmin (blockSize, noteOffSample - position);
+
+		voice.renderNextBlock (output, position, blockSize);
+		position += blockSize;
+	  }
+
+	return output;
+  }
+
+  int getLastSounding (const float* samples, int numSamples)
+  {
+	for (int i = numSamples; --i >= 0;)
+	  if (samples[i] != 0.0f)
+		return i;
+
+	return -1;
+  }
+
+  juce::String check (const WavetableBank& bank, const Case& c, juce::Random& random, float& maxDifference)
+  {
+	juce::String problems;
+	const auto numSamples = millisecondsToSamples (c.envelope.noteOffMs + c.envelope.parameters.releaseMs + 20.0f,
+												   c.sampleRate);
+
+	const auto expected = renderPerSample (bank, c, numSamples);
+	const auto rendered = renderVoice (bank, c, numSamples, random);
+	const auto expectedEnd = getLastSounding (expected.data(), numSamples);
+
+	if (expectedEnd < 0 || expectedEnd == numSamples - 1)
+	  problems << "the reference note didn't sound and end within " << numSamples << " samples; ";
+
+	for (int channel = 0; channel < rendered.getNumChannels(); ++channel)
+	  {
+		const auto* samples = rendered.getReadPointer (channel);
+		auto worst = 0.0f;
+		auto worstSample = 0;
+
+		for (int i = 0; i < numSamples; ++i)
+		  {
+			const auto difference = std::abs (samples[i] - expected[(size_t) i]);
+
+			if (difference > worst)
+			  {
+				worst = difference;
+				worstSample = i;
+			  }
+		  }
+
+		maxDifference = juce::jmax (maxDifference, worst);
+
+		if (worst > tolerance)
+		  problems << "channel " << channel << " is out by " << worst << " at sample " << worstSample << "; ";
+
+		const auto end = getLastSounding (samples, numSamples);
+
+		if (end != expectedEnd)
+		  problems << "channel " << channel << " ends on sample " << end << ", not " << expectedEnd << "; ";
+	  }
+
+	return problems;
+  }
+
+  std::vector<Case> createCases()
+  {
+	std::vector<Case> cases;
+
+	for (int w = 0; w < WavetableBank::numWaveforms; ++w)
+	  for (auto sampleRate : { 44100.0, 48000.0, 96000.0 })
+		for (auto noteNumber : { 33, 69, 96 })
+		  for (auto& envelope : createEnvelopes())
+			for (auto maxBlockSize : { 1, 300, 2048 })
+			  {
+				const auto waveform = (WavetableBank::Waveform) w;
+				const auto name = WavetableBank::getWaveformName (waveform)
+								  + " note " + juce::String (noteNumber)
+								  + " at " + juce::String (sampleRate / 1000.0, 1) + "kHz, "
+								  + envelope.name + ", blocks of up to " + juce::String (maxBlockSize);
+
+				cases.push_back ({ name, waveform, noteNumber, sampleRate, envelope, maxBlockSize });
+			  }
+
+	return cases;
+  }
+}
+
+int main (int argc, char* argv[])
+{
+  juce::ArgumentList args (argc, argv);
+  const auto verbose = args.containsOption ("--verbose");
+
+  const WavetableBank bank;
+  juce::Random random (1);
+  auto numFailed = 0;
+  auto maxDifference = 0.0f;
+  const auto cases = createCases();
+
+  std::cout << "\nSineWaveVoice against a per-sample render, " << cases.size() << " notes\n";
+
+  for (auto& c : cases)
+	{
+	  const auto problems = check (bank, c, random, maxDifference);
+
+	  if (problems.isNotEmpty())
+		{
+		  ++numFailed;
+		  std::cout << "  FAIL  " << c.name << ": " << problems.trimCharactersAtEnd ("; ") << "\n";
+		}
+	  else if (verbose)
+		{
+		  std::cout << "  ok    " << c.name << "\n";
+		}
+	}
+
+  std::cout << "  largest difference " << maxDifference << "\n";
+  std::cout << (numFailed == 0 ? "  all passed\n" : "  " + std::to_string (numFailed) + " failed\n");
+  return numFailed == 0 ? 0 : 1;
+}